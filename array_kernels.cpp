@@ -0,0 +1,411 @@
+#include <climits>
+
+#include "array_kernels.h"
+#include "operators.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ARRAY_KERNELS_X86
+#endif
+
+// Vectorized operations: add, sub and mul on two arrays, on an array and a
+// value, and on a value and an array (only sub differs)
+struct array_kernels_t
+{
+	void (*add)(int * dst, const int * a, const int * b, size_t size);
+	void (*sub)(int * dst, const int * a, const int * b, size_t size);
+	void (*mul)(int * dst, const int * a, const int * b, size_t size);
+	void (*add_value)(int * dst, const int * a, int value, size_t size);
+	void (*sub_value)(int * dst, const int * a, int value, size_t size);
+	void (*value_sub)(int * dst, int value, const int * b, size_t size);
+	void (*mul_value)(int * dst, const int * a, int value, size_t size);
+	int (*sum)(const int * a, size_t size);
+	int (*maxval)(const int * a, size_t size);
+};
+
+// plain loops, also finish the tails of the vector versions
+
+static void scalar_add(int * dst, const int * a, const int * b, size_t size)
+{
+	for(size_t index = 0; index < size; ++index)
+	{
+		dst[index] = (int)((unsigned int)a[index] + (unsigned int)b[index]);
+	}
+}
+
+static void scalar_sub(int * dst, const int * a, const int * b, size_t size)
+{
+	for(size_t index = 0; index < size; ++index)
+	{
+		dst[index] = (int)((unsigned int)a[index] - (unsigned int)b[index]);
+	}
+}
+
+static void scalar_mul(int * dst, const int * a, const int * b, size_t size)
+{
+	for(size_t index = 0; index < size; ++index)
+	{
+		dst[index] = (int)((unsigned int)a[index] * (unsigned int)b[index]);
+	}
+}
+
+static void scalar_add_value(int * dst, const int * a, int value, size_t size)
+{
+	for(size_t index = 0; index < size; ++index)
+	{
+		dst[index] = (int)((unsigned int)a[index] + (unsigned int)value);
+	}
+}
+
+static void scalar_sub_value(int * dst, const int * a, int value, size_t size)
+{
+	for(size_t index = 0; index < size; ++index)
+	{
+		dst[index] = (int)((unsigned int)a[index] - (unsigned int)value);
+	}
+}
+
+static void scalar_value_sub(int * dst, int value, const int * b, size_t size)
+{
+	for(size_t index = 0; index < size; ++index)
+	{
+		dst[index] = (int)((unsigned int)value - (unsigned int)b[index]);
+	}
+}
+
+static void scalar_mul_value(int * dst, const int * a, int value, size_t size)
+{
+	for(size_t index = 0; index < size; ++index)
+	{
+		dst[index] = (int)((unsigned int)a[index] * (unsigned int)value);
+	}
+}
+
+static int scalar_sum(const int * a, size_t size)
+{
+	unsigned int result = 0;
+	for(size_t index = 0; index < size; ++index)
+	{
+		result += (unsigned int)a[index];
+	}
+	return (int)result;
+}
+
+static int scalar_maxval(const int * a, size_t size)
+{
+	int result = INT_MIN;
+	for(size_t index = 0; index < size; ++index)
+	{
+		if (a[index] > result)
+		{
+			result = a[index];
+		}
+	}
+	return result;
+}
+
+static const array_kernels_t scalar_kernels =
+{
+	scalar_add, scalar_sub, scalar_mul,
+	scalar_add_value, scalar_sub_value, scalar_value_sub, scalar_mul_value,
+	scalar_sum, scalar_maxval
+};
+
+#ifdef ARRAY_KERNELS_X86
+
+// SSE2, 4 ints per vector
+
+static inline __m128i sse2_mullo(__m128i a, __m128i b)
+{
+	// SSE2 only multiplies the even lanes, the odd ones are shifted down
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+#define SSE2_ARRAY_KERNEL(name, expression, tail) \
+	static void name(int * dst, const int * a, const int * b, size_t size) \
+	{ \
+		size_t index = 0; \
+		for(; index + 4 <= size; index += 4) \
+		{ \
+			__m128i x = _mm_loadu_si128((const __m128i *)(a + index)); \
+			__m128i y = _mm_loadu_si128((const __m128i *)(b + index)); \
+			_mm_storeu_si128((__m128i *)(dst + index), expression); \
+		} \
+		tail(dst + index, a + index, b + index, size - index); \
+	}
+
+#define SSE2_VALUE_KERNEL(name, expression, tail) \
+	static void name(int * dst, const int * a, int value, size_t size) \
+	{ \
+		__m128i y = _mm_set1_epi32(value); \
+		size_t index = 0; \
+		for(; index + 4 <= size; index += 4) \
+		{ \
+			__m128i x = _mm_loadu_si128((const __m128i *)(a + index)); \
+			_mm_storeu_si128((__m128i *)(dst + index), expression); \
+		} \
+		tail(dst + index, a + index, value, size - index); \
+	}
+
+SSE2_ARRAY_KERNEL(sse2_add, _mm_add_epi32(x, y), scalar_add)
+SSE2_ARRAY_KERNEL(sse2_sub, _mm_sub_epi32(x, y), scalar_sub)
+SSE2_ARRAY_KERNEL(sse2_mul, sse2_mullo(x, y), scalar_mul)
+SSE2_VALUE_KERNEL(sse2_add_value, _mm_add_epi32(x, y), scalar_add_value)
+SSE2_VALUE_KERNEL(sse2_sub_value, _mm_sub_epi32(x, y), scalar_sub_value)
+SSE2_VALUE_KERNEL(sse2_mul_value, sse2_mullo(x, y), scalar_mul_value)
+
+static void sse2_value_sub(int * dst, int value, const int * b, size_t size)
+{
+	__m128i x = _mm_set1_epi32(value);
+	size_t index = 0;
+	for(; index + 4 <= size; index += 4)
+	{
+		__m128i y = _mm_loadu_si128((const __m128i *)(b + index));
+		_mm_storeu_si128((__m128i *)(dst + index), _mm_sub_epi32(x, y));
+	}
+	scalar_value_sub(dst + index, value, b + index, size - index);
+}
+
+static int sse2_sum(const int * a, size_t size)
+{
+	__m128i total = _mm_setzero_si128();
+	size_t index = 0;
+	for(; index + 4 <= size; index += 4)
+	{
+		total = _mm_add_epi32(total, _mm_loadu_si128((const __m128i *)(a + index)));
+	}
+	int lanes[4];
+	_mm_storeu_si128((__m128i *)lanes, total);
+	return scalar_sum(lanes, 4) + scalar_sum(a + index, size - index);
+}
+
+static int sse2_maxval(const int * a, size_t size)
+{
+	// SSE2 has no signed 32-bit max, it is done with a compare and a blend
+	__m128i best = _mm_set1_epi32(INT_MIN);
+	size_t index = 0;
+	for(; index + 4 <= size; index += 4)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i *)(a + index));
+		__m128i greater = _mm_cmpgt_epi32(x, best);
+		best = _mm_or_si128(_mm_and_si128(greater, x), _mm_andnot_si128(greater, best));
+	}
+	int lanes[4];
+	_mm_storeu_si128((__m128i *)lanes, best);
+	int result = scalar_maxval(lanes, 4);
+	int tail = scalar_maxval(a + index, size - index);
+	return tail > result ? tail : result;
+}
+
+static const array_kernels_t sse2_kernels =
+{
+	sse2_add, sse2_sub, sse2_mul,
+	sse2_add_value, sse2_sub_value, sse2_value_sub, sse2_mul_value,
+	sse2_sum, sse2_maxval
+};
+
+// AVX2, 8 ints per vector, compiled for AVX2 regardless of the build flags
+
+#define AVX2 __attribute__((target("avx2")))
+
+#define AVX2_ARRAY_KERNEL(name, expression, tail) \
+	AVX2 static void name(int * dst, const int * a, const int * b, size_t size) \
+	{ \
+		size_t index = 0; \
+		for(; index + 8 <= size; index += 8) \
+		{ \
+			__m256i x = _mm256_loadu_si256((const __m256i *)(a + index)); \
+			__m256i y = _mm256_loadu_si256((const __m256i *)(b + index)); \
+			_mm256_storeu_si256((__m256i *)(dst + index), expression); \
+		} \
+		tail(dst + index, a + index, b + index, size - index); \
+	}
+
+#define AVX2_VALUE_KERNEL(name, expression, tail) \
+	AVX2 static void name(int * dst, const int * a, int value, size_t size) \
+	{ \
+		__m256i y = _mm256_set1_epi32(value); \
+		size_t index = 0; \
+		for(; index + 8 <= size; index += 8) \
+		{ \
+			__m256i x = _mm256_loadu_si256((const __m256i *)(a + index)); \
+			_mm256_storeu_si256((__m256i *)(dst + index), expression); \
+		} \
+		tail(dst + index, a + index, value, size - index); \
+	}
+
+AVX2_ARRAY_KERNEL(avx2_add, _mm256_add_epi32(x, y), scalar_add)
+AVX2_ARRAY_KERNEL(avx2_sub, _mm256_sub_epi32(x, y), scalar_sub)
+AVX2_ARRAY_KERNEL(avx2_mul, _mm256_mullo_epi32(x, y), scalar_mul)
+AVX2_VALUE_KERNEL(avx2_add_value, _mm256_add_epi32(x, y), scalar_add_value)
+AVX2_VALUE_KERNEL(avx2_sub_value, _mm256_sub_epi32(x, y), scalar_sub_value)
+AVX2_VALUE_KERNEL(avx2_mul_value, _mm256_mullo_epi32(x, y), scalar_mul_value)
+
+AVX2 static void avx2_value_sub(int * dst, int value, const int * b, size_t size)
+{
+	__m256i x = _mm256_set1_epi32(value);
+	size_t index = 0;
+	for(; index + 8 <= size; index += 8)
+	{
+		__m256i y = _mm256_loadu_si256((const __m256i *)(b + index));
+		_mm256_storeu_si256((__m256i *)(dst + index), _mm256_sub_epi32(x, y));
+	}
+	scalar_value_sub(dst + index, value, b + index, size - index);
+}
+
+AVX2 static int avx2_sum(const int * a, size_t size)
+{
+	__m256i total = _mm256_setzero_si256();
+	size_t index = 0;
+	for(; index + 8 <= size; index += 8)
+	{
+		total = _mm256_add_epi32(total, _mm256_loadu_si256((const __m256i *)(a + index)));
+	}
+	int lanes[8];
+	_mm256_storeu_si256((__m256i *)lanes, total);
+	return scalar_sum(lanes, 8) + scalar_sum(a + index, size - index);
+}
+
+AVX2 static int avx2_maxval(const int * a, size_t size)
+{
+	__m256i best = _mm256_set1_epi32(INT_MIN);
+	size_t index = 0;
+	for(; index + 8 <= size; index += 8)
+	{
+		best = _mm256_max_epi32(best, _mm256_loadu_si256((const __m256i *)(a + index)));
+	}
+	int lanes[8];
+	_mm256_storeu_si256((__m256i *)lanes, best);
+	int result = scalar_maxval(lanes, 8);
+	int tail = scalar_maxval(a + index, size - index);
+	return tail > result ? tail : result;
+}
+
+static const array_kernels_t avx2_kernels =
+{
+	avx2_add, avx2_sub, avx2_mul,
+	avx2_add_value, avx2_sub_value, avx2_value_sub, avx2_mul_value,
+	avx2_sum, avx2_maxval
+};
+
+#endif
+
+static const array_kernels_t * select_kernels()
+{
+#ifdef ARRAY_KERNELS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return &avx2_kernels;
+	}
+	if (__builtin_cpu_supports("sse2"))
+	{
+		return &sse2_kernels;
+	}
+#endif
+	return &scalar_kernels;
+}
+
+static const array_kernels_t * kernels()
+{
+	static const array_kernels_t * selected = select_kernels();
+	return selected;
+}
+
+// Division has no vector form, it is done element by element and fails
+// like the scalar one, with the line of the operation
+
+void array_binary(operation type, int * dst, const int * a, const int * b, size_t size, int line)
+{
+	switch (type)
+	{
+	case opAdd:
+		kernels()->add(dst, a, b, size);
+		break;
+	case opSub:
+		kernels()->sub(dst, a, b, size);
+		break;
+	case opMul:
+		kernels()->mul(dst, a, b, size);
+		break;
+	case opDiv:
+		for(size_t index = 0; index < size; ++index)
+		{
+			div_operator_t::check(a[index], b[index], line);
+			dst[index] = a[index] / b[index];
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void array_binary(operation type, int * dst, const int * a, int value, size_t size, int line)
+{
+	switch (type)
+	{
+	case opAdd:
+		kernels()->add_value(dst, a, value, size);
+		break;
+	case opSub:
+		kernels()->sub_value(dst, a, value, size);
+		break;
+	case opMul:
+		kernels()->mul_value(dst, a, value, size);
+		break;
+	case opDiv:
+		for(size_t index = 0; index < size; ++index)
+		{
+			div_operator_t::check(a[index], value, line);
+			dst[index] = a[index] / value;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void array_binary(operation type, int * dst, int value, const int * b, size_t size, int line)
+{
+	switch (type)
+	{
+	case opAdd:
+		kernels()->add_value(dst, b, value, size);
+		break;
+	case opSub:
+		kernels()->value_sub(dst, value, b, size);
+		break;
+	case opMul:
+		kernels()->mul_value(dst, b, value, size);
+		break;
+	case opDiv:
+		for(size_t index = 0; index < size; ++index)
+		{
+			div_operator_t::check(value, b[index], line);
+			dst[index] = value / b[index];
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void array_fill(int * dst, int value, size_t size)
+{
+	for(size_t index = 0; index < size; ++index)
+	{
+		dst[index] = value;
+	}
+}
+
+int array_sum(const int * a, size_t size)
+{
+	return kernels()->sum(a, size);
+}
+
+int array_maxval(const int * a, size_t size)
+{
+	return kernels()->maxval(a, size);
+}
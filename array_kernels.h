@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+
+#include "types.h"
+
+// Arrays start at this alignment and their sizes are rounded up to it, so
+// the kernels see whole vectors on aligned storage
+const size_t ARRAY_ALIGNMENT = 32;
+const size_t ARRAY_ALIGNMENT_INTS = ARRAY_ALIGNMENT / sizeof(int);
+
+// Number of ints an array of size elements takes
+inline size_t array_storage_size(size_t size)
+{
+	return (size + ARRAY_ALIGNMENT_INTS - 1) / ARRAY_ALIGNMENT_INTS * ARRAY_ALIGNMENT_INTS;
+}
+
+// Whole-array arithmetic, dispatched on first use to AVX2, SSE2 or plain
+// loops depending on the CPU. Results wrap around like scalar int math, a
+// division fails like a scalar one of the line given.
+
+// dst = a op b
+void array_binary(operation type, int * dst, const int * a, const int * b, size_t size, int line);
+// dst = a op value
+void array_binary(operation type, int * dst, const int * a, int value, size_t size, int line);
+// dst = value op b
+void array_binary(operation type, int * dst, int value, const int * b, size_t size, int line);
+
+void array_fill(int * dst, int value, size_t size);
+int array_sum(const int * a, size_t size);
+int array_maxval(const int * a, size_t size);
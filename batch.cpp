@@ -0,0 +1,120 @@
+#include <cstdio>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "batch.h"
+#include "runtime.h"
+
+// batch_t
+
+batch_t::batch_t(program_t * program, vm_t * vm, closure_engine_t * closures)
+{
+	this->program = program;
+	this->vm = vm;
+	this->closures = closures;
+	has_output_mode = false;
+	mode = omBlock;
+	inputs = NULL;
+	next = 0;
+	failures = 0;
+}
+
+void batch_t::set_output_mode(output_mode mode)
+{
+	has_output_mode = true;
+	this->mode = mode;
+}
+
+bool batch_t::run_input(const std::string & input_name)
+{
+	int input_fd = open(input_name.c_str(), O_RDONLY);
+	if (input_fd < 0)
+	{
+		fprintf(stderr, "%s: can't open\n", input_name.c_str());
+		return false;
+	}
+
+	std::string output_name = input_name + BATCH_OUTPUT_SUFFIX;
+	FILE * output_stream = fopen(output_name.c_str(), "w");
+	if (output_stream == NULL)
+	{
+		fprintf(stderr, "%s: can't create %s\n", input_name.c_str(), output_name.c_str());
+		close(input_fd);
+		return false;
+	}
+
+	bool succeeded = true;
+	{
+		runtime_t runtime(input_fd, output_stream);
+		error_trap_t trap;
+		if (has_output_mode)
+		{
+			runtime.output.set_mode(mode);
+		}
+
+		try
+		{
+			if (vm != NULL)
+			{
+				vm->run(&runtime);
+			}
+			else if (closures != NULL)
+			{
+				closures->run(&runtime);
+			}
+			else
+			{
+				program->run(&runtime);
+			}
+			runtime.output.flush();
+		}
+		catch (const fortran_error_t & error)
+		{
+			// what was written before the error is kept, as in a single run
+			runtime.output.flush();
+			fprintf(stderr, "%s: %s\n", input_name.c_str(), error.what());
+			succeeded = false;
+		}
+	}
+
+	fclose(output_stream);
+	close(input_fd);
+	return succeeded;
+}
+
+void batch_t::work()
+{
+	for(;;)
+	{
+		size_t index = next++;
+		if (index >= inputs->size())
+		{
+			return;
+		}
+		if (!run_input((*inputs)[index]))
+		{
+			++failures;
+		}
+	}
+}
+
+size_t batch_t::run(const std::vector<std::string> & inputs, size_t jobs)
+{
+	this->inputs = &inputs;
+	next = 0;
+	failures = 0;
+
+	// the calling thread takes inputs as well
+	std::vector<std::thread> threads;
+	for(size_t index = 1; index < jobs && index < inputs.size(); ++index)
+	{
+		threads.push_back(std::thread(&batch_t::work, this));
+	}
+	work();
+	for(size_t index = 0; index < threads.size(); ++index)
+	{
+		threads[index].join();
+	}
+	return failures;
+}
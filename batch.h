@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "syntax_engine.h"
+#include "vm.h"
+#include "closure.h"
+#include "output.h"
+
+// Runs a compiled program over many inputs (--batch). Every input file gets
+// a run of its own that reads from the file and writes to the file named
+// after it with BATCH_OUTPUT_SUFFIX appended. The runs share the program and
+// go on in parallel; a failed run is reported on stderr and the others go on.
+
+const char * const BATCH_OUTPUT_SUFFIX = ".out";
+
+class batch_t
+{
+private:
+	program_t * program;
+	vm_t * vm;
+	closure_engine_t * closures;
+	bool has_output_mode;
+	output_mode mode;
+
+	const std::vector<std::string> * inputs;
+	std::atomic<size_t> next;
+	std::atomic<size_t> failures;
+
+	bool run_input(const std::string & input_name);
+	void work();
+
+public:
+	// vm and closures are NULL for the tree walker, at most one is given
+	batch_t(program_t * program, vm_t * vm, closure_engine_t * closures);
+
+	void set_output_mode(output_mode mode);
+
+	// returns the number of failed runs
+	size_t run(const std::vector<std::string> & inputs, size_t jobs);
+};
@@ -0,0 +1,25 @@
+PROGRAM CALLS
+	INTEGER :: I, S
+	WRITE "fib: ", CALL FIB(30)
+	S = 0
+	DO I = 1, 1000
+		S = S + CALL DEPTH(5000)
+	END DO
+	WRITE "depth: ", S
+END PROGRAM CALLS
+
+FUNCTION FIB(N)
+	IF (N < 2) THEN
+		FIB = N
+	ELSE
+		FIB = CALL FIB(N - 1) + CALL FIB(N - 2)
+	END IF
+END FUNCTION FIB
+
+FUNCTION DEPTH(N)
+	IF (N == 0) THEN
+		DEPTH = 0
+	ELSE
+		DEPTH = CALL DEPTH(N - 1) + 1
+	END IF
+END FUNCTION DEPTH
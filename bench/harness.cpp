@@ -0,0 +1,488 @@
+// Runs the workloads of this directory with every execution engine and
+// reports one line per run:
+//
+//     harness <interpreter> [--repeat=N] [--format=csv|json] [--engines=a,b]
+//
+// Wall time is the best of the repetitions, peak RSS the largest one. The
+// number of executed statements and calls comes from one --profile run of
+// the workload, it is the same for every engine.
+//
+// tree-cached runs the tree engine on an image of the program kept by
+// --cache, after a run that writes it. Next to tree it shows what a cache
+// hit saves at startup; the parse workload is nearly all startup. closure
+// has no JIT, tree-nojit is the walker to hold it against.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+struct engine_t
+{
+	const char * name;
+	const char * option;
+	// runs with --cache, the image is written before the measured runs
+	bool cached;
+};
+
+static const engine_t engines[] =
+{
+	{ "tree", NULL, false },
+	{ "tree-nojit", "--no-jit", false },
+	{ "vm", "--engine=vm", false },
+	{ "closure", "--engine=closure", false },
+	{ "tree-cached", NULL, true }
+};
+
+struct workload_t
+{
+	std::string name;
+	std::string source;
+	// file given as stdin, empty for /dev/null
+	std::string input;
+};
+
+struct measurement_t
+{
+	double wall;
+	long peak_rss;
+	bool failed;
+};
+
+// Sizes of the generated workloads
+const int READ_COUNT = 1000000;
+const int PARSE_FUNCTIONS = 4000;
+const int PARSE_STATEMENTS = 20;
+
+static std::string bench_directory(const char * argv0)
+{
+	std::string path = argv0;
+	size_t slash = path.rfind('/');
+	return slash == std::string::npos ? "." : path.substr(0, slash);
+}
+
+static double now()
+{
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static void write_file(const std::string & path, const std::string & text)
+{
+	FILE * file = fopen(path.c_str(), "w");
+	if (file == NULL || fwrite(text.data(), 1, text.size(), file) != text.size())
+	{
+		fprintf(stderr, "can't write %s\n", path.c_str());
+		exit(-1);
+	}
+	fclose(file);
+}
+
+// heavy READ: a count followed by that many integers
+static std::string generate_input()
+{
+	std::string text;
+	char buffer[32];
+	sprintf(buffer, "%d\n", READ_COUNT);
+	text += buffer;
+	unsigned int seed = 12345;
+	for(int index = 0; index < READ_COUNT; ++index)
+	{
+		seed = seed * 1103515245 + 12345;
+		sprintf(buffer, "%d%c", (int)(seed >> 16) % 20001 - 10000, index % 10 == 9 ? '\n' : ' ');
+		text += buffer;
+	}
+	return text;
+}
+
+// parse speed: many small functions, only a few of them are called
+static std::string generate_source()
+{
+	std::string text = "PROGRAM PARSE\n\tINTEGER :: S\n\tS = CALL F0(1)\n\tWRITE S\nEND PROGRAM PARSE\n";
+	char buffer[128];
+	for(int function = 0; function < PARSE_FUNCTIONS; ++function)
+	{
+		sprintf(buffer, "\nFUNCTION F%d(N)\n\tINTEGER :: A, B\n\tA = N\n\tB = 0\n", function);
+		text += buffer;
+		for(int statement = 0; statement < PARSE_STATEMENTS; ++statement)
+		{
+			sprintf(buffer, "\tIF (A > %d) THEN\n\t\tB = B + A * %d - (A / 3)\n\tEND IF\n", statement, statement + 1);
+			text += buffer;
+		}
+		sprintf(buffer, "\tF%d = A + B\nEND FUNCTION F%d\n", function, function);
+		text += buffer;
+	}
+	return text;
+}
+
+static pid_t start(const std::vector<std::string> & args, const std::string & input, int error_fd)
+{
+	pid_t pid = fork();
+	if (pid != 0)
+	{
+		return pid;
+	}
+
+	int input_fd = open(input.empty() ? "/dev/null" : input.c_str(), O_RDONLY);
+	int null_fd = open("/dev/null", O_WRONLY);
+	dup2(input_fd, STDIN_FILENO);
+	dup2(null_fd, STDOUT_FILENO);
+	dup2(error_fd >= 0 ? error_fd : null_fd, STDERR_FILENO);
+
+	std::vector<char *> argv;
+	for(size_t index = 0; index < args.size(); ++index)
+	{
+		argv.push_back((char *)args[index].c_str());
+	}
+	argv.push_back(NULL);
+	execv(argv[0], &argv[0]);
+	_exit(127);
+}
+
+static measurement_t run(const std::vector<std::string> & args, const std::string & input)
+{
+	measurement_t result;
+	double started = now();
+	pid_t pid = start(args, input, -1);
+
+	int status = 0;
+	rusage usage;
+	wait4(pid, &status, 0, &usage);
+	result.wall = now() - started;
+	result.peak_rss = usage.ru_maxrss;
+	result.failed = !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+	return result;
+}
+
+// The peak RSS of a child counts the memory of the process it is forked
+// from, exec keeps the peak of the image it replaces. The measured runs are
+// forked by a launcher made before the harness generates its workloads, so
+// that is a process as small as a bare interpreter instead of the harness
+// with a million integers of input.
+static int launcher_requests = -1;
+static int launcher_results = -1;
+
+static bool read_all(int fd, void * data, size_t size)
+{
+	char * bytes = (char *)data;
+	while (size != 0)
+	{
+		ssize_t done = read(fd, bytes, size);
+		if (done <= 0)
+		{
+			return false;
+		}
+		bytes += done;
+		size -= done;
+	}
+	return true;
+}
+
+static void write_all(int fd, const void * data, size_t size)
+{
+	const char * bytes = (const char *)data;
+	while (size != 0)
+	{
+		ssize_t done = write(fd, bytes, size);
+		if (done <= 0)
+		{
+			fprintf(stderr, "the launcher is gone\n");
+			exit(-1);
+		}
+		bytes += done;
+		size -= done;
+	}
+}
+
+static void write_string(int fd, const std::string & text)
+{
+	size_t size = text.size();
+	write_all(fd, &size, sizeof(size));
+	write_all(fd, text.data(), size);
+}
+
+static bool read_string(int fd, std::string & text)
+{
+	size_t size;
+	if (!read_all(fd, &size, sizeof(size)))
+	{
+		return false;
+	}
+	text.resize(size);
+	return size == 0 || read_all(fd, &text[0], size);
+}
+
+// runs what it reads from requests until they are closed: the number of
+// arguments, the arguments and the input
+static void serve(int requests, int results)
+{
+	for(;;)
+	{
+		size_t count;
+		if (!read_all(requests, &count, sizeof(count)))
+		{
+			_exit(0);
+		}
+		std::vector<std::string> args(count);
+		std::string input;
+		for(size_t index = 0; index < count; ++index)
+		{
+			read_string(requests, args[index]);
+		}
+		if (!read_string(requests, input))
+		{
+			_exit(0);
+		}
+		measurement_t result = run(args, input);
+		write_all(results, &result, sizeof(result));
+	}
+}
+
+static void start_launcher()
+{
+	int requests[2];
+	int results[2];
+	if (pipe(requests) != 0 || pipe(results) != 0)
+	{
+		fprintf(stderr, "can't start the launcher\n");
+		exit(-1);
+	}
+	if (fork() == 0)
+	{
+		close(requests[1]);
+		close(results[0]);
+		serve(requests[0], results[1]);
+	}
+	close(requests[0]);
+	close(results[1]);
+	launcher_requests = requests[1];
+	launcher_results = results[0];
+}
+
+static measurement_t measure(const std::vector<std::string> & args, const std::string & input)
+{
+	size_t count = args.size();
+	write_all(launcher_requests, &count, sizeof(count));
+	for(size_t index = 0; index < count; ++index)
+	{
+		write_string(launcher_requests, args[index]);
+	}
+	write_string(launcher_requests, input);
+
+	measurement_t result;
+	if (!read_all(launcher_results, &result, sizeof(result)))
+	{
+		fprintf(stderr, "the launcher is gone\n");
+		exit(-1);
+	}
+	return result;
+}
+
+// reads the totals from the last line of the profile
+static bool count(const std::string & interpreter, const workload_t & workload, const std::string & work, unsigned long long & statements, unsigned long long & calls)
+{
+	std::string profile = work + "/profile.txt";
+	int fd = open(profile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	std::vector<std::string> args;
+	args.push_back(interpreter);
+	args.push_back("--profile");
+	args.push_back(workload.source);
+	pid_t pid = start(args, workload.input, fd);
+	close(fd);
+
+	int status = 0;
+	waitpid(pid, &status, 0);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	{
+		return false;
+	}
+
+	FILE * file = fopen(profile.c_str(), "r");
+	char line[1024];
+	bool found = false;
+	while (file != NULL && fgets(line, sizeof(line), file) != NULL)
+	{
+		found = sscanf(line, "executed %llu statements, %llu calls", &statements, &calls) == 2 || found;
+	}
+	if (file != NULL)
+	{
+		fclose(file);
+	}
+	return found;
+}
+
+int main(int argc, const char * argv[])
+{
+	start_launcher();
+	if (argc < 2)
+	{
+		printf("Usage: %s <interpreter> [--repeat=N] [--format=csv|json] [--engines=tree,tree-nojit,vm,closure,tree-cached]\n", argv[0]);
+		return 0;
+	}
+
+	std::string interpreter = argv[1];
+	int repeat = 3;
+	bool json = false;
+	std::string selected = "tree,tree-nojit,vm,closure,tree-cached";
+	for(int index = 2; index < argc; ++index)
+	{
+		if (!strncmp(argv[index], "--repeat=", 9))
+		{
+			repeat = atoi(argv[index] + 9);
+		}
+		else if (!strcmp(argv[index], "--format=json"))
+		{
+			json = true;
+		}
+		else if (!strcmp(argv[index], "--format=csv"))
+		{
+			json = false;
+		}
+		else if (!strncmp(argv[index], "--engines=", 10))
+		{
+			selected = argv[index] + 10;
+		}
+		else
+		{
+			fprintf(stderr, "unknown option: %s\n", argv[index]);
+			return -1;
+		}
+	}
+	if (repeat < 1)
+	{
+		repeat = 1;
+	}
+
+	char work_template[] = "/tmp/fortran-bench-XXXXXX";
+	if (mkdtemp(work_template) == NULL)
+	{
+		fprintf(stderr, "can't create a work directory\n");
+		return -1;
+	}
+	std::string work = work_template;
+	std::string cache = work + "/cache";
+	mkdir(cache.c_str(), 0755);
+	std::string directory = bench_directory(argv[0]);
+	write_file(work + "/read.in", generate_input());
+	write_file(work + "/parse.f", generate_source());
+
+	std::vector<workload_t> workloads;
+	const char * names[] = { "loops", "calls", "write", "read" };
+	for(size_t index = 0; index < sizeof(names) / sizeof(names[0]); ++index)
+	{
+		workload_t workload;
+		workload.name = names[index];
+		workload.source = directory + "/" + names[index] + ".f";
+		workloads.push_back(workload);
+	}
+	workloads[3].input = work + "/read.in";
+	workload_t parse;
+	parse.name = "parse";
+	parse.source = work + "/parse.f";
+	workloads.push_back(parse);
+
+	if (!json)
+	{
+		printf("workload,engine,wall_s,statements,statements_per_s,calls,calls_per_s,peak_rss_kb\n");
+	}
+
+	int failures = 0;
+	for(size_t index = 0; index < workloads.size(); ++index)
+	{
+		const workload_t & workload = workloads[index];
+		unsigned long long statements = 0;
+		unsigned long long calls = 0;
+		if (!count(interpreter, workload, work, statements, calls))
+		{
+			fprintf(stderr, "%s: the profile run failed\n", workload.name.c_str());
+		}
+
+		for(size_t engine = 0; engine < sizeof(engines) / sizeof(engines[0]); ++engine)
+		{
+			if (("," + selected + ",").find(std::string(",") + engines[engine].name + ",") == std::string::npos)
+			{
+				continue;
+			}
+
+			std::vector<std::string> args;
+			args.push_back(interpreter);
+			if (engines[engine].option != NULL)
+			{
+				args.push_back(engines[engine].option);
+			}
+			if (engines[engine].cached)
+			{
+				args.push_back("--cache=" + cache);
+			}
+			args.push_back(workload.source);
+			if (engines[engine].cached)
+			{
+				measure(args, workload.input);
+			}
+
+			measurement_t best;
+			best.wall = 0;
+			best.peak_rss = 0;
+			best.failed = false;
+			for(int run = 0; run < repeat; ++run)
+			{
+				measurement_t current = measure(args, workload.input);
+				best.wall = run == 0 || current.wall < best.wall ? current.wall : best.wall;
+				best.peak_rss = current.peak_rss > best.peak_rss ? current.peak_rss : best.peak_rss;
+				best.failed = best.failed || current.failed;
+			}
+
+			if (best.failed)
+			{
+				fprintf(stderr, "%s: failed with %s\n", workload.name.c_str(), engines[engine].name);
+				++failures;
+				continue;
+			}
+
+			double statements_rate = best.wall > 0 ? statements / best.wall : 0;
+			double calls_rate = best.wall > 0 ? calls / best.wall : 0;
+			if (json)
+			{
+				printf("{\"workload\": \"%s\", \"engine\": \"%s\", \"wall_s\": %.6f, \"statements\": %llu, \"statements_per_s\": %.0f, "
+					"\"calls\": %llu, \"calls_per_s\": %.0f, \"peak_rss_kb\": %ld}\n",
+					workload.name.c_str(), engines[engine].name, best.wall, statements, statements_rate, calls, calls_rate, best.peak_rss);
+			}
+			else
+			{
+				printf("%s,%s,%.6f,%llu,%.0f,%llu,%.0f,%ld\n",
+					workload.name.c_str(), engines[engine].name, best.wall, statements, statements_rate, calls, calls_rate, best.peak_rss);
+			}
+			fflush(stdout);
+		}
+	}
+
+	unlink((work + "/read.in").c_str());
+	unlink((work + "/parse.f").c_str());
+	unlink((work + "/profile.txt").c_str());
+	DIR * images = opendir(cache.c_str());
+	for(dirent * entry = images != NULL ? readdir(images) : NULL; entry != NULL; entry = readdir(images))
+	{
+		if (entry->d_name[0] != '.')
+		{
+			unlink((cache + "/" + entry->d_name).c_str());
+		}
+	}
+	if (images != NULL)
+	{
+		closedir(images);
+	}
+	rmdir(cache.c_str());
+	rmdir(work.c_str());
+	close(launcher_requests);
+	wait(NULL);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,33 @@
+PROGRAM LOOPS
+	INTEGER :: S
+	S = CALL COUNTED(4000)
+	WRITE "counted: ", S
+	S = CALL CONDITIONAL(4000000)
+	WRITE "conditional: ", S
+END PROGRAM LOOPS
+
+FUNCTION COUNTED(N)
+	INTEGER :: I, J, S
+	S = 0
+	DO I = 1, N
+		DO J = 1, N
+			S = S + I * J - J
+		END DO
+	END DO
+	COUNTED = S
+END FUNCTION COUNTED
+
+FUNCTION CONDITIONAL(N)
+	INTEGER :: K, S
+	K = 0
+	S = 0
+	DO
+		K = K + 1
+		IF (K / 2 * 2 == K) THEN
+			S = S + K / 3
+		ELSE
+			S = S - 1
+		END IF
+	WHILE (K < N)
+	CONDITIONAL = S
+END FUNCTION CONDITIONAL
@@ -0,0 +1,10 @@
+PROGRAM READS
+	INTEGER :: N, I, X, S
+	READ N
+	S = 0
+	DO I = 1, N
+		READ X
+		S = S + X
+	END DO
+	WRITE "sum: ", S
+END PROGRAM READS
@@ -0,0 +1,6 @@
+PROGRAM WRITES
+	INTEGER :: I
+	DO I = 1, 1000000
+		WRITE "line", I, I * 7, 0 - I
+	END DO
+END PROGRAM WRITES
@@ -1,3 +1,34 @@
-#include "syntax_engine.h"
-#include "types.h"
-#include "fortran.tab.hpp"
\ No newline at end of file
+#pragma once
+
+#include <string>
+
+#include "syntax_engine.h"
+#include "types.h"
+#include "fortran.tab.hpp"
+
+// What the grammar actions build, one per parse
+struct parser_state_t
+{
+	program_t * program;
+	method_t * current_method;
+	variable_type current_type;
+	// number of elements of the arrays declared by the current decl_list, 0
+	// for scalars
+	int current_size;
+};
+
+// Reentrant scanner over the text of a program, defined with the lexer
+class scanner_t
+{
+private:
+	yyscan_t scanner;
+
+public:
+	scanner_t(const std::string & source);
+	~scanner_t();
+
+	yyscan_t get()
+	{
+		return scanner;
+	}
+};
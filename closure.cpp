@@ -0,0 +1,867 @@
+#include "closure.h"
+#include "output.h"
+#include "runtime.h"
+#include "operators.h"
+
+// expressions
+
+static int read_local(const closure_expression_t * closure, code_block_t * block)
+{
+	variable_t & var = block->get_variable(variable_slot_t{0, closure->slot.index});
+	if (!var.is_assigned)
+	{
+		raise_error("'%s': using uninitialized variable", closure->name->c_str());
+	}
+	return var.value.int_value;
+}
+
+static int eval_local(const closure_expression_t * closure, code_block_t * block)
+{
+	return read_local(closure, block);
+}
+
+static int eval_constant(const closure_expression_t * closure, code_block_t * block)
+{
+	return closure->constant;
+}
+
+// a field, the frame is found through the parents
+static int eval_variable(const closure_expression_t * closure, code_block_t * block)
+{
+	variable_t & var = block->get_variable(closure->slot);
+	if (!var.is_assigned)
+	{
+		raise_error("'%s': using uninitialized variable", closure->name->c_str());
+	}
+	return var.value.int_value;
+}
+
+// Operands of a binary closure: a local and a constant are read in place,
+// anything else is called
+struct local_operand_t
+{
+	static int get(const closure_expression_t * operand, code_block_t * block)
+	{
+		return read_local(operand, block);
+	}
+};
+
+struct constant_operand_t
+{
+	static int get(const closure_expression_t * operand, code_block_t * block)
+	{
+		return operand->constant;
+	}
+};
+
+struct closure_operand_t
+{
+	static int get(const closure_expression_t * operand, code_block_t * block)
+	{
+		return operand->eval(operand, block);
+	}
+};
+
+template<class operator_t, class left_t, class right_t>
+static int eval_binary(const closure_expression_t * closure, code_block_t * block)
+{
+	int left = left_t::get(closure->left, block);
+	int right = right_t::get(closure->right, block);
+	operator_t::check(left, right, closure->line);
+	return operator_t::apply(left, right);
+}
+
+template<class operator_t, class left_t>
+static closure_eval_t select_binary(const closure_expression_t * right)
+{
+	if (right->eval == eval_local)
+	{
+		return eval_binary<operator_t, left_t, local_operand_t>;
+	}
+	if (right->eval == eval_constant)
+	{
+		return eval_binary<operator_t, left_t, constant_operand_t>;
+	}
+	return eval_binary<operator_t, left_t, closure_operand_t>;
+}
+
+template<class operator_t>
+static closure_eval_t select_binary(const closure_expression_t * left, const closure_expression_t * right)
+{
+	if (left->eval == eval_local)
+	{
+		return select_binary<operator_t, local_operand_t>(right);
+	}
+	if (left->eval == eval_constant)
+	{
+		return select_binary<operator_t, constant_operand_t>(right);
+	}
+	return select_binary<operator_t, closure_operand_t>(right);
+}
+
+static closure_eval_t select_binary(operation type, const closure_expression_t * left, const closure_expression_t * right)
+{
+	switch (type)
+	{
+	case opAdd:
+		return select_binary<add_operator_t>(left, right);
+	case opSub:
+		return select_binary<sub_operator_t>(left, right);
+	case opMul:
+		return select_binary<mul_operator_t>(left, right);
+	case opDiv:
+		return select_binary<div_operator_t>(left, right);
+	case opMod:
+		return select_binary<mod_operator_t>(left, right);
+	case opAnd:
+		return select_binary<and_operator_t>(left, right);
+	case opOr:
+		return select_binary<or_operator_t>(left, right);
+	case opEquals:
+		return select_binary<equals_operator_t>(left, right);
+	case opNotEquals:
+		return select_binary<not_equals_operator_t>(left, right);
+	case opLesser:
+		return select_binary<lesser_operator_t>(left, right);
+	case opGreater:
+		return select_binary<greater_operator_t>(left, right);
+	case opLesserEquals:
+		return select_binary<lesser_equals_operator_t>(left, right);
+	case opGreaterEquals:
+		return select_binary<greater_equals_operator_t>(left, right);
+	default:
+		raise_error("closure: unknown operation %s", to_string(type));
+		return NULL;
+	}
+}
+
+static int eval_and_then(const closure_expression_t * closure, code_block_t * block)
+{
+	return closure->left->eval(closure->left, block) && closure->right->eval(closure->right, block);
+}
+
+static int eval_or_else(const closure_expression_t * closure, code_block_t * block)
+{
+	return closure->left->eval(closure->left, block) || closure->right->eval(closure->right, block);
+}
+
+static int eval_element(const closure_expression_t * closure, code_block_t * block)
+{
+	int position = closure->left->eval(closure->left, block);
+	if (position < 1 || (size_t)position > closure->length)
+	{
+		raise_error_at(closure->line, "index %d is out of bounds of %s", position, closure->name->c_str());
+	}
+	return block->get_array(closure->slot)[position - 1];
+}
+
+static int run_method(const closure_method_t * callee, code_block_t * frame)
+{
+	method_t * method = callee->method;
+	frame->declare_variable(method->get_result_index(), vtInt);
+	callee->body->execute(callee->body, frame);
+	if (method->get_return_type() == vtNoType)
+	{
+		return 0;
+	}
+	return frame->get_variable(variable_slot_t{0, method->get_result_index()}).value.int_value;
+}
+
+// callee of the tail call made last on the thread, code_block_t::tail_method
+// is its method; nothing is called between a tail call and the end of its
+// frame, so one for the thread does
+static thread_local const closure_method_t * tail_callee = NULL;
+
+// runs the tail calls made in the frame, which has been popped, as
+// method_t::run_tail_calls does for the tree walker
+static int run_tail_calls(code_block_t * frame)
+{
+	frame_stack_t * stack = frame->stack;
+	int result = 0;
+	while (frame->tail_method != NULL)
+	{
+		const closure_method_t * callee = tail_callee;
+		method_t * method = callee->method;
+		*frame = code_block_t(frame->parent, frame->runtime, stack, stack->push(method->get_frame_size()), method->get_frame_size(), stack->push_arrays(method->get_array_area_size()));
+		for(size_t index = 0; index < method->get_arguments_count(); ++index)
+		{
+			frame->declare_set_variable(index, stack->tail_arguments[index]);
+		}
+
+		result = run_method(callee, frame);
+		stack->pop_arrays(method->get_array_area_size());
+		stack->pop(method->get_frame_size());
+	}
+	return result;
+}
+
+// the caller's frame is done once the arguments are in, the frame that
+// made the call runs it in its place; the value returned is not read
+static int eval_tail_call(const closure_expression_t * closure, code_block_t * block)
+{
+	// calls among the arguments may make tail calls of their own
+	variant_t args[TAIL_CALL_MAX_ARGUMENTS];
+	for(size_t index = 0; index < closure->arguments.size(); ++index)
+	{
+		args[index].type = vtInt;
+		args[index].int_value = closure->arguments[index]->eval(closure->arguments[index], block);
+	}
+	std::copy(args, args + closure->arguments.size(), block->stack->tail_arguments);
+	block->tail_method = closure->callee->method;
+	tail_callee = closure->callee;
+	return 0;
+}
+
+// arguments are evaluated in the caller's frame, nested calls push and pop
+// their frames above the one being filled
+static int eval_call(const closure_expression_t * closure, code_block_t * block)
+{
+	check_native_stack();
+
+	method_t * method = closure->callee->method;
+	frame_stack_t * stack = block->stack;
+	code_block_t frame(block->get_root(), block->runtime, stack, stack->push(method->get_frame_size()), method->get_frame_size(), stack->push_arrays(method->get_array_area_size()));
+	for(size_t index = 0; index < closure->arguments.size(); ++index)
+	{
+		variant_t value;
+		value.type = vtInt;
+		value.int_value = closure->arguments[index]->eval(closure->arguments[index], block);
+		frame.declare_set_variable(index, value);
+	}
+
+	int result = run_method(closure->callee, &frame);
+	stack->pop_arrays(method->get_array_area_size());
+	stack->pop(method->get_frame_size());
+	if (frame.tail_method != NULL)
+	{
+		result = run_tail_calls(&frame);
+	}
+	return result;
+}
+
+// slot is the first argument, the result follows the arguments
+static int eval_inlined_call(const closure_expression_t * closure, code_block_t * block)
+{
+	for(size_t index = 0; index < closure->arguments.size(); ++index)
+	{
+		variant_t value;
+		value.type = vtInt;
+		value.int_value = closure->arguments[index]->eval(closure->arguments[index], block);
+		block->declare_set_variable(closure->slot.index + index, value);
+	}
+
+	size_t result_index = closure->slot.index + closure->arguments.size();
+	block->declare_variable(result_index, vtInt);
+	closure->body->execute(closure->body, block);
+	if (closure->callee->method->get_return_type() == vtNoType)
+	{
+		return 0;
+	}
+	return block->get_variable(variable_slot_t{0, result_index}).value.int_value;
+}
+
+static int eval_tree_int(const closure_expression_t * closure, code_block_t * block)
+{
+	return closure->node->eval(block).int_value;
+}
+
+static int eval_tree_bool(const closure_expression_t * closure, code_block_t * block)
+{
+	return closure->node->eval(block).bool_value;
+}
+
+// statements
+
+static flow_interruption_type execute_list(const closure_statement_t * closure, code_block_t * block)
+{
+	for(size_t index = 0; index < closure->statements.size(); ++index)
+	{
+		closure_statement_t * statement = closure->statements[index];
+		flow_interruption_type result = statement->execute(statement, block);
+		if (result != fitNoIterruption)
+		{
+			return result;
+		}
+	}
+	return fitNoIterruption;
+}
+
+static flow_interruption_type execute_declaration(const closure_statement_t * closure, code_block_t * block)
+{
+	block->declare_variable(closure->slot.index, closure->type);
+	return fitNoIterruption;
+}
+
+static flow_interruption_type execute_assign(const closure_statement_t * closure, code_block_t * block)
+{
+	variant_t value;
+	value.type = closure->type;
+	value.int_value = closure->operands[0]->eval(closure->operands[0], block);
+	block->store_variable(closure->slot, value);
+	return fitNoIterruption;
+}
+
+static flow_interruption_type execute_assign_element(const closure_statement_t * closure, code_block_t * block)
+{
+	int position = closure->operands[0]->eval(closure->operands[0], block);
+	if (position < 1 || (size_t)position > closure->length)
+	{
+		raise_error_at(closure->line, "index %d is out of bounds of %s", position, closure->name->c_str());
+	}
+
+	int element = closure->operands[1]->eval(closure->operands[1], block);
+	block->get_array(closure->slot)[position - 1] = element;
+	return fitNoIterruption;
+}
+
+static flow_interruption_type execute_write(const closure_statement_t * closure, code_block_t * block)
+{
+	output_buffer_t & output = block->runtime->output;
+	for(size_t index = 0; index < closure->items.size(); ++index)
+	{
+		const closure_write_item_t & item = closure->items[index];
+		if (item.message != NULL)
+		{
+			output.write(item.message->c_str());
+		}
+		else if (item.is_bool)
+		{
+			output.write_bool(item.value->eval(item.value, block) != 0);
+		}
+		else
+		{
+			output.write_int(item.value->eval(item.value, block));
+		}
+	}
+	output.end_line();
+	return fitNoIterruption;
+}
+
+static flow_interruption_type execute_return(const closure_statement_t * closure, code_block_t * block)
+{
+	return fitReturn;
+}
+
+static flow_interruption_type execute_break(const closure_statement_t * closure, code_block_t * block)
+{
+	return fitBreak;
+}
+
+static flow_interruption_type execute_cycle(const closure_statement_t * closure, code_block_t * block)
+{
+	return fitCycle;
+}
+
+static flow_interruption_type execute_if(const closure_statement_t * closure, code_block_t * block)
+{
+	if (closure->operands[0]->eval(closure->operands[0], block))
+	{
+		return closure->bodies[0]->execute(closure->bodies[0], block);
+	}
+	return fitNoIterruption;
+}
+
+static flow_interruption_type execute_if_else(const closure_statement_t * closure, code_block_t * block)
+{
+	closure_statement_t * way = closure->bodies[closure->operands[0]->eval(closure->operands[0], block) ? 0 : 1];
+	return way->execute(way, block);
+}
+
+static flow_interruption_type execute_while(const closure_statement_t * closure, code_block_t * block)
+{
+	closure_expression_t * condition = closure->operands[0];
+	closure_statement_t * body = closure->bodies[0];
+	do
+	{
+		// CYCLE goes on to the condition
+		flow_interruption_type result = body->execute(body, block);
+		if (result == fitReturn)
+		{
+			return fitReturn;
+		}
+		if (result == fitBreak)
+		{
+			break;
+		}
+	} while (condition->eval(condition, block));
+	return fitNoIterruption;
+}
+
+static flow_interruption_type execute_do(const closure_statement_t * closure, code_block_t * block)
+{
+	int value = closure->operands[0]->eval(closure->operands[0], block);
+	int last_value = closure->operands[1]->eval(closure->operands[1], block);
+	int step_value = closure->operands[2] != NULL ? closure->operands[2]->eval(closure->operands[2], block) : 1;
+
+	variable_t & var = block->get_variable(closure->slot);
+	var.is_assigned = true;
+	var.value.int_value = value;
+
+	unsigned int remaining;
+	if (!do_loop_count(value, last_value, step_value, remaining))
+	{
+		return fitNoIterruption;
+	}
+
+	closure_statement_t * body = closure->bodies[0];
+	for(;;)
+	{
+		flow_interruption_type result = body->execute(body, block);
+		if (result == fitReturn)
+		{
+			return fitReturn;
+		}
+		if (result == fitBreak)
+		{
+			break;
+		}
+
+		value = (int)((unsigned int)value + (unsigned int)step_value);
+		var.value.int_value = value;
+		if (remaining-- == 0)
+		{
+			break;
+		}
+	}
+	return fitNoIterruption;
+}
+
+static flow_interruption_type execute_expression(const closure_statement_t * closure, code_block_t * block)
+{
+	closure->operands[0]->eval(closure->operands[0], block);
+	return fitNoIterruption;
+}
+
+static flow_interruption_type execute_tree(const closure_statement_t * closure, code_block_t * block)
+{
+	return closure->node->execute(block);
+}
+
+// closure_engine_t
+
+closure_engine_t::closure_engine_t()
+{
+	program = NULL;
+	main = NULL;
+}
+
+closure_engine_t::~closure_engine_t()
+{
+	for(size_t index = 0; index < expressions.size(); ++index)
+	{
+		delete expressions[index];
+	}
+	for(size_t index = 0; index < statements.size(); ++index)
+	{
+		delete statements[index];
+	}
+	for(auto it = methods.begin(); it != methods.end(); ++it)
+	{
+		delete it->second;
+	}
+	delete main;
+}
+
+closure_expression_t * closure_engine_t::add_expression(closure_eval_t eval)
+{
+	closure_expression_t * closure = new closure_expression_t();
+	closure->eval = eval;
+	closure->constant = 0;
+	closure->slot = variable_slot_t{0, 0};
+	closure->length = 0;
+	closure->line = 0;
+	closure->name = NULL;
+	closure->left = NULL;
+	closure->right = NULL;
+	closure->callee = NULL;
+	closure->body = NULL;
+	closure->node = NULL;
+	expressions.push_back(closure);
+	return closure;
+}
+
+closure_statement_t * closure_engine_t::add_statement(closure_execute_t execute)
+{
+	closure_statement_t * closure = new closure_statement_t();
+	closure->execute = execute;
+	closure->slot = variable_slot_t{0, 0};
+	closure->type = vtNoType;
+	closure->length = 0;
+	closure->line = 0;
+	closure->name = NULL;
+	closure->operands[0] = closure->operands[1] = closure->operands[2] = NULL;
+	closure->bodies[0] = closure->bodies[1] = NULL;
+	closure->node = NULL;
+	statements.push_back(closure);
+	return closure;
+}
+
+closure_method_t * closure_engine_t::get_method(method_t * method)
+{
+	auto it = methods.find(method);
+	return it != methods.end() ? it->second : NULL;
+}
+
+// the methods are known before any body is compiled, so calls can refer to
+// methods compiled after them
+void closure_engine_t::load(program_t * program)
+{
+	this->program = program;
+	const std::map<std::string, method_t *> & program_methods = program->get_methods();
+	for(auto it = program_methods.begin(); it != program_methods.end(); ++it)
+	{
+		closure_method_t * method = new closure_method_t();
+		method->method = it->second;
+		method->body = NULL;
+		methods.insert(std::make_pair(it->second, method));
+	}
+	main = new closure_method_t();
+	main->method = program->get_main();
+	main->body = NULL;
+
+	closure_compiler_t compiler(this);
+	for(auto it = methods.begin(); it != methods.end(); ++it)
+	{
+		it->second->body = compiler.compile(it->second->method);
+	}
+	main->body = compiler.compile(main->method);
+}
+
+void closure_engine_t::run(runtime_t * runtime)
+{
+	current_runtime_t current(runtime);
+	size_t class_frame_size = program->get_class_frame_size();
+	frame_stack_t stack(STACK_SIZE, ARRAY_STACK_SIZE);
+	code_block_t class_block(NULL, runtime, &stack, stack.push(class_frame_size), class_frame_size);
+	program->get_fields_declaration()->execute(&class_block);
+
+	method_t * method = main->method;
+	code_block_t main_block(&class_block, runtime, &stack, stack.push(method->get_frame_size()), method->get_frame_size(), stack.push_arrays(method->get_array_area_size()));
+	run_method(main, &main_block);
+}
+
+// closure_compiler_t
+
+closure_compiler_t::closure_compiler_t(closure_engine_t * engine)
+{
+	this->engine = engine;
+	expression = NULL;
+	type = vtNoType;
+	statement = NULL;
+}
+
+closure_statement_t * closure_compiler_t::compile(method_t * method)
+{
+	return compile_statement(method->get_body());
+}
+
+closure_expression_t * closure_compiler_t::compile_expression(expression_t * expr, variable_type * type)
+{
+	expr->accept(this);
+	if (type != NULL)
+	{
+		*type = this->type;
+	}
+	return expression;
+}
+
+closure_statement_t * closure_compiler_t::compile_statement(statement_t * stmt)
+{
+	stmt->accept(this);
+	return statement;
+}
+
+void closure_compiler_t::fall_back(expression_t * node, variable_type type)
+{
+	expression = engine->add_expression(type == vtBool ? eval_tree_bool : eval_tree_int);
+	expression->node = node;
+	this->type = type;
+}
+
+void closure_compiler_t::fall_back(statement_t * node)
+{
+	statement = engine->add_statement(execute_tree);
+	statement->node = node;
+}
+
+// statements
+
+void closure_compiler_t::visit(statement_list_t * node)
+{
+	closure_statement_t * list = engine->add_statement(execute_list);
+	for(size_t index = 0; index < node->size(); ++index)
+	{
+		list->statements.push_back(compile_statement(node->get_at(index)));
+	}
+	statement = list;
+}
+
+void closure_compiler_t::visit(code_block_statement_t * node)
+{
+	node->get_body()->accept(this);
+}
+
+void closure_compiler_t::visit(declaration_t * node)
+{
+	statement = engine->add_statement(execute_declaration);
+	statement->slot = variable_slot_t{0, node->get_index()};
+	statement->type = node->get_type();
+}
+
+void closure_compiler_t::visit(assignment_t * node)
+{
+	if (node->get_array_size() != 0)
+	{
+		fall_back(node);
+		return;
+	}
+
+	variable_type value_type;
+	closure_expression_t * value = compile_expression(node->get_value(), &value_type);
+	statement = engine->add_statement(execute_assign);
+	statement->slot = node->get_slot();
+	statement->type = value_type;
+	statement->operands[0] = value;
+}
+
+void closure_compiler_t::visit(read_statement_t * node)
+{
+	fall_back(node);
+}
+
+void closure_compiler_t::visit(write_statement_t * node)
+{
+	write_arguments_t * args = node->get_args();
+	std::vector<closure_write_item_t> items;
+	for(size_t index = 0; index < args->size(); ++index)
+	{
+		closure_write_item_t item;
+		item.message = NULL;
+		item.value = NULL;
+		item.is_bool = false;
+		if (args->is_message(index))
+		{
+			item.message = &args->get_message(index);
+		}
+		else if (args->get_array_size(index) != 0)
+		{
+			fall_back(node);
+			return;
+		}
+		else
+		{
+			variable_type value_type;
+			item.value = compile_expression(args->get_expression(index), &value_type);
+			item.is_bool = value_type == vtBool;
+		}
+		items.push_back(item);
+	}
+
+	statement = engine->add_statement(execute_write);
+	statement->items = items;
+}
+
+void closure_compiler_t::visit(return_statement_t * node)
+{
+	statement = engine->add_statement(execute_return);
+}
+
+void closure_compiler_t::visit(conditional_statement_t * node)
+{
+	closure_expression_t * condition = compile_expression(node->get_condition());
+	closure_statement_t * true_way = compile_statement(node->get_true_way());
+	closure_statement_t * false_way = NULL;
+	if (node->get_false_way() != NULL)
+	{
+		false_way = compile_statement(node->get_false_way());
+	}
+
+	statement = engine->add_statement(false_way != NULL ? execute_if_else : execute_if);
+	statement->operands[0] = condition;
+	statement->bodies[0] = true_way;
+	statement->bodies[1] = false_way;
+}
+
+void closure_compiler_t::visit(while_statement_t * node)
+{
+	closure_statement_t * body = compile_statement(node->get_body());
+	closure_expression_t * condition = compile_expression(node->get_condition());
+
+	statement = engine->add_statement(execute_while);
+	statement->operands[0] = condition;
+	statement->bodies[0] = body;
+}
+
+// DO CONCURRENT keeps its tree, which runs the chunks on the pool
+void closure_compiler_t::visit(do_statement_t * node)
+{
+	if (dynamic_cast<do_concurrent_statement_t *>(node) != NULL)
+	{
+		fall_back(node);
+		return;
+	}
+
+	closure_expression_t * first = compile_expression(node->get_first());
+	closure_expression_t * last = compile_expression(node->get_last());
+	closure_expression_t * step = node->get_step() != NULL ? compile_expression(node->get_step()) : NULL;
+	closure_statement_t * body = compile_statement(node->get_body());
+
+	statement = engine->add_statement(execute_do);
+	statement->slot = node->get_slot();
+	statement->operands[0] = first;
+	statement->operands[1] = last;
+	statement->operands[2] = step;
+	statement->bodies[0] = body;
+}
+
+void closure_compiler_t::visit(break_statement_t * node)
+{
+	statement = engine->add_statement(execute_break);
+}
+
+void closure_compiler_t::visit(cycle_statement_t * node)
+{
+	statement = engine->add_statement(execute_cycle);
+}
+
+void closure_compiler_t::visit(invoke_statement_t * node)
+{
+	closure_expression_t * invokee = compile_expression(node->get_invokee());
+	statement = engine->add_statement(execute_expression);
+	statement->operands[0] = invokee;
+}
+
+void closure_compiler_t::visit(array_declaration_t * node)
+{
+	fall_back(node);
+}
+
+void closure_compiler_t::visit(element_assignment_t * node)
+{
+	closure_expression_t * index = compile_expression(node->get_index());
+	closure_expression_t * value = compile_expression(node->get_value());
+
+	statement = engine->add_statement(execute_assign_element);
+	statement->slot = node->get_slot();
+	statement->length = node->get_length();
+	statement->line = node->get_line();
+	statement->name = &node->get_id();
+	statement->operands[0] = index;
+	statement->operands[1] = value;
+}
+
+// expressions
+
+void closure_compiler_t::visit(constant_t * node)
+{
+	variant_t value = node->get_value();
+	expression = engine->add_expression(eval_constant);
+	expression->constant = value.type == vtBool ? value.bool_value : value.int_value;
+	type = value.type;
+}
+
+void closure_compiler_t::visit(variable_expression_t * node)
+{
+	if (node->get_array_size() != 0)
+	{
+		fall_back(node, vtArray);
+		return;
+	}
+
+	variable_slot_t slot = node->get_slot();
+	expression = engine->add_expression(slot.depth == 0 ? eval_local : eval_variable);
+	expression->slot = slot;
+	expression->name = &node->get_id();
+	type = vtInt;
+}
+
+void closure_compiler_t::visit(binary_expression_t * node)
+{
+	if (node->get_array_size() != 0)
+	{
+		fall_back(node, vtArray);
+		return;
+	}
+
+	closure_expression_t * left = compile_expression(node->get_left());
+	closure_expression_t * right = compile_expression(node->get_right());
+
+	operation operation_type = node->get_operation();
+	expression = engine->add_expression(select_binary(operation_type, left, right));
+	expression->left = left;
+	expression->right = right;
+	expression->line = node->get_line();
+	switch (operation_type)
+	{
+	case opAdd:
+	case opSub:
+	case opMul:
+	case opDiv:
+	case opMod:
+		type = vtInt;
+		break;
+	default:
+		type = vtBool;
+		break;
+	}
+}
+
+void closure_compiler_t::visit(short_circuit_expression_t * node)
+{
+	closure_expression_t * left = compile_expression(node->get_left());
+	closure_expression_t * right = compile_expression(node->get_right());
+
+	expression = engine->add_expression(node->get_operation() == opAnd ? eval_and_then : eval_or_else);
+	expression->left = left;
+	expression->right = right;
+	type = vtBool;
+}
+
+void closure_compiler_t::visit(invocation_expression_t * node)
+{
+	closure_method_t * callee = engine->get_method(node->get_method());
+	parameter_list_t * params = node->get_params();
+
+	std::vector<closure_expression_t *> arguments;
+	for(size_t index = 0; index < params->size(); ++index)
+	{
+		arguments.push_back(compile_expression(params->get_at(index)));
+	}
+
+	if (node->get_inline_body() != NULL)
+	{
+		closure_statement_t * body = compile_statement(node->get_inline_body());
+		expression = engine->add_expression(eval_inlined_call);
+		expression->slot = variable_slot_t{0, node->get_inline_arguments_index()};
+		expression->body = body;
+	}
+	else if (node->is_tail_call())
+	{
+		expression = engine->add_expression(eval_tail_call);
+	}
+	else
+	{
+		expression = engine->add_expression(eval_call);
+	}
+	expression->callee = callee;
+	expression->arguments = arguments;
+	type = vtInt;
+}
+
+void closure_compiler_t::visit(element_expression_t * node)
+{
+	closure_expression_t * index = compile_expression(node->get_index());
+
+	expression = engine->add_expression(eval_element);
+	expression->left = index;
+	expression->slot = node->get_slot();
+	expression->length = node->get_length();
+	expression->line = node->get_line();
+	expression->name = &node->get_id();
+	type = vtInt;
+}
+
+void closure_compiler_t::visit(reduction_expression_t * node)
+{
+	fall_back(node, vtInt);
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "syntax_engine.h"
+
+// Closure-compiled execution (--engine=closure). Every node of a checked
+// tree becomes a closure: a function picked for the kind of the node and
+// of its operands, with the operands it needs packed next to it. A binary
+// operation on a local and a constant gets a function that reads the slot
+// and applies its operator in place, so there is no switch on the operation
+// and no virtual call per operand. The frames are those of the tree walker,
+// which runs the nodes without a closure of their own (whole arrays, READ,
+// DO CONCURRENT, SUM) from inside the compiled code.
+
+struct closure_expression_t;
+struct closure_statement_t;
+struct closure_method_t;
+
+// a boolean result is 0 or 1
+typedef int (*closure_eval_t)(const closure_expression_t * closure, code_block_t * block);
+typedef flow_interruption_type (*closure_execute_t)(const closure_statement_t * closure, code_block_t * block);
+
+// Which fields are used depends on the function
+struct closure_expression_t
+{
+	closure_eval_t eval;
+	int constant;
+	variable_slot_t slot;
+	// number of elements of an indexed array
+	size_t length;
+	int line;
+	const std::string * name;
+	closure_expression_t * left;
+	closure_expression_t * right;
+	closure_method_t * callee;
+	std::vector<closure_expression_t *> arguments;
+	// copy of the callee's body inlined into the call
+	closure_statement_t * body;
+	// run by the tree walker
+	expression_t * node;
+};
+
+struct closure_write_item_t
+{
+	// NULL for a value
+	const std::string * message;
+	closure_expression_t * value;
+	bool is_bool;
+};
+
+struct closure_statement_t
+{
+	closure_execute_t execute;
+	variable_slot_t slot;
+	variable_type type;
+	size_t length;
+	int line;
+	const std::string * name;
+	// value, condition or first bound, then last bound and step
+	closure_expression_t * operands[3];
+	// body or true way, then false way
+	closure_statement_t * bodies[2];
+	std::vector<closure_statement_t *> statements;
+	std::vector<closure_write_item_t> items;
+	// run by the tree walker
+	statement_t * node;
+};
+
+struct closure_method_t
+{
+	method_t * method;
+	closure_statement_t * body;
+};
+
+class closure_engine_t
+{
+private:
+	program_t * program;
+	std::map<method_t *, closure_method_t *> methods;
+	closure_method_t * main;
+	std::vector<closure_expression_t *> expressions;
+	std::vector<closure_statement_t *> statements;
+
+public:
+	closure_engine_t();
+	~closure_engine_t();
+
+	// the program has to be checked, the closures refer to its nodes
+	void load(program_t * program);
+	// the closures are not changed by a run, so several may go on at once
+	void run(runtime_t * runtime);
+
+	closure_method_t * get_method(method_t * method);
+	closure_expression_t * add_expression(closure_eval_t eval);
+	closure_statement_t * add_statement(closure_execute_t execute);
+};
+
+class closure_compiler_t : public ast_visitor_t
+{
+private:
+	closure_engine_t * engine;
+	// result of the node visited last
+	closure_expression_t * expression;
+	variable_type type;
+	closure_statement_t * statement;
+
+	closure_expression_t * compile_expression(expression_t * expr, variable_type * type = NULL);
+	closure_statement_t * compile_statement(statement_t * stmt);
+	void fall_back(expression_t * node, variable_type type);
+	void fall_back(statement_t * node);
+
+public:
+	closure_compiler_t(closure_engine_t * engine);
+
+	closure_statement_t * compile(method_t * method);
+
+	void visit(statement_list_t * node);
+	void visit(code_block_statement_t * node);
+	void visit(declaration_t * node);
+	void visit(assignment_t * node);
+	void visit(read_statement_t * node);
+	void visit(write_statement_t * node);
+	void visit(return_statement_t * node);
+	void visit(conditional_statement_t * node);
+	void visit(while_statement_t * node);
+	void visit(do_statement_t * node);
+	void visit(break_statement_t * node);
+	void visit(cycle_statement_t * node);
+	void visit(invoke_statement_t * node);
+	void visit(constant_t * node);
+	void visit(variable_expression_t * node);
+	void visit(binary_expression_t * node);
+	void visit(short_circuit_expression_t * node);
+	void visit(invocation_expression_t * node);
+	void visit(array_declaration_t * node);
+	void visit(element_expression_t * node);
+	void visit(element_assignment_t * node);
+	void visit(reduction_expression_t * node);
+};
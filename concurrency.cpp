@@ -0,0 +1,341 @@
+#include <cstdint>
+
+#include "concurrency.h"
+
+// set while the thread runs chunks of a loop
+static thread_local bool inside_task = false;
+
+// sets inside_task for the lifetime of the object, an error trapped by the
+// run leaves through it
+class inside_task_t
+{
+private:
+	bool outer;
+
+public:
+	inside_task_t()
+	{
+		outer = inside_task;
+		inside_task = true;
+	}
+
+	~inside_task_t()
+	{
+		inside_task = outer;
+	}
+};
+
+// thread_pool_t
+
+thread_pool_t::thread_pool_t(size_t size)
+{
+	task = NULL;
+	remaining = 0;
+	failed_chunk = SIZE_MAX;
+	generation = 0;
+	stopping = false;
+	if (size == 0)
+	{
+		size = 1;
+	}
+
+	for(size_t index = 0; index < size; ++index)
+	{
+		queues.push_back(new queue_t);
+	}
+}
+
+thread_pool_t::~thread_pool_t()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for(size_t index = 0; index < threads.size(); ++index)
+	{
+		threads[index].join();
+	}
+	for(size_t index = 0; index < queues.size(); ++index)
+	{
+		delete queues[index];
+	}
+}
+
+bool thread_pool_t::is_inside_task()
+{
+	return inside_task;
+}
+
+bool thread_pool_t::take(size_t thread, size_t & chunk)
+{
+	{
+		queue_t * own = queues[thread];
+		std::lock_guard<std::mutex> guard(own->lock);
+		if (!own->chunks.empty())
+		{
+			chunk = own->chunks.back();
+			own->chunks.pop_back();
+			return true;
+		}
+	}
+
+	for(size_t offset = 1; offset < queues.size(); ++offset)
+	{
+		queue_t * victim = queues[(thread + offset) % queues.size()];
+		std::lock_guard<std::mutex> guard(victim->lock);
+		if (!victim->chunks.empty())
+		{
+			chunk = victim->chunks.front();
+			victim->chunks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+// the task is set before the chunks are queued, so a thread that takes a
+// chunk under the queue lock sees the task it belongs to
+void thread_pool_t::execute(size_t thread)
+{
+	inside_task_t inside;
+	size_t chunk;
+	while (take(thread, chunk))
+	{
+		try
+		{
+			if (chunk < failed_chunk)
+			{
+				(*task)(thread, chunk);
+			}
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (chunk < failed_chunk)
+			{
+				error = std::current_exception();
+				failed_chunk = chunk;
+			}
+		}
+		if (remaining.fetch_sub(1) == 1)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			done.notify_all();
+		}
+	}
+}
+
+void thread_pool_t::work(size_t thread)
+{
+	unsigned long long seen = 0;
+	for(;;)
+	{
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			while (!stopping && generation == seen)
+			{
+				wake.wait(guard);
+			}
+			if (stopping)
+			{
+				return;
+			}
+			seen = generation;
+		}
+		execute(thread);
+	}
+}
+
+void thread_pool_t::run(size_t chunks_count, const chunk_function_t & function)
+{
+	std::unique_lock<std::mutex> owner(busy, std::defer_lock);
+	if (queues.size() == 1 || chunks_count < 2 || inside_task || !owner.try_lock())
+	{
+		inside_task_t inside;
+		for(size_t chunk = 0; chunk < chunks_count; ++chunk)
+		{
+			function(0, chunk);
+		}
+		return;
+	}
+
+	// the loop holds the pool, so only one starts the threads
+	if (threads.empty())
+	{
+		for(size_t index = 1; index < queues.size(); ++index)
+		{
+			threads.push_back(std::thread(&thread_pool_t::work, this, index));
+		}
+	}
+
+	task = &function;
+	remaining = chunks_count;
+	// every thread starts with a range of neighbouring chunks
+	for(size_t thread = 0; thread < queues.size(); ++thread)
+	{
+		std::lock_guard<std::mutex> guard(queues[thread]->lock);
+		size_t begin = thread * chunks_count / queues.size();
+		size_t end = (thread + 1) * chunks_count / queues.size();
+		for(size_t chunk = begin; chunk < end; ++chunk)
+		{
+			queues[thread]->chunks.push_back(chunk);
+		}
+	}
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		++generation;
+	}
+	wake.notify_all();
+
+	execute(0);
+
+	std::unique_lock<std::mutex> guard(lock);
+	while (remaining != 0)
+	{
+		done.wait(guard);
+	}
+	if (failed_chunk != SIZE_MAX)
+	{
+		std::exception_ptr chunk_error = error;
+		error = std::exception_ptr();
+		failed_chunk = SIZE_MAX;
+		std::rethrow_exception(chunk_error);
+	}
+}
+
+// concurrent_body_checker_t
+
+concurrent_body_checker_t::concurrent_body_checker_t()
+{
+	depth = 0;
+}
+
+void concurrent_body_checker_t::check_assigned(statement_t * node, const std::string & ID, variable_slot_t slot)
+{
+	if (slot.depth != 0 || declared.find(slot.index) == declared.end())
+	{
+		raise_error_at(node->get_line(), "'%s': a variable declared outside of DO CONCURRENT can't be assigned in it", ID.c_str());
+	}
+}
+
+void concurrent_body_checker_t::visit(statement_list_t * node)
+{
+	for(size_t index = 0; index < node->size(); ++index)
+	{
+		node->get_at(index)->accept(this);
+	}
+}
+
+void concurrent_body_checker_t::visit(code_block_statement_t * node)
+{
+	node->get_body()->accept(this);
+}
+
+void concurrent_body_checker_t::visit(declaration_t * node)
+{
+	declared.insert(node->get_index());
+}
+
+// arrays are shared by the iterations, an element or a whole one may be
+// assigned
+void concurrent_body_checker_t::visit(assignment_t * node)
+{
+	if (node->get_array_size() == 0)
+	{
+		check_assigned(node, node->get_id(), node->get_slot());
+	}
+}
+
+void concurrent_body_checker_t::visit(read_statement_t * node)
+{
+	raise_error_at(node->get_line(), "READ is not allowed in DO CONCURRENT");
+}
+
+void concurrent_body_checker_t::visit(write_statement_t * node)
+{
+}
+
+void concurrent_body_checker_t::visit(return_statement_t * node)
+{
+	raise_error_at(node->get_line(), "RETURN is not allowed in DO CONCURRENT");
+}
+
+void concurrent_body_checker_t::visit(conditional_statement_t * node)
+{
+	node->get_true_way()->accept(this);
+	if (node->get_false_way() != NULL)
+	{
+		node->get_false_way()->accept(this);
+	}
+}
+
+void concurrent_body_checker_t::visit(while_statement_t * node)
+{
+	++depth;
+	node->get_body()->accept(this);
+	--depth;
+}
+
+void concurrent_body_checker_t::visit(do_statement_t * node)
+{
+	if (dynamic_cast<do_concurrent_statement_t *>(node) == NULL)
+	{
+		check_assigned(node, node->get_id(), node->get_slot());
+	}
+	++depth;
+	node->get_body()->accept(this);
+	--depth;
+}
+
+void concurrent_body_checker_t::visit(break_statement_t * node)
+{
+	if (depth == 0)
+	{
+		raise_error_at(node->get_line(), "EXIT is not allowed in DO CONCURRENT");
+	}
+}
+
+void concurrent_body_checker_t::visit(cycle_statement_t * node)
+{
+}
+
+void concurrent_body_checker_t::visit(invoke_statement_t * node)
+{
+}
+
+void concurrent_body_checker_t::visit(constant_t * node)
+{
+}
+
+void concurrent_body_checker_t::visit(variable_expression_t * node)
+{
+}
+
+void concurrent_body_checker_t::visit(binary_expression_t * node)
+{
+}
+
+void concurrent_body_checker_t::visit(short_circuit_expression_t * node)
+{
+}
+
+void concurrent_body_checker_t::visit(invocation_expression_t * node)
+{
+}
+
+void concurrent_body_checker_t::visit(array_declaration_t * node)
+{
+}
+
+void concurrent_body_checker_t::visit(element_expression_t * node)
+{
+}
+
+void concurrent_body_checker_t::visit(element_assignment_t * node)
+{
+}
+
+void concurrent_body_checker_t::visit(reduction_expression_t * node)
+{
+}
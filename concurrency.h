@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "syntax_engine.h"
+
+// Parallel execution of DO CONCURRENT by the tree walker. The iterations are
+// split into chunks of consecutive indices, every chunk runs on a private
+// copy of the frame of the loop (arrays stay shared) and its WRITE output is
+// kept apart, so the output comes out in the order of a sequential run. An
+// error of a chunk is raised on the thread that started the loop, after the
+// output a sequential run would have written before it.
+
+// Chunks per pool thread a loop is split into, more of them let the pool
+// even out iterations of different cost
+const size_t CONCURRENT_CHUNKS_PER_THREAD = 8;
+
+// Number of variable slots available to the frames of a pool thread
+const size_t CONCURRENT_STACK_SIZE = 1 << 18;
+
+// Runs a chunk, thread 0 is the one that started the loop
+typedef std::function<void(size_t thread, size_t chunk)> chunk_function_t;
+
+// Work-stealing pool: every thread owns a deque of chunks, takes its work
+// from the back of its own one and steals from the front of the others when
+// it runs dry. The thread starting a loop works as well, so a pool of size N
+// has N - 1 threads of its own; they start with the first loop the pool
+// runs, a program without DO CONCURRENT starts none.
+class thread_pool_t
+{
+private:
+	struct queue_t
+	{
+		std::mutex lock;
+		std::deque<size_t> chunks;
+	};
+
+	std::vector<std::thread> threads;
+	std::vector<queue_t *> queues;
+	const chunk_function_t * task;
+	std::atomic<size_t> remaining;
+	// error of the lowest failed chunk, the one a sequential run would have
+	// stopped at, the chunks after it are skipped
+	std::atomic<size_t> failed_chunk;
+	std::exception_ptr error;
+	// held by the loop the pool works on
+	std::mutex busy;
+
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+	unsigned long long generation;
+	bool stopping;
+
+	bool take(size_t thread, size_t & chunk);
+	void execute(size_t thread);
+	void work(size_t thread);
+
+public:
+	thread_pool_t(size_t size);
+	~thread_pool_t();
+
+	size_t size()
+	{
+		return queues.size();
+	}
+
+	// returns when every chunk is done and rethrows the error of a failed
+	// chunk. A loop started from inside a chunk, or while another run keeps
+	// the pool busy, runs on the calling thread alone.
+	void run(size_t chunks_count, const chunk_function_t & function);
+
+	// true while the calling thread runs a chunk
+	static bool is_inside_task();
+};
+
+// Rejects the statements DO CONCURRENT can't run in any order: READ, RETURN,
+// an EXIT or BREAK leaving the concurrent loop and the assignment of a
+// scalar declared outside of the body, the loop variable included, as every
+// engine would give it a different value. The index of a DO CONCURRENT is
+// the loop's own, the variable of the same name keeps its value.
+class concurrent_body_checker_t : public ast_visitor_t
+{
+private:
+	// loops entered inside the body
+	int depth;
+	// slots of the scalars declared inside the body
+	std::set<size_t> declared;
+
+	void check_assigned(statement_t * node, const std::string & ID, variable_slot_t slot);
+
+public:
+	concurrent_body_checker_t();
+
+	void visit(statement_list_t * node);
+	void visit(code_block_statement_t * node);
+	void visit(declaration_t * node);
+	void visit(assignment_t * node);
+	void visit(read_statement_t * node);
+	void visit(write_statement_t * node);
+	void visit(return_statement_t * node);
+	void visit(conditional_statement_t * node);
+	void visit(while_statement_t * node);
+	void visit(do_statement_t * node);
+	void visit(break_statement_t * node);
+	void visit(cycle_statement_t * node);
+	void visit(invoke_statement_t * node);
+	void visit(constant_t * node);
+	void visit(variable_expression_t * node);
+	void visit(binary_expression_t * node);
+	void visit(short_circuit_expression_t * node);
+	void visit(invocation_expression_t * node);
+	void visit(array_declaration_t * node);
+	void visit(element_expression_t * node);
+	void visit(element_assignment_t * node);
+	void visit(reduction_expression_t * node);
+};
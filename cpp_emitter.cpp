@@ -0,0 +1,834 @@
+#include <climits>
+#include <cstdio>
+
+#include "cpp_emitter.h"
+
+// Runtime of the emitted program, mirrors output_buffer_t and input_reader_t
+static const char * runtime =
+	"#include <climits>\n"
+	"#include <cstdio>\n"
+	"#include <cstdlib>\n"
+	"#include <unistd.h>\n"
+	"\n"
+	"static bool rt_interactive;\n"
+	"\n"
+	"static void rt_error(const char * message)\n"
+	"{\n"
+	"\tfflush(stdout);\n"
+	"\tfprintf(stderr, \"%s\\n\", message);\n"
+	"\texit(-1);\n"
+	"}\n"
+	"\n"
+	"static void rt_uninit(const char * name)\n"
+	"{\n"
+	"\tfflush(stdout);\n"
+	"\tfprintf(stderr, \"'%s': using uninitialized variable\\n\", name);\n"
+	"\texit(-1);\n"
+	"}\n"
+	"\n"
+	"static inline int rt_add(int a, int b)\n"
+	"{\n"
+	"\treturn (int)((unsigned int)a + (unsigned int)b);\n"
+	"}\n"
+	"\n"
+	"static inline int rt_sub(int a, int b)\n"
+	"{\n"
+	"\treturn (int)((unsigned int)a - (unsigned int)b);\n"
+	"}\n"
+	"\n"
+	"static inline int rt_mul(int a, int b)\n"
+	"{\n"
+	"\treturn (int)((unsigned int)a * (unsigned int)b);\n"
+	"}\n"
+	"\n"
+	"static void rt_check_division(int a, int b, int line)\n"
+	"{\n"
+	"\tif (b == 0 || (b == -1 && a == INT_MIN))\n"
+	"\t{\n"
+	"\t\tfflush(stdout);\n"
+	"\t\tfprintf(stderr, \"line number %d: %s\\n\", line, b == 0 ? \"division by zero\" : \"integer overflow in division\");\n"
+	"\t\texit(-1);\n"
+	"\t}\n"
+	"}\n"
+	"\n"
+	"static inline int rt_div(int a, int b, int line)\n"
+	"{\n"
+	"\trt_check_division(a, b, line);\n"
+	"\treturn a / b;\n"
+	"}\n"
+	"\n"
+	"static inline int rt_mod(int a, int b, int line)\n"
+	"{\n"
+	"\trt_check_division(a, b, line);\n"
+	"\treturn a % b;\n"
+	"}\n"
+	"\n"
+	"static bool rt_do_count(int first, int last, int step, unsigned int & remaining)\n"
+	"{\n"
+	"\tif (step == 0)\n"
+	"\t{\n"
+	"\t\trt_error(\"DO step must not be zero\");\n"
+	"\t}\n"
+	"\tif (step > 0)\n"
+	"\t{\n"
+	"\t\tif (first > last)\n"
+	"\t\t{\n"
+	"\t\t\treturn false;\n"
+	"\t\t}\n"
+	"\t\tremaining = ((unsigned int)last - (unsigned int)first) / (unsigned int)step;\n"
+	"\t}\n"
+	"\telse\n"
+	"\t{\n"
+	"\t\tif (first < last)\n"
+	"\t\t{\n"
+	"\t\t\treturn false;\n"
+	"\t\t}\n"
+	"\t\tremaining = ((unsigned int)first - (unsigned int)last) / (0u - (unsigned int)step);\n"
+	"\t}\n"
+	"\treturn true;\n"
+	"}\n"
+	"\n"
+	"static void rt_write_int(int value)\n"
+	"{\n"
+	"\tprintf(\"%d \", value);\n"
+	"}\n"
+	"\n"
+	"static void rt_write_bool(bool value)\n"
+	"{\n"
+	"\tfputs(value ? \"true \" : \"false \", stdout);\n"
+	"}\n"
+	"\n"
+	"static void rt_write_string(const char * value)\n"
+	"{\n"
+	"\tfputs(value, stdout);\n"
+	"\tputchar(' ');\n"
+	"}\n"
+	"\n"
+	"static void rt_end_line()\n"
+	"{\n"
+	"\tputchar('\\n');\n"
+	"}\n"
+	"\n"
+	"static bool rt_is_space(int c)\n"
+	"{\n"
+	"\treturn c == ' ' || c == '\\t' || c == '\\n' || c == '\\r' || c == '\\v' || c == '\\f';\n"
+	"}\n"
+	"\n"
+	"static int rt_read_int()\n"
+	"{\n"
+	"\tif (rt_interactive)\n"
+	"\t{\n"
+	"\t\tfflush(stdout);\n"
+	"\t}\n"
+	"\n"
+	"\tint c = getchar_unlocked();\n"
+	"\twhile (rt_is_space(c))\n"
+	"\t{\n"
+	"\t\tc = getchar_unlocked();\n"
+	"\t}\n"
+	"\tif (c == EOF)\n"
+	"\t{\n"
+	"\t\trt_error(\"READ: unexpected end of input\");\n"
+	"\t}\n"
+	"\n"
+	"\tbool negative = false;\n"
+	"\tif (c == '-' || c == '+')\n"
+	"\t{\n"
+	"\t\tnegative = c == '-';\n"
+	"\t\tc = getchar_unlocked();\n"
+	"\t}\n"
+	"\tif (c < '0' || c > '9')\n"
+	"\t{\n"
+	"\t\trt_error(\"READ: malformed integer\");\n"
+	"\t}\n"
+	"\n"
+	"\tlong long value = 0;\n"
+	"\twhile (c >= '0' && c <= '9')\n"
+	"\t{\n"
+	"\t\tvalue = value * 10 - (c - '0');\n"
+	"\t\tif (value < INT_MIN)\n"
+	"\t\t{\n"
+	"\t\t\trt_error(\"READ: integer out of range\");\n"
+	"\t\t}\n"
+	"\t\tc = getchar_unlocked();\n"
+	"\t}\n"
+	"\tif (c != EOF && !rt_is_space(c))\n"
+	"\t{\n"
+	"\t\trt_error(\"READ: malformed integer\");\n"
+	"\t}\n"
+	"\n"
+	"\tif (!negative)\n"
+	"\t{\n"
+	"\t\tvalue = -value;\n"
+	"\t\tif (value > INT_MAX)\n"
+	"\t\t{\n"
+	"\t\t\trt_error(\"READ: integer out of range\");\n"
+	"\t\t}\n"
+	"\t}\n"
+	"\treturn (int)value;\n"
+	"}\n"
+	"\n";
+
+static std::string to_cpp_string(const std::string & value)
+{
+	std::string result = "\"";
+	for(size_t index = 0; index < value.size(); ++index)
+	{
+		unsigned char c = value[index];
+		if (c == '"' || c == '\\' || c == '?')
+		{
+			result += '\\';
+			result += c;
+		}
+		else if (c < 0x20 || c >= 0x7f)
+		{
+			char escaped[8];
+			sprintf(escaped, "\\%03o", c);
+			result += escaped;
+		}
+		else
+		{
+			result += c;
+		}
+	}
+	return result + "\"";
+}
+
+static std::string to_cpp_int(int value)
+{
+	if (value == INT_MIN)
+	{
+		return "(-2147483647 - 1)";
+	}
+
+	char buffer[16];
+	sprintf(buffer, "%d", value);
+	return buffer;
+}
+
+static std::string function_name(const char * ID)
+{
+	return std::string("f_") + ID;
+}
+
+// CYCLE statements of the loop the body belongs to, nested loops excluded
+static bool contains_cycle(statement_t * stmt)
+{
+	if (dynamic_cast<cycle_statement_t *>(stmt) != NULL)
+	{
+		return true;
+	}
+
+	code_block_statement_t * block = dynamic_cast<code_block_statement_t *>(stmt);
+	if (block != NULL)
+	{
+		return contains_cycle(block->get_body());
+	}
+
+	statement_list_t * list = dynamic_cast<statement_list_t *>(stmt);
+	if (list != NULL)
+	{
+		for(size_t index = 0; index < list->size(); ++index)
+		{
+			if (contains_cycle(list->get_at(index)))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	conditional_statement_t * conditional = dynamic_cast<conditional_statement_t *>(stmt);
+	if (conditional != NULL)
+	{
+		return contains_cycle(conditional->get_true_way())
+			|| (conditional->get_false_way() != NULL && contains_cycle(conditional->get_false_way()));
+	}
+	return false;
+}
+
+// cpp_emitter_t
+
+cpp_emitter_t::cpp_emitter_t()
+{
+	program = NULL;
+	method = NULL;
+	indent = 0;
+	next_temp = 0;
+	result_type = vtNoType;
+	result_is_simple = false;
+	result_is_compound = false;
+}
+
+void cpp_emitter_t::line(const std::string & text)
+{
+	out << std::string(indent, '\t') << text << "\n";
+}
+
+std::string cpp_emitter_t::temp(const std::string & value, variable_type type)
+{
+	std::ostringstream name;
+	name << "t" << next_temp++;
+	line(std::string(type == vtBool ? "bool " : "int ") + name.str() + " = " + value + ";");
+	return name.str();
+}
+
+std::string cpp_emitter_t::slot_name(variable_slot_t slot)
+{
+	std::ostringstream name;
+	name << (slot.depth == 0 ? "v" : "g") << slot.index;
+	return name.str();
+}
+
+std::string cpp_emitter_t::flag_name(variable_slot_t slot)
+{
+	std::ostringstream name;
+	name << (slot.depth == 0 ? "a" : "ga") << slot.index;
+	return name.str();
+}
+
+std::string cpp_emitter_t::emit_expression(expression_t * expr)
+{
+	expr->accept(this);
+	return result;
+}
+
+// same as emit_expression, parenthesized to be nested into an infix one
+std::string cpp_emitter_t::emit_operand(expression_t * expr)
+{
+	expr->accept(this);
+	if (result_is_compound)
+	{
+		return "(" + result + ")";
+	}
+	return result;
+}
+
+std::string cpp_emitter_t::emit(program_t * program)
+{
+	this->program = program;
+	out << runtime;
+
+	for(size_t index = 0; index < program->get_class_frame_size(); ++index)
+	{
+		out << "static int g" << index << ";\n";
+		out << "static bool ga" << index << ";\n";
+	}
+	out << "\n";
+
+	std::vector<method_t *> methods;
+	methods.push_back(program->get_main());
+	for(auto it = program->get_methods().begin(); it != program->get_methods().end(); ++it)
+	{
+		methods.push_back(it->second);
+	}
+
+	for(size_t index = 0; index < methods.size(); ++index)
+	{
+		out << "static int " << function_name(methods[index]->get_id()) << "(";
+		for(size_t arg = 0; arg < methods[index]->get_arguments_count(); ++arg)
+		{
+			out << (arg == 0 ? "" : ", ") << "int";
+		}
+		out << ");\n";
+	}
+	out << "\n";
+
+	for(size_t index = 0; index < methods.size(); ++index)
+	{
+		emit_method(methods[index]);
+	}
+
+	out << "int main()\n";
+	out << "{\n";
+	out << "\trt_interactive = isatty(STDIN_FILENO) != 0;\n";
+	out << "\t" << function_name(program->get_main()->get_id()) << "();\n";
+	out << "\tfflush(stdout);\n";
+	out << "\treturn 0;\n";
+	out << "}\n";
+	return out.str();
+}
+
+void cpp_emitter_t::emit_method(method_t * method)
+{
+	this->method = method;
+	next_temp = 0;
+
+	size_t arguments_count = method->get_arguments_count();
+	assigned.assign(arguments_count, true);
+	assigned.resize(method->get_frame_size(), false);
+	out << "static int " << function_name(method->get_id()) << "(";
+	for(size_t index = 0; index < arguments_count; ++index)
+	{
+		out << (index == 0 ? "" : ", ") << "int v" << index;
+	}
+	out << ")\n";
+	out << "{\n";
+
+	indent = 1;
+	for(size_t index = 0; index < method->get_frame_size(); ++index)
+	{
+		std::ostringstream declaration;
+		if (index >= arguments_count)
+		{
+			declaration << "int v" << index << " = 0;";
+			line(declaration.str());
+			declaration.str("");
+		}
+		declaration << "bool a" << index << " = " << (index < arguments_count ? "true" : "false") << ";";
+		line(declaration.str());
+	}
+
+	method->get_body()->accept(this);
+	indent = 0;
+	out << "}\n\n";
+}
+
+void cpp_emitter_t::emit_return()
+{
+	if (method->get_return_type() == vtNoType)
+	{
+		line("return 0;");
+	}
+	else
+	{
+		line("return " + slot_name(variable_slot_t{0, method->get_result_index()}) + ";");
+	}
+	set_unreachable();
+}
+
+void cpp_emitter_t::set_unreachable()
+{
+	assigned.assign(assigned.size(), true);
+}
+
+void cpp_emitter_t::merge_state(const std::vector<bool> & other)
+{
+	for(size_t index = 0; index < assigned.size(); ++index)
+	{
+		assigned[index] = assigned[index] && other[index];
+	}
+}
+
+// statements
+
+void cpp_emitter_t::visit(statement_list_t * node)
+{
+	for(size_t index = 0; index < node->size(); ++index)
+	{
+		node->get_at(index)->accept(this);
+	}
+}
+
+void cpp_emitter_t::visit(code_block_statement_t * node)
+{
+	node->get_body()->accept(this);
+}
+
+void cpp_emitter_t::visit(declaration_t * node)
+{
+	line(flag_name(variable_slot_t{0, node->get_index()}) + " = false;");
+	assigned[node->get_index()] = false;
+}
+
+void cpp_emitter_t::visit(assignment_t * node)
+{
+	variable_slot_t slot = node->get_slot();
+	std::string value = emit_expression(node->get_value());
+	line(slot_name(slot) + " = " + value + ";");
+	line(flag_name(slot) + " = true;");
+	if (slot.depth == 0)
+	{
+		assigned[slot.index] = true;
+	}
+}
+
+void cpp_emitter_t::visit(read_statement_t * node)
+{
+	read_arguments_t * args = node->get_args();
+	for(size_t index = 0; index < args->size(); ++index)
+	{
+		variable_slot_t slot = args->get_at(index);
+		line(slot_name(slot) + " = rt_read_int();");
+		line(flag_name(slot) + " = true;");
+		if (slot.depth == 0)
+		{
+			assigned[slot.index] = true;
+		}
+	}
+}
+
+void cpp_emitter_t::visit(write_statement_t * node)
+{
+	write_arguments_t * args = node->get_args();
+	for(size_t index = 0; index < args->size(); ++index)
+	{
+		if (args->is_message(index))
+		{
+			line("rt_write_string(" + to_cpp_string(args->get_message(index)) + ");");
+		}
+		else
+		{
+			std::string value = emit_expression(args->get_expression(index));
+			line((result_type == vtBool ? "rt_write_bool(" : "rt_write_int(") + value + ");");
+		}
+	}
+	line("rt_end_line();");
+}
+
+void cpp_emitter_t::visit(return_statement_t * node)
+{
+	emit_return();
+}
+
+void cpp_emitter_t::visit(conditional_statement_t * node)
+{
+	std::string condition = emit_expression(node->get_condition());
+	std::vector<bool> state = assigned;
+	line("if (" + condition + ")");
+	line("{");
+	++indent;
+	node->get_true_way()->accept(this);
+	--indent;
+	line("}");
+
+	if (node->get_false_way() != NULL)
+	{
+		std::vector<bool> true_state = assigned;
+		assigned = state;
+		line("else");
+		line("{");
+		++indent;
+		node->get_false_way()->accept(this);
+		--indent;
+		line("}");
+		merge_state(true_state);
+	}
+	else
+	{
+		merge_state(state);
+	}
+}
+
+// the body goes into a block of its own when a CYCLE has to jump over it,
+// so the jump doesn't cross the temporaries declared in it
+void cpp_emitter_t::emit_loop_body(statement_t * body)
+{
+	loops.push_back(loop_t());
+	if (!contains_cycle(body))
+	{
+		body->accept(this);
+		return;
+	}
+
+	std::ostringstream label;
+	label << "next" << next_temp++;
+	loops.back().cycle_label = label.str();
+
+	line("{");
+	++indent;
+	body->accept(this);
+	--indent;
+	line("}");
+	line(label.str() + ":;");
+	for(size_t index = 0; index < loops.back().cycle_states.size(); ++index)
+	{
+		merge_state(loops.back().cycle_states[index]);
+	}
+}
+
+void cpp_emitter_t::visit(while_statement_t * node)
+{
+	line("for (;;)");
+	line("{");
+	++indent;
+
+	emit_loop_body(node->get_body());
+	std::string condition = emit_operand(node->get_condition());
+	line("if (!" + condition + ")");
+	line("{");
+	line("\tbreak;");
+	line("}");
+
+	for(size_t index = 0; index < loops.back().break_states.size(); ++index)
+	{
+		merge_state(loops.back().break_states[index]);
+	}
+	loops.pop_back();
+	--indent;
+	line("}");
+}
+
+void cpp_emitter_t::visit(do_statement_t * node)
+{
+	variable_slot_t slot = node->get_slot();
+	std::string first = temp(emit_expression(node->get_first()), vtInt);
+	std::string last = temp(emit_expression(node->get_last()), vtInt);
+	std::string step = "1";
+	if (node->get_step() != NULL)
+	{
+		step = emit_expression(node->get_step());
+		if (!result_is_simple)
+		{
+			step = temp(step, vtInt);
+		}
+	}
+
+	// the index of DO CONCURRENT is the loop's own, the variable is put back
+	// after it
+	bool concurrent = dynamic_cast<do_concurrent_statement_t *>(node) != NULL;
+	std::string saved;
+	std::string saved_flag;
+	bool was_assigned = slot.depth == 0 && assigned[slot.index];
+	if (concurrent)
+	{
+		saved = temp(slot_name(slot), vtInt);
+		saved_flag = temp(flag_name(slot), vtBool);
+	}
+
+	line(slot_name(slot) + " = " + first + ";");
+	line(flag_name(slot) + " = true;");
+	if (slot.depth == 0)
+	{
+		assigned[slot.index] = true;
+	}
+
+	std::ostringstream remaining;
+	remaining << "t" << next_temp++;
+	line("unsigned int " + remaining.str() + ";");
+	line("if (rt_do_count(" + first + ", " + last + ", " + step + ", " + remaining.str() + "))");
+	line("{");
+	++indent;
+	line("for (;;)");
+	line("{");
+	++indent;
+
+	std::vector<bool> state = assigned;
+	emit_loop_body(node->get_body());
+	// first is the counter the variable is set from, like the tree walker
+	// does, so assigning it in the body changes neither
+	line(first + " = rt_add(" + first + ", " + step + ");");
+	line(slot_name(slot) + " = " + first + ";");
+	line("if (" + remaining.str() + "-- == 0)");
+	line("{");
+	line("\tbreak;");
+	line("}");
+
+	merge_state(state);
+	for(size_t index = 0; index < loops.back().break_states.size(); ++index)
+	{
+		merge_state(loops.back().break_states[index]);
+	}
+	loops.pop_back();
+	--indent;
+	line("}");
+	--indent;
+	line("}");
+
+	if (concurrent)
+	{
+		line(slot_name(slot) + " = " + saved + ";");
+		line(flag_name(slot) + " = " + saved_flag + ";");
+		if (slot.depth == 0)
+		{
+			assigned[slot.index] = was_assigned;
+		}
+	}
+}
+
+void cpp_emitter_t::visit(break_statement_t * node)
+{
+	if (loops.empty())
+	{
+		// a break outside of a loop leaves the method, like the tree walker does
+		emit_return();
+	}
+	else
+	{
+		line("break;");
+		loops.back().break_states.push_back(assigned);
+		set_unreachable();
+	}
+}
+
+void cpp_emitter_t::visit(cycle_statement_t * node)
+{
+	if (loops.empty())
+	{
+		emit_return();
+	}
+	else
+	{
+		line("goto " + loops.back().cycle_label + ";");
+		loops.back().cycle_states.push_back(assigned);
+		set_unreachable();
+	}
+}
+
+void cpp_emitter_t::visit(invoke_statement_t * node)
+{
+	emit_expression(node->get_invokee());
+}
+
+// expressions
+
+void cpp_emitter_t::visit(constant_t * node)
+{
+	variant_t value = node->get_value();
+	result = value.type == vtBool ? (value.bool_value ? "true" : "false") : to_cpp_int(value.int_value);
+	result_type = value.type;
+	result_is_simple = true;
+	result_is_compound = false;
+}
+
+void cpp_emitter_t::visit(variable_expression_t * node)
+{
+	variable_slot_t slot = node->get_slot();
+	if (slot.depth != 0 || !assigned[slot.index])
+	{
+		line("if (!" + flag_name(slot) + ")");
+		line("{");
+		line("\trt_uninit(" + to_cpp_string(node->get_id()) + ");");
+		line("}");
+		if (slot.depth == 0)
+		{
+			assigned[slot.index] = true;
+		}
+	}
+
+	result = slot_name(slot);
+	result_type = node->typecheck();
+	result_is_simple = false;
+	result_is_compound = false;
+}
+
+void cpp_emitter_t::visit(binary_expression_t * node)
+{
+	operation type = node->get_operation();
+	std::string left = emit_operand(node->get_left());
+	if (!result_is_simple && node->get_right()->has_side_effects())
+	{
+		left = temp(left, result_type);
+	}
+	std::string right = emit_operand(node->get_right());
+
+	result_type = vtBool;
+	result_is_simple = false;
+	result_is_compound = true;
+	switch (type)
+	{
+	case opAdd:
+		result = "rt_add(" + left + ", " + right + ")";
+		result_type = vtInt;
+		result_is_compound = false;
+		return;
+	case opSub:
+		result = "rt_sub(" + left + ", " + right + ")";
+		result_type = vtInt;
+		result_is_compound = false;
+		return;
+	case opMul:
+		result = "rt_mul(" + left + ", " + right + ")";
+		result_type = vtInt;
+		result_is_compound = false;
+		return;
+	case opDiv:
+	case opMod:
+	{
+		// the line goes along for the error message
+		std::ostringstream call;
+		call << (type == opDiv ? "rt_div(" : "rt_mod(") << left << ", " << right << ", " << node->get_line() << ")";
+		result = call.str();
+		result_type = vtInt;
+		result_is_compound = false;
+		return;
+	}
+	case opAnd:
+		result = left + " && " + right;
+		return;
+	case opOr:
+		result = left + " || " + right;
+		return;
+	case opEquals:
+		result = left + " == " + right;
+		return;
+	case opNotEquals:
+		result = left + " != " + right;
+		return;
+	default:
+		result = left + " " + to_string(type) + " " + right;
+		return;
+	}
+}
+
+void cpp_emitter_t::visit(short_circuit_expression_t * node)
+{
+	std::string value = temp(emit_expression(node->get_left()), vtBool);
+	line(std::string("if (") + (node->get_operation() == opAnd ? "" : "!") + value + ")");
+	line("{");
+	++indent;
+	std::vector<bool> state = assigned;
+	std::string right = emit_expression(node->get_right());
+	line(value + " = " + right + ";");
+	assigned = state;
+	--indent;
+	line("}");
+
+	result = value;
+	result_type = vtBool;
+	result_is_simple = true;
+	result_is_compound = false;
+}
+
+void cpp_emitter_t::visit(invocation_expression_t * node)
+{
+	method_t * callee = node->get_method();
+	parameter_list_t * params = node->get_params();
+
+	std::vector<std::string> args;
+	for(size_t index = 0; index < params->size(); ++index)
+	{
+		std::string value = emit_expression(params->get_at(index));
+
+		bool later_side_effects = false;
+		for(size_t later = index + 1; later < params->size(); ++later)
+		{
+			later_side_effects = later_side_effects || params->get_at(later)->has_side_effects();
+		}
+		if (!result_is_simple && later_side_effects)
+		{
+			value = temp(value, vtInt);
+		}
+		args.push_back(value);
+	}
+
+	std::string call = function_name(callee->get_id()) + "(";
+	for(size_t index = 0; index < args.size(); ++index)
+	{
+		call += (index == 0 ? "" : ", ") + args[index];
+	}
+	result = temp(call + ")", vtInt);
+	result_type = vtInt;
+	result_is_simple = true;
+	result_is_compound = false;
+}
+
+void cpp_emitter_t::visit(array_declaration_t * node)
+{
+	raise_error_at(node->get_line(), "emit-cpp: arrays are not supported");
+}
+
+void cpp_emitter_t::visit(element_expression_t * node)
+{
+	raise_error_at(node->get_line(), "emit-cpp: arrays are not supported");
+}
+
+void cpp_emitter_t::visit(element_assignment_t * node)
+{
+	raise_error_at(node->get_line(), "emit-cpp: arrays are not supported");
+}
+
+void cpp_emitter_t::visit(reduction_expression_t * node)
+{
+	raise_error_at(node->get_line(), "emit-cpp: arrays are not supported");
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <sstream>
+#include <vector>
+
+#include "syntax_engine.h"
+
+// Translates a checked program into a standalone C++ translation unit
+// (--emit-cpp). Every method becomes an int function over native ints,
+// DO...WHILE and DO become loops, WRITE and READ go through a small runtime
+// emitted in front of the program that behaves like the interpreter's.
+//
+// Calls are hoisted into temporaries, so the expression strings built here
+// are free of side effects; an operand evaluated before a call is saved
+// first to keep the left to right order of the tree walker.
+class cpp_emitter_t : public ast_visitor_t
+{
+private:
+	// CYCLE jumps to the label, which follows the body in a block of its own
+	struct loop_t
+	{
+		std::vector<std::vector<bool> > break_states;
+		std::vector<std::vector<bool> > cycle_states;
+		std::string cycle_label;
+	};
+
+	std::ostringstream out;
+	program_t * program;
+	method_t * method;
+	int indent;
+	int next_temp;
+
+	// definite assignment of the locals, used to omit the checks of reads,
+	// and the states at the breaks and cycles of each enclosing loop
+	std::vector<bool> assigned;
+	std::vector<loop_t> loops;
+
+	// last visited expression
+	std::string result;
+	variable_type result_type;
+	// a constant or a temporary, nothing a call could change
+	bool result_is_simple;
+	// an infix expression, has to be parenthesized inside another one
+	bool result_is_compound;
+
+	void line(const std::string & text);
+	std::string temp(const std::string & value, variable_type type);
+	std::string slot_name(variable_slot_t slot);
+	std::string flag_name(variable_slot_t slot);
+	std::string emit_expression(expression_t * expr);
+	std::string emit_operand(expression_t * expr);
+	void emit_method(method_t * method);
+	void emit_return();
+	void emit_loop_body(statement_t * body);
+	void set_unreachable();
+	void merge_state(const std::vector<bool> & other);
+
+public:
+	cpp_emitter_t();
+
+	std::string emit(program_t * program);
+
+	void visit(statement_list_t * node);
+	void visit(code_block_statement_t * node);
+	void visit(declaration_t * node);
+	void visit(assignment_t * node);
+	void visit(read_statement_t * node);
+	void visit(write_statement_t * node);
+	void visit(return_statement_t * node);
+	void visit(conditional_statement_t * node);
+	void visit(while_statement_t * node);
+	void visit(do_statement_t * node);
+	void visit(break_statement_t * node);
+	void visit(cycle_statement_t * node);
+	void visit(invoke_statement_t * node);
+	void visit(constant_t * node);
+	void visit(variable_expression_t * node);
+	void visit(binary_expression_t * node);
+	void visit(short_circuit_expression_t * node);
+	void visit(invocation_expression_t * node);
+	void visit(array_declaration_t * node);
+	void visit(element_expression_t * node);
+	void visit(element_assignment_t * node);
+	void visit(reduction_expression_t * node);
+};
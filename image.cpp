@@ -0,0 +1,757 @@
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "image.h"
+#include "parser.h"
+
+static const char IMAGE_MAGIC[8] = { 'S', 'F', 'I', 'M', 'A', 'G', 'E', '\0' };
+
+// FNV-1a. The hash of the source only names the file, the image holds the
+// whole source and is compared against it; the hash of the image ends it
+// and catches a damaged one.
+static uint64_t hash_bytes(const char * data, size_t size)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for(size_t index = 0; index < size; ++index)
+	{
+		hash ^= (unsigned char)data[index];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// image_writer_t
+
+image_writer_t::image_writer_t(std::string & image)
+	: image(image)
+{
+}
+
+void image_writer_t::write_int(int value)
+{
+	image.append((const char *)&value, sizeof(value));
+}
+
+void image_writer_t::write_size(size_t value)
+{
+	uint64_t stored = value;
+	image.append((const char *)&stored, sizeof(stored));
+}
+
+void image_writer_t::write_string(const std::string & value)
+{
+	write_size(value.size());
+	image.append(value);
+}
+
+void image_writer_t::write_statement(statement_t * node)
+{
+	if (node == NULL)
+	{
+		write_int(itNull);
+		return;
+	}
+	node->accept(this);
+}
+
+void image_writer_t::write_expression(expression_t * node)
+{
+	if (node == NULL)
+	{
+		write_int(itNull);
+		return;
+	}
+	node->accept(this);
+}
+
+void image_writer_t::write_method(method_t * method)
+{
+	write_string(method->ID);
+	write_int(method->get_return_type());
+	method_signature_t * arguments = method->get_arguments();
+	write_size(arguments->size());
+	for(size_t index = 0; index < arguments->size(); ++index)
+	{
+		write_string(arguments->get_at(index)->get_id());
+	}
+	write_statement(method->get_body());
+}
+
+void image_writer_t::write(const std::string & source, program_t * program)
+{
+	image.append(IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+	write_int(IMAGE_VERSION);
+	write_string(source);
+
+	write_statement(program->get_fields_declaration());
+	write_int(program->get_main() != NULL);
+	if (program->get_main() != NULL)
+	{
+		write_method(program->get_main());
+	}
+
+	const std::map<std::string, method_t *> & methods = program->get_methods();
+	write_size(methods.size());
+	for(auto it = methods.begin(); it != methods.end(); ++it)
+	{
+		write_method(it->second);
+	}
+
+	uint64_t hash = hash_bytes(image.data(), image.size());
+	image.append((const char *)&hash, sizeof(hash));
+}
+
+void image_writer_t::visit(statement_list_t * node)
+{
+	write_int(itStatementList);
+	write_int(node->get_line());
+	write_size(node->size());
+	for(size_t index = 0; index < node->size(); ++index)
+	{
+		write_statement(node->get_at(index));
+	}
+}
+
+void image_writer_t::visit(code_block_statement_t * node)
+{
+	write_int(itCodeBlock);
+	write_int(node->get_line());
+	write_statement(node->get_body());
+}
+
+void image_writer_t::visit(declaration_t * node)
+{
+	write_int(itDeclaration);
+	write_int(node->get_line());
+	write_string(node->get_id());
+	write_int(node->get_type());
+}
+
+void image_writer_t::visit(assignment_t * node)
+{
+	write_int(itAssignment);
+	write_int(node->get_line());
+	write_string(node->get_id());
+	write_expression(node->get_value());
+}
+
+void image_writer_t::visit(read_statement_t * node)
+{
+	write_int(itRead);
+	write_int(node->get_line());
+	read_arguments_t * args = node->get_args();
+	write_size(args->size());
+	for(size_t index = 0; index < args->size(); ++index)
+	{
+		write_string(args->get_name(index));
+	}
+}
+
+void image_writer_t::visit(write_statement_t * node)
+{
+	write_int(itWrite);
+	write_int(node->get_line());
+	write_arguments_t * args = node->get_args();
+	write_size(args->size());
+	for(size_t index = 0; index < args->size(); ++index)
+	{
+		write_int(args->is_message(index));
+		if (args->is_message(index))
+		{
+			write_string(args->get_message(index));
+		}
+		else
+		{
+			write_expression(args->get_expression(index));
+		}
+	}
+}
+
+// always returns from the method it is read into
+void image_writer_t::visit(return_statement_t * node)
+{
+	write_int(itReturn);
+	write_int(node->get_line());
+}
+
+void image_writer_t::visit(conditional_statement_t * node)
+{
+	write_int(itConditional);
+	write_int(node->get_line());
+	write_expression(node->get_condition());
+	write_statement(node->get_true_way());
+	write_statement(node->get_false_way());
+}
+
+void image_writer_t::visit(while_statement_t * node)
+{
+	write_int(itWhile);
+	write_int(node->get_line());
+	write_expression(node->get_condition());
+	write_statement(node->get_body());
+}
+
+void image_writer_t::visit(do_statement_t * node)
+{
+	write_int(dynamic_cast<do_concurrent_statement_t *>(node) != NULL ? itDoConcurrent : itDo);
+	write_int(node->get_line());
+	write_string(node->get_id());
+	write_expression(node->get_first());
+	write_expression(node->get_last());
+	write_expression(node->get_step());
+	write_statement(node->get_body());
+}
+
+void image_writer_t::visit(break_statement_t * node)
+{
+	write_int(itBreak);
+	write_int(node->get_line());
+}
+
+void image_writer_t::visit(cycle_statement_t * node)
+{
+	write_int(itCycle);
+	write_int(node->get_line());
+}
+
+void image_writer_t::visit(invoke_statement_t * node)
+{
+	write_int(itInvoke);
+	write_int(node->get_line());
+	write_expression(node->get_invokee());
+}
+
+void image_writer_t::visit(constant_t * node)
+{
+	variant_t value = node->get_value();
+	write_int(itConstant);
+	write_int(node->get_line());
+	write_int(value.type);
+	write_int(value.type == vtBool ? value.bool_value : value.int_value);
+}
+
+void image_writer_t::visit(variable_expression_t * node)
+{
+	write_int(itVariable);
+	write_int(node->get_line());
+	write_string(node->get_id());
+}
+
+void image_writer_t::visit(binary_expression_t * node)
+{
+	write_int(itBinary);
+	write_int(node->get_line());
+	write_int(node->get_operation());
+	write_expression(node->get_left());
+	write_expression(node->get_right());
+}
+
+void image_writer_t::visit(short_circuit_expression_t * node)
+{
+	write_int(itShortCircuit);
+	write_int(node->get_line());
+	write_int(node->get_operation());
+	write_expression(node->get_left());
+	write_expression(node->get_right());
+}
+
+void image_writer_t::visit(invocation_expression_t * node)
+{
+	write_int(itInvocation);
+	write_int(node->get_line());
+	write_string(node->get_method_id());
+	parameter_list_t * params = node->get_params();
+	write_size(params->size());
+	for(size_t index = 0; index < params->size(); ++index)
+	{
+		write_expression(params->get_at(index));
+	}
+}
+
+void image_writer_t::visit(array_declaration_t * node)
+{
+	write_int(itArrayDeclaration);
+	write_int(node->get_line());
+	write_string(node->get_id());
+	write_size(node->get_size());
+}
+
+void image_writer_t::visit(element_expression_t * node)
+{
+	write_int(itElement);
+	write_int(node->get_line());
+	write_string(node->get_id());
+	write_expression(node->get_index());
+}
+
+void image_writer_t::visit(element_assignment_t * node)
+{
+	write_int(itElementAssignment);
+	write_int(node->get_line());
+	write_string(node->get_id());
+	write_expression(node->get_index());
+	write_expression(node->get_value());
+}
+
+void image_writer_t::visit(reduction_expression_t * node)
+{
+	write_int(itReduction);
+	write_int(node->get_line());
+	write_int(node->get_reduction());
+	write_expression(node->get_arg());
+}
+
+// image_reader_t
+
+image_reader_t::image_reader_t(const char * image, size_t size)
+{
+	position = image;
+	end = image + size;
+	program = NULL;
+	method = NULL;
+}
+
+void image_reader_t::check(size_t size)
+{
+	if ((size_t)(end - position) < size)
+	{
+		throw corrupt_t();
+	}
+}
+
+int image_reader_t::read_int()
+{
+	int value;
+	check(sizeof(value));
+	memcpy(&value, position, sizeof(value));
+	position += sizeof(value);
+	return value;
+}
+
+// a count or a length never exceeds what is left of the image
+size_t image_reader_t::read_size()
+{
+	uint64_t value;
+	check(sizeof(value));
+	memcpy(&value, position, sizeof(value));
+	position += sizeof(value);
+	check(value);
+	return (size_t)value;
+}
+
+std::string image_reader_t::read_string()
+{
+	size_t size = read_size();
+	std::string value(position, size);
+	position += size;
+	return value;
+}
+
+image_tag image_reader_t::read_tag()
+{
+	int tag = read_int();
+	if (tag < itNull || tag > itReduction)
+	{
+		throw corrupt_t();
+	}
+	return (image_tag)tag;
+}
+
+statement_t * image_reader_t::read_statement(bool optional)
+{
+	image_tag tag = read_tag();
+	if (tag == itNull)
+	{
+		if (!optional)
+		{
+			throw corrupt_t();
+		}
+		return NULL;
+	}
+
+	int line = read_int();
+	statement_t * node;
+	switch (tag)
+	{
+	case itStatementList:
+		{
+			statement_list_t * list = new statement_list_t();
+			size_t count = read_size();
+			for(size_t index = 0; index < count; ++index)
+			{
+				list->add(read_statement());
+			}
+			node = list;
+		}
+		break;
+	case itCodeBlock:
+		node = new code_block_statement_t(read_statement_list());
+		break;
+	case itDeclaration:
+		{
+			std::string ID = read_string();
+			int type = read_int();
+			if (type < vtInt || type > vtNoType)
+			{
+				throw corrupt_t();
+			}
+			node = new declaration_t(ID.c_str(), (variable_type)type);
+		}
+		break;
+	case itAssignment:
+		{
+			std::string ID = read_string();
+			node = new assignment_t(ID.c_str(), read_expression());
+		}
+		break;
+	case itRead:
+		{
+			read_arguments_t * args = new read_arguments_t();
+			size_t count = read_size();
+			for(size_t index = 0; index < count; ++index)
+			{
+				args->add(read_string().c_str());
+			}
+			node = new read_statement_t(args);
+		}
+		break;
+	case itWrite:
+		{
+			write_arguments_t * args = new write_arguments_t();
+			size_t count = read_size();
+			for(size_t index = 0; index < count; ++index)
+			{
+				if (read_int() != 0)
+				{
+					// stored without the quotes the parser strips
+					args->add("\"" + read_string() + "\"");
+				}
+				else
+				{
+					args->add(read_expression());
+				}
+			}
+			node = new write_statement_t(args);
+		}
+		break;
+	case itReturn:
+		node = new return_statement_t(method);
+		break;
+	case itConditional:
+		{
+			expression_t * condition = read_expression();
+			statement_t * true_way = read_statement();
+			node = new conditional_statement_t(condition, true_way, read_statement(true));
+		}
+		break;
+	case itWhile:
+		{
+			expression_t * condition = read_expression();
+			node = new while_statement_t(condition, read_statement());
+		}
+		break;
+	case itDo:
+	case itDoConcurrent:
+		{
+			std::string ID = read_string();
+			expression_t * first = read_expression();
+			expression_t * last = read_expression();
+			expression_t * step = read_expression(true);
+			statement_t * body = read_statement();
+			if (tag == itDoConcurrent)
+			{
+				node = new do_concurrent_statement_t(ID.c_str(), first, last, step, body, program);
+			}
+			else
+			{
+				node = new do_statement_t(ID.c_str(), first, last, step, body);
+			}
+		}
+		break;
+	case itBreak:
+		node = new break_statement_t();
+		break;
+	case itCycle:
+		node = new cycle_statement_t();
+		break;
+	case itInvoke:
+		node = new invoke_statement_t(read_expression());
+		break;
+	case itArrayDeclaration:
+		{
+			std::string ID = read_string();
+			node = new array_declaration_t(ID.c_str(), (int)read_size());
+		}
+		break;
+	case itElementAssignment:
+		{
+			std::string ID = read_string();
+			expression_t * index = read_expression();
+			node = new element_assignment_t(ID.c_str(), index, read_expression());
+		}
+		break;
+	default:
+		throw corrupt_t();
+	}
+
+	node->set_line(line);
+	return node;
+}
+
+statement_list_t * image_reader_t::read_statement_list()
+{
+	statement_list_t * list = dynamic_cast<statement_list_t *>(read_statement());
+	if (list == NULL)
+	{
+		throw corrupt_t();
+	}
+	return list;
+}
+
+expression_t * image_reader_t::read_expression(bool optional)
+{
+	image_tag tag = read_tag();
+	if (tag == itNull)
+	{
+		if (!optional)
+		{
+			throw corrupt_t();
+		}
+		return NULL;
+	}
+
+	int line = read_int();
+	expression_t * node;
+	switch (tag)
+	{
+	case itConstant:
+		{
+			variant_t value;
+			int type = read_int();
+			int stored = read_int();
+			if (type == vtBool)
+			{
+				value.type = vtBool;
+				value.bool_value = stored != 0;
+			}
+			else if (type == vtInt)
+			{
+				value.type = vtInt;
+				value.int_value = stored;
+			}
+			else
+			{
+				throw corrupt_t();
+			}
+			node = new constant_t(value);
+		}
+		break;
+	case itVariable:
+		node = new variable_expression_t(read_string().c_str());
+		break;
+	case itBinary:
+	case itShortCircuit:
+		{
+			int type = read_int();
+			if (type < opAdd || type > opGreaterEquals)
+			{
+				throw corrupt_t();
+			}
+			expression_t * left = read_expression();
+			expression_t * right = read_expression();
+			if (tag == itShortCircuit)
+			{
+				node = new short_circuit_expression_t((operation)type, left, right);
+			}
+			else
+			{
+				node = new binary_expression_t((operation)type, left, right);
+			}
+		}
+		break;
+	case itInvocation:
+		{
+			std::string ID = read_string();
+			parameter_list_t * params = new parameter_list_t();
+			size_t count = read_size();
+			for(size_t index = 0; index < count; ++index)
+			{
+				params->add(read_expression());
+			}
+			node = new invocation_expression_t(params, ID.c_str(), program);
+		}
+		break;
+	case itElement:
+		{
+			std::string ID = read_string();
+			node = new element_expression_t(ID.c_str(), read_expression());
+		}
+		break;
+	case itReduction:
+		{
+			int type = read_int();
+			if (type != reduction_expression_t::rtSum && type != reduction_expression_t::rtMaxval)
+			{
+				throw corrupt_t();
+			}
+			node = new reduction_expression_t((reduction_expression_t::reduction_type)type, read_expression());
+		}
+		break;
+	default:
+		throw corrupt_t();
+	}
+
+	node->set_line(line);
+	return node;
+}
+
+method_t * image_reader_t::read_method()
+{
+	std::string ID = read_string();
+	int return_type = read_int();
+	if (return_type < vtInt || return_type > vtNoType)
+	{
+		throw corrupt_t();
+	}
+
+	method_signature_t * arguments = new method_signature_t();
+	size_t count = read_size();
+	for(size_t index = 0; index < count; ++index)
+	{
+		arguments->add(read_string().c_str());
+	}
+
+	method = new method_t(ID.c_str(), (variable_type)return_type, arguments);
+	// the RETURN set_body appends is in the image already
+	method->replace_body(read_statement_list());
+	method_t * result = method;
+	method = NULL;
+	return result;
+}
+
+program_t * image_reader_t::read(const std::string & source)
+{
+	try
+	{
+		uint64_t hash;
+		check(sizeof(IMAGE_MAGIC) + sizeof(hash));
+		end -= sizeof(hash);
+		memcpy(&hash, end, sizeof(hash));
+		if (memcmp(position, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0 || hash_bytes(position, end - position) != hash)
+		{
+			return NULL;
+		}
+		position += sizeof(IMAGE_MAGIC);
+		if (read_int() != (int)IMAGE_VERSION || read_string() != source)
+		{
+			return NULL;
+		}
+
+		program = new program_t();
+		statement_list_t * fields = read_statement_list();
+		for(size_t index = 0; index < fields->size(); ++index)
+		{
+			program->add_field_declaration(fields->get_at(index));
+		}
+		if (read_int() != 0)
+		{
+			program->set_main(read_method());
+		}
+
+		size_t count = read_size();
+		for(size_t index = 0; index < count; ++index)
+		{
+			program->add_method(read_method());
+		}
+		if (position != end)
+		{
+			throw corrupt_t();
+		}
+	}
+	catch (const corrupt_t &)
+	{
+		// the nodes read so far are left behind like the tree of a
+		// failed parse
+		return NULL;
+	}
+	return program;
+}
+
+// program_cache_t
+
+program_cache_t::program_cache_t(const std::string & directory)
+{
+	this->directory = directory;
+}
+
+std::string program_cache_t::get_path(const std::string & source)
+{
+	char name[64];
+	sprintf(name, "/%016llx-%u.img", (unsigned long long)hash_bytes(source.data(), source.size()), IMAGE_VERSION);
+	return directory + name;
+}
+
+program_t * program_cache_t::load(const std::string & path, const std::string & source)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return NULL;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	void * data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	image_reader_t reader((const char *)data, info.st_size);
+	program_t * program = reader.read(source);
+	munmap(data, info.st_size);
+	return program;
+}
+
+// a cache that can't be written only costs the next run a parse
+void program_cache_t::store(const std::string & path, const std::string & source, program_t * program)
+{
+	std::string image;
+	image_writer_t writer(image);
+	writer.write(source, program);
+
+	std::string temporary = path + ".XXXXXX";
+	int fd = mkstemp(&temporary[0]);
+	if (fd < 0)
+	{
+		return;
+	}
+	bool written = ::write(fd, image.data(), image.size()) == (ssize_t)image.size();
+	written = close(fd) == 0 && written;
+	if (!written || rename(temporary.c_str(), path.c_str()) != 0)
+	{
+		unlink(temporary.c_str());
+	}
+}
+
+program_t * program_cache_t::get(const std::string & source)
+{
+	std::string path = get_path(source);
+	program_t * program = load(path, source);
+	if (program == NULL)
+	{
+		program = parse_program(source);
+		store(path, source, program);
+	}
+	return program;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "syntax_engine.h"
+
+// Binary image of a parsed program (--cache). The tree is stored as it comes
+// out of the parser, before the passes that change it, and is rebuilt with
+// the constructors the grammar uses; name resolution, type checking and
+// optimization run on it as on a freshly parsed tree, so an image skips
+// only flex and bison. Every node is a tag, its line and its fields in
+// order; ints are stored in the byte order of the machine. A hash of the
+// image closes it.
+
+// Changes with every change of the format or the tree, older images are
+// ignored then
+const unsigned int IMAGE_VERSION = 1;
+
+enum image_tag
+{
+	itNull,
+	itStatementList,
+	itCodeBlock,
+	itDeclaration,
+	itAssignment,
+	itRead,
+	itWrite,
+	itReturn,
+	itConditional,
+	itWhile,
+	itDo,
+	itDoConcurrent,
+	itBreak,
+	itCycle,
+	itInvoke,
+	itArrayDeclaration,
+	itElementAssignment,
+
+	itConstant,
+	itVariable,
+	itBinary,
+	itShortCircuit,
+	itInvocation,
+	itElement,
+	itReduction
+};
+
+// Appends the image of a program to a buffer
+class image_writer_t : public ast_visitor_t
+{
+private:
+	std::string & image;
+
+	void write_int(int value);
+	void write_size(size_t value);
+	void write_string(const std::string & value);
+	void write_statement(statement_t * node);
+	void write_expression(expression_t * node);
+	void write_method(method_t * method);
+
+public:
+	image_writer_t(std::string & image);
+
+	// the program has to be fresh from the parser
+	void write(const std::string & source, program_t * program);
+
+	void visit(statement_list_t * node);
+	void visit(code_block_statement_t * node);
+	void visit(declaration_t * node);
+	void visit(assignment_t * node);
+	void visit(read_statement_t * node);
+	void visit(write_statement_t * node);
+	void visit(return_statement_t * node);
+	void visit(conditional_statement_t * node);
+	void visit(while_statement_t * node);
+	void visit(do_statement_t * node);
+	void visit(break_statement_t * node);
+	void visit(cycle_statement_t * node);
+	void visit(invoke_statement_t * node);
+	void visit(constant_t * node);
+	void visit(variable_expression_t * node);
+	void visit(binary_expression_t * node);
+	void visit(short_circuit_expression_t * node);
+	void visit(invocation_expression_t * node);
+	void visit(array_declaration_t * node);
+	void visit(element_expression_t * node);
+	void visit(element_assignment_t * node);
+	void visit(reduction_expression_t * node);
+};
+
+// Rebuilds a program from an image. Nothing in the image is trusted: a
+// truncated or foreign one makes read() return NULL.
+class image_reader_t
+{
+private:
+	struct corrupt_t
+	{
+	};
+
+	const char * position;
+	const char * end;
+	program_t * program;
+	method_t * method;
+
+	void check(size_t size);
+	int read_int();
+	size_t read_size();
+	std::string read_string();
+	image_tag read_tag();
+	// optional lets the node be missing (itNull), as the ELSE of an IF or
+	// the step of a DO may be
+	statement_t * read_statement(bool optional = false);
+	statement_list_t * read_statement_list();
+	expression_t * read_expression(bool optional = false);
+	method_t * read_method();
+
+public:
+	image_reader_t(const char * image, size_t size);
+
+	// NULL unless the image is intact and was made from source
+	program_t * read(const std::string & source);
+};
+
+// Directory of images named after the hash of their source and the image
+// version. Images are written through a temporary file and renamed, so
+// processes sharing the directory never see a partial one.
+class program_cache_t
+{
+private:
+	std::string directory;
+
+	std::string get_path(const std::string & source);
+	program_t * load(const std::string & path, const std::string & source);
+	void store(const std::string & path, const std::string & source, program_t * program);
+
+public:
+	program_cache_t(const std::string & directory);
+
+	// the program of source as the parser makes it, from the image when the
+	// directory has one; a missing image is written after the parse
+	program_t * get(const std::string & source);
+};
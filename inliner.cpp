@@ -0,0 +1,704 @@
+#include "inliner.h"
+
+// inliner_t
+
+inliner_t::inliner_t(size_t limit)
+{
+	this->limit = limit;
+	program = NULL;
+}
+
+void inliner_t::install(program_t * program)
+{
+	this->program = program;
+	std::vector<method_t *> all_methods;
+	for(auto it = program->get_methods().begin(); it != program->get_methods().end(); ++it)
+	{
+		all_methods.push_back(it->second);
+	}
+	all_methods.push_back(program->get_main());
+
+	for(size_t index = 0; index < all_methods.size(); ++index)
+	{
+		scan(all_methods[index]);
+	}
+	for(size_t index = 0; index < all_methods.size(); ++index)
+	{
+		std::set<method_t *> visited;
+		if (reaches(all_methods[index], all_methods[index], visited))
+		{
+			recursive.insert(all_methods[index]);
+		}
+	}
+
+	// callees first, so a copy takes the calls inlined into its method along
+	std::set<method_t *> visited;
+	for(size_t index = 0; index < all_methods.size(); ++index)
+	{
+		sort(all_methods[index], visited);
+	}
+	for(size_t index = 0; index < order.size(); ++index)
+	{
+		inline_calls(order[index]);
+	}
+
+	program->resolve();
+	program->typecheck();
+}
+
+void inliner_t::scan(method_t * method)
+{
+	call_scanner_t scanner;
+	scanner.scan(method->get_body());
+	sizes[method] = scanner.get_size();
+	calls[method] = scanner.get_calls();
+}
+
+bool inliner_t::reaches(method_t * from, method_t * to, std::set<method_t *> & visited)
+{
+	const std::vector<invocation_expression_t *> & from_calls = calls[from];
+	for(size_t index = 0; index < from_calls.size(); ++index)
+	{
+		method_t * callee = from_calls[index]->get_method();
+		if (callee == to)
+		{
+			return true;
+		}
+		if (visited.insert(callee).second && reaches(callee, to, visited))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void inliner_t::sort(method_t * method, std::set<method_t *> & visited)
+{
+	if (!visited.insert(method).second)
+	{
+		return;
+	}
+
+	const std::vector<invocation_expression_t *> & method_calls = calls[method];
+	for(size_t index = 0; index < method_calls.size(); ++index)
+	{
+		sort(method_calls[index]->get_method(), visited);
+	}
+	order.push_back(method);
+}
+
+void inliner_t::inline_calls(method_t * caller)
+{
+	tree_cloner_t cloner(program);
+	const std::vector<invocation_expression_t *> & caller_calls = calls[caller];
+	bool changed = false;
+	for(size_t index = 0; index < caller_calls.size(); ++index)
+	{
+		invocation_expression_t * call = caller_calls[index];
+		method_t * callee = call->get_method();
+		if (recursive.count(callee) != 0 || sizes[callee] > limit)
+		{
+			continue;
+		}
+
+		call->set_inline_body(cloner.clone_list(callee->get_body()));
+		changed = true;
+
+		inlined_call_t entry;
+		entry.caller = caller->ID;
+		entry.callee = callee->ID;
+		entry.line = call->get_line();
+		entry.size = sizes[callee];
+		inlined.push_back(entry);
+	}
+
+	if (changed)
+	{
+		call_scanner_t scanner;
+		scanner.scan(caller->get_body());
+		sizes[caller] = scanner.get_size();
+	}
+}
+
+void inliner_t::report(FILE * stream)
+{
+	fprintf(stream, "\ninlined calls\n\n");
+	fprintf(stream, "%-24s %-24s %6s %6s\n", "caller", "callee", "line", "nodes");
+	for(size_t index = 0; index < inlined.size(); ++index)
+	{
+		const inlined_call_t & entry = inlined[index];
+		fprintf(stream, "%-24s %-24s %6d %6u\n", entry.caller.c_str(), entry.callee.c_str(), entry.line, (unsigned int)entry.size);
+	}
+
+	// the methods that are called somewhere
+	std::set<method_t *> callees;
+	for(auto it = calls.begin(); it != calls.end(); ++it)
+	{
+		for(size_t index = 0; index < it->second.size(); ++index)
+		{
+			callees.insert(it->second[index]->get_method());
+		}
+	}
+
+	fprintf(stream, "\nnot inlined (limit %u nodes)\n\n", (unsigned int)limit);
+	for(auto it = program->get_methods().begin(); it != program->get_methods().end(); ++it)
+	{
+		method_t * method = it->second;
+		if (callees.count(method) == 0)
+		{
+			continue;
+		}
+		if (recursive.count(method) != 0)
+		{
+			fprintf(stream, "%-24s recursive\n", method->ID.c_str());
+		}
+		else if (sizes[method] > limit)
+		{
+			fprintf(stream, "%-24s %u nodes\n", method->ID.c_str(), (unsigned int)sizes[method]);
+		}
+	}
+}
+
+// call_scanner_t
+
+call_scanner_t::call_scanner_t()
+{
+	size = 0;
+	inline_depth = 0;
+}
+
+void call_scanner_t::scan(statement_t * body)
+{
+	size = 0;
+	calls.clear();
+	body->accept(this);
+}
+
+void call_scanner_t::scan_expression(expression_t * node)
+{
+	if (node != NULL)
+	{
+		node->accept(this);
+	}
+}
+
+void call_scanner_t::visit(statement_list_t * node)
+{
+	for(size_t index = 0; index < node->size(); ++index)
+	{
+		node->get_at(index)->accept(this);
+	}
+}
+
+void call_scanner_t::visit(code_block_statement_t * node)
+{
+	node->get_body()->accept(this);
+}
+
+void call_scanner_t::visit(declaration_t * node)
+{
+	++size;
+}
+
+void call_scanner_t::visit(assignment_t * node)
+{
+	++size;
+	scan_expression(node->get_value());
+}
+
+void call_scanner_t::visit(read_statement_t * node)
+{
+	++size;
+}
+
+void call_scanner_t::visit(write_statement_t * node)
+{
+	++size;
+	write_arguments_t * args = node->get_args();
+	for(size_t index = 0; index < args->size(); ++index)
+	{
+		if (!args->is_message(index))
+		{
+			scan_expression(args->get_expression(index));
+		}
+	}
+}
+
+void call_scanner_t::visit(return_statement_t * node)
+{
+	++size;
+}
+
+void call_scanner_t::visit(conditional_statement_t * node)
+{
+	++size;
+	scan_expression(node->get_condition());
+	node->get_true_way()->accept(this);
+	if (node->get_false_way() != NULL)
+	{
+		node->get_false_way()->accept(this);
+	}
+}
+
+void call_scanner_t::visit(while_statement_t * node)
+{
+	++size;
+	scan_expression(node->get_condition());
+	node->get_body()->accept(this);
+}
+
+void call_scanner_t::visit(do_statement_t * node)
+{
+	++size;
+	scan_expression(node->get_first());
+	scan_expression(node->get_last());
+	scan_expression(node->get_step());
+	node->get_body()->accept(this);
+}
+
+void call_scanner_t::visit(break_statement_t * node)
+{
+	++size;
+}
+
+void call_scanner_t::visit(cycle_statement_t * node)
+{
+	++size;
+}
+
+void call_scanner_t::visit(invoke_statement_t * node)
+{
+	++size;
+	scan_expression(node->get_invokee());
+}
+
+void call_scanner_t::visit(constant_t * node)
+{
+	++size;
+}
+
+void call_scanner_t::visit(variable_expression_t * node)
+{
+	++size;
+}
+
+void call_scanner_t::visit(binary_expression_t * node)
+{
+	++size;
+	scan_expression(node->get_left());
+	scan_expression(node->get_right());
+}
+
+void call_scanner_t::visit(short_circuit_expression_t * node)
+{
+	++size;
+	scan_expression(node->get_left());
+	scan_expression(node->get_right());
+}
+
+void call_scanner_t::visit(invocation_expression_t * node)
+{
+	++size;
+	if (inline_depth == 0)
+	{
+		calls.push_back(node);
+	}
+
+	parameter_list_t * params = node->get_params();
+	for(size_t index = 0; index < params->size(); ++index)
+	{
+		scan_expression(params->get_at(index));
+	}
+
+	if (node->get_inline_body() != NULL)
+	{
+		++inline_depth;
+		node->get_inline_body()->accept(this);
+		--inline_depth;
+	}
+}
+
+void call_scanner_t::visit(array_declaration_t * node)
+{
+	++size;
+}
+
+void call_scanner_t::visit(element_expression_t * node)
+{
+	++size;
+	scan_expression(node->get_index());
+}
+
+void call_scanner_t::visit(element_assignment_t * node)
+{
+	++size;
+	scan_expression(node->get_index());
+	scan_expression(node->get_value());
+}
+
+void call_scanner_t::visit(reduction_expression_t * node)
+{
+	++size;
+	scan_expression(node->get_arg());
+}
+
+// tail_call_marker_t
+
+tail_call_marker_t::tail_call_marker_t(method_t * method)
+{
+	this->method = method;
+	tail = true;
+}
+
+void tail_call_marker_t::mark()
+{
+	tail = true;
+	method->get_body()->accept(this);
+}
+
+void tail_call_marker_t::visit(statement_list_t * node)
+{
+	bool list_tail = tail;
+	for(size_t index = 0; index < node->size(); ++index)
+	{
+		bool last = index + 1 == node->size();
+		bool returns = !last && dynamic_cast<return_statement_t *>(node->get_at(index + 1)) != NULL;
+		tail = (list_tail && last) || returns;
+		node->get_at(index)->accept(this);
+	}
+	tail = list_tail;
+}
+
+void tail_call_marker_t::visit(code_block_statement_t * node)
+{
+	node->get_body()->accept(this);
+}
+
+void tail_call_marker_t::visit(declaration_t * node)
+{
+}
+
+// the result of the method is the result of the call; an inlined call
+// has no frame to replace
+void tail_call_marker_t::visit(assignment_t * node)
+{
+	if (!tail || node->get_array_size() != 0)
+	{
+		return;
+	}
+	variable_slot_t slot = node->get_slot();
+	invocation_expression_t * call = dynamic_cast<invocation_expression_t *>(node->get_value());
+	if (slot.depth != 0 || slot.index != method->get_result_index() || call == NULL)
+	{
+		return;
+	}
+	method_t * callee = call->get_method();
+	if (callee->get_return_type() != method->get_return_type() || callee->get_arguments_count() > TAIL_CALL_MAX_ARGUMENTS || call->get_inline_body() != NULL)
+	{
+		return;
+	}
+	call->set_tail_call();
+}
+
+void tail_call_marker_t::visit(read_statement_t * node)
+{
+}
+
+void tail_call_marker_t::visit(write_statement_t * node)
+{
+}
+
+void tail_call_marker_t::visit(return_statement_t * node)
+{
+}
+
+void tail_call_marker_t::visit(conditional_statement_t * node)
+{
+	node->get_true_way()->accept(this);
+	if (node->get_false_way() != NULL)
+	{
+		node->get_false_way()->accept(this);
+	}
+}
+
+void tail_call_marker_t::visit(while_statement_t * node)
+{
+	bool loop_tail = tail;
+	tail = false;
+	node->get_body()->accept(this);
+	tail = loop_tail;
+}
+
+// chunks of DO CONCURRENT run in frames of their own
+void tail_call_marker_t::visit(do_statement_t * node)
+{
+	if (dynamic_cast<do_concurrent_statement_t *>(node) != NULL)
+	{
+		return;
+	}
+	bool loop_tail = tail;
+	tail = false;
+	node->get_body()->accept(this);
+	tail = loop_tail;
+}
+
+void tail_call_marker_t::visit(break_statement_t * node)
+{
+}
+
+void tail_call_marker_t::visit(cycle_statement_t * node)
+{
+}
+
+void tail_call_marker_t::visit(invoke_statement_t * node)
+{
+}
+
+void tail_call_marker_t::visit(constant_t * node)
+{
+}
+
+void tail_call_marker_t::visit(variable_expression_t * node)
+{
+}
+
+void tail_call_marker_t::visit(binary_expression_t * node)
+{
+}
+
+void tail_call_marker_t::visit(short_circuit_expression_t * node)
+{
+}
+
+void tail_call_marker_t::visit(invocation_expression_t * node)
+{
+}
+
+void tail_call_marker_t::visit(array_declaration_t * node)
+{
+}
+
+void tail_call_marker_t::visit(element_expression_t * node)
+{
+}
+
+void tail_call_marker_t::visit(element_assignment_t * node)
+{
+}
+
+void tail_call_marker_t::visit(reduction_expression_t * node)
+{
+}
+
+// tree_cloner_t
+
+tree_cloner_t::tree_cloner_t(program_t * program)
+{
+	this->program = program;
+	statement = NULL;
+	expression = NULL;
+}
+
+statement_t * tree_cloner_t::clone(statement_t * node)
+{
+	if (node == NULL)
+	{
+		return NULL;
+	}
+	node->accept(this);
+	statement->set_line(node->get_line());
+	return statement;
+}
+
+statement_list_t * tree_cloner_t::clone_list(statement_list_t * node)
+{
+	statement_list_t * list = new statement_list_t();
+	for(size_t index = 0; index < node->size(); ++index)
+	{
+		list->add(clone(node->get_at(index)));
+	}
+	list->set_line(node->get_line());
+	return list;
+}
+
+expression_t * tree_cloner_t::clone_expression(expression_t * node)
+{
+	if (node == NULL)
+	{
+		return NULL;
+	}
+	node->accept(this);
+	expression->set_line(node->get_line());
+	return expression;
+}
+
+void tree_cloner_t::visit(statement_list_t * node)
+{
+	statement = clone_list(node);
+}
+
+void tree_cloner_t::visit(code_block_statement_t * node)
+{
+	statement = new code_block_statement_t(clone_list(node->get_body()));
+}
+
+void tree_cloner_t::visit(declaration_t * node)
+{
+	statement = new declaration_t(node->get_id().c_str(), node->get_type());
+}
+
+void tree_cloner_t::visit(assignment_t * node)
+{
+	statement = new assignment_t(node->get_id().c_str(), clone_expression(node->get_value()));
+}
+
+void tree_cloner_t::visit(read_statement_t * node)
+{
+	read_arguments_t * args = node->get_args();
+	read_arguments_t * copy = new read_arguments_t();
+	for(size_t index = 0; index < args->size(); ++index)
+	{
+		copy->add(args->get_name(index).c_str());
+	}
+	statement = new read_statement_t(copy);
+}
+
+void tree_cloner_t::visit(write_statement_t * node)
+{
+	write_arguments_t * args = node->get_args();
+	write_arguments_t * copy = new write_arguments_t();
+	for(size_t index = 0; index < args->size(); ++index)
+	{
+		if (args->is_message(index))
+		{
+			// kept without the quotes the parser strips
+			copy->add("\"" + args->get_message(index) + "\"");
+		}
+		else
+		{
+			copy->add(clone_expression(args->get_expression(index)));
+		}
+	}
+	statement = new write_statement_t(copy);
+}
+
+void tree_cloner_t::visit(return_statement_t * node)
+{
+	statement = new return_statement_t(node->get_method());
+}
+
+void tree_cloner_t::visit(conditional_statement_t * node)
+{
+	expression_t * condition = clone_expression(node->get_condition());
+	statement_t * true_way = clone(node->get_true_way());
+	statement = new conditional_statement_t(condition, true_way, clone(node->get_false_way()));
+}
+
+void tree_cloner_t::visit(while_statement_t * node)
+{
+	expression_t * condition = clone_expression(node->get_condition());
+	statement = new while_statement_t(condition, clone(node->get_body()));
+}
+
+void tree_cloner_t::visit(do_statement_t * node)
+{
+	expression_t * first = clone_expression(node->get_first());
+	expression_t * last = clone_expression(node->get_last());
+	expression_t * step = clone_expression(node->get_step());
+	statement_t * body = clone(node->get_body());
+	if (dynamic_cast<do_concurrent_statement_t *>(node) != NULL)
+	{
+		statement = new do_concurrent_statement_t(node->get_id().c_str(), first, last, step, body, program);
+	}
+	else
+	{
+		statement = new do_statement_t(node->get_id().c_str(), first, last, step, body);
+	}
+}
+
+void tree_cloner_t::visit(break_statement_t * node)
+{
+	statement = new break_statement_t();
+}
+
+void tree_cloner_t::visit(cycle_statement_t * node)
+{
+	statement = new cycle_statement_t();
+}
+
+void tree_cloner_t::visit(invoke_statement_t * node)
+{
+	statement = new invoke_statement_t(clone_expression(node->get_invokee()));
+}
+
+void tree_cloner_t::visit(constant_t * node)
+{
+	expression = new constant_t(node->get_value());
+}
+
+void tree_cloner_t::visit(variable_expression_t * node)
+{
+	variable_expression_t * clone = new variable_expression_t(node->get_id().c_str());
+	if (node->is_defined())
+	{
+		clone->set_defined();
+	}
+	expression = clone;
+}
+
+void tree_cloner_t::visit(binary_expression_t * node)
+{
+	if (node->get_replacement() != NULL)
+	{
+		node->get_replacement()->accept(this);
+		return;
+	}
+
+	expression_t * left = clone_expression(node->get_left());
+	expression = new binary_expression_t(node->get_operation(), left, clone_expression(node->get_right()));
+}
+
+void tree_cloner_t::visit(short_circuit_expression_t * node)
+{
+	expression_t * left = clone_expression(node->get_left());
+	expression = new short_circuit_expression_t(node->get_operation(), left, clone_expression(node->get_right()));
+}
+
+// a copy of a call inlined already takes a copy of its body along
+void tree_cloner_t::visit(invocation_expression_t * node)
+{
+	parameter_list_t * params = node->get_params();
+	parameter_list_t * copy = new parameter_list_t();
+	for(size_t index = 0; index < params->size(); ++index)
+	{
+		copy->add(clone_expression(params->get_at(index)));
+	}
+
+	invocation_expression_t * call = new invocation_expression_t(copy, node->get_method_id().c_str(), program);
+	if (node->get_inline_body() != NULL)
+	{
+		call->set_inline_body(clone_list(node->get_inline_body()));
+	}
+	expression = call;
+}
+
+void tree_cloner_t::visit(array_declaration_t * node)
+{
+	statement = new array_declaration_t(node->get_id().c_str(), (int)node->get_size());
+}
+
+void tree_cloner_t::visit(element_expression_t * node)
+{
+	expression = new element_expression_t(node->get_id().c_str(), clone_expression(node->get_index()));
+}
+
+void tree_cloner_t::visit(element_assignment_t * node)
+{
+	expression_t * index = clone_expression(node->get_index());
+	statement = new element_assignment_t(node->get_id().c_str(), index, clone_expression(node->get_value()));
+}
+
+void tree_cloner_t::visit(reduction_expression_t * node)
+{
+	expression = new reduction_expression_t(node->get_reduction(), clone_expression(node->get_arg()));
+}
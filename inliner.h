@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstdio>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "syntax_engine.h"
+
+// Inlining of small methods (--inline). A call of a method that is small
+// enough and can't reach itself gets a copy of the method's body, which
+// the tree walker and the closure engine run in slots of the caller's frame
+// instead of pushing a frame and running the method. The copy is of the
+// tree as the parser made it and is resolved in a scope that sees only the
+// fields besides its own names, so arguments are passed by value and the
+// result is the variable named after the method, as in a real call. Calls
+// of methods that get native code or a memo table still go to the method.
+
+// Nodes a method may have to be inlined unless --inline=N says otherwise
+const size_t INLINE_DEFAULT_LIMIT = 32;
+
+struct inlined_call_t
+{
+	std::string caller;
+	std::string callee;
+	int line;
+	size_t size;
+};
+
+class inliner_t
+{
+private:
+	size_t limit;
+	program_t * program;
+	// nodes of every method, the copies inlined into it included
+	std::map<method_t *, size_t> sizes;
+	std::map<method_t *, std::vector<invocation_expression_t *> > calls;
+	std::set<method_t *> recursive;
+	std::vector<method_t *> order;
+	std::vector<inlined_call_t> inlined;
+
+	void scan(method_t * method);
+	bool reaches(method_t * from, method_t * to, std::set<method_t *> & visited);
+	void sort(method_t * method, std::set<method_t *> & visited);
+	void inline_calls(method_t * caller);
+
+public:
+	inliner_t(size_t limit);
+
+	// the program has to be typechecked; it is resolved and typechecked
+	// again with the copies in place
+	void install(program_t * program);
+
+	// every inlined call and every method left alone
+	void report(FILE * stream);
+};
+
+// Counts the nodes of a body and finds its calls, those inside copies
+// inlined already are counted but not returned
+class call_scanner_t : public ast_visitor_t
+{
+private:
+	size_t size;
+	size_t inline_depth;
+	std::vector<invocation_expression_t *> calls;
+
+	void scan_expression(expression_t * node);
+
+public:
+	call_scanner_t();
+
+	void scan(statement_t * body);
+
+	size_t get_size()
+	{
+		return size;
+	}
+
+	const std::vector<invocation_expression_t *> & get_calls()
+	{
+		return calls;
+	}
+
+	void visit(statement_list_t * node);
+	void visit(code_block_statement_t * node);
+	void visit(declaration_t * node);
+	void visit(assignment_t * node);
+	void visit(read_statement_t * node);
+	void visit(write_statement_t * node);
+	void visit(return_statement_t * node);
+	void visit(conditional_statement_t * node);
+	void visit(while_statement_t * node);
+	void visit(do_statement_t * node);
+	void visit(break_statement_t * node);
+	void visit(cycle_statement_t * node);
+	void visit(invoke_statement_t * node);
+	void visit(constant_t * node);
+	void visit(variable_expression_t * node);
+	void visit(binary_expression_t * node);
+	void visit(short_circuit_expression_t * node);
+	void visit(invocation_expression_t * node);
+	void visit(array_declaration_t * node);
+	void visit(element_expression_t * node);
+	void visit(element_assignment_t * node);
+	void visit(reduction_expression_t * node);
+};
+
+// Marks the calls of a function made in tail position, which assign the
+// result the call returns. A statement is in tail position when the method
+// returns right after it: one followed by RETURN, wherever it is, or the
+// last one of the body, or the last one of a branch of an IF in tail
+// position
+class tail_call_marker_t : public ast_visitor_t
+{
+private:
+	method_t * method;
+	// the statement visited is in tail position
+	bool tail;
+
+public:
+	tail_call_marker_t(method_t * method);
+
+	void mark();
+
+	void visit(statement_list_t * node);
+	void visit(code_block_statement_t * node);
+	void visit(declaration_t * node);
+	void visit(assignment_t * node);
+	void visit(read_statement_t * node);
+	void visit(write_statement_t * node);
+	void visit(return_statement_t * node);
+	void visit(conditional_statement_t * node);
+	void visit(while_statement_t * node);
+	void visit(do_statement_t * node);
+	void visit(break_statement_t * node);
+	void visit(cycle_statement_t * node);
+	void visit(invoke_statement_t * node);
+	void visit(constant_t * node);
+	void visit(variable_expression_t * node);
+	void visit(binary_expression_t * node);
+	void visit(short_circuit_expression_t * node);
+	void visit(invocation_expression_t * node);
+	void visit(array_declaration_t * node);
+	void visit(element_expression_t * node);
+	void visit(element_assignment_t * node);
+	void visit(reduction_expression_t * node);
+};
+
+// Copies a body by the names it uses, the copy has to be resolved
+class tree_cloner_t : public ast_visitor_t
+{
+private:
+	program_t * program;
+	// result of the node visited last
+	statement_t * statement;
+	expression_t * expression;
+
+public:
+	tree_cloner_t(program_t * program);
+
+	statement_t * clone(statement_t * node);
+	statement_list_t * clone_list(statement_list_t * node);
+	expression_t * clone_expression(expression_t * node);
+
+	void visit(statement_list_t * node);
+	void visit(code_block_statement_t * node);
+	void visit(declaration_t * node);
+	void visit(assignment_t * node);
+	void visit(read_statement_t * node);
+	void visit(write_statement_t * node);
+	void visit(return_statement_t * node);
+	void visit(conditional_statement_t * node);
+	void visit(while_statement_t * node);
+	void visit(do_statement_t * node);
+	void visit(break_statement_t * node);
+	void visit(cycle_statement_t * node);
+	void visit(invoke_statement_t * node);
+	void visit(constant_t * node);
+	void visit(variable_expression_t * node);
+	void visit(binary_expression_t * node);
+	void visit(short_circuit_expression_t * node);
+	void visit(invocation_expression_t * node);
+	void visit(array_declaration_t * node);
+	void visit(element_expression_t * node);
+	void visit(element_assignment_t * node);
+	void visit(reduction_expression_t * node);
+};
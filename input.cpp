@@ -0,0 +1,169 @@
+#include <cerrno>
+#include <climits>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "input.h"
+#include "syntax_engine.h"
+
+static bool is_space(int c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// input_reader_t
+
+input_reader_t::input_reader_t(int fd)
+{
+	this->fd = fd;
+	position = end = buffer;
+	mapping = NULL;
+	mapping_size = 0;
+	started = false;
+	finished = false;
+}
+
+input_reader_t::input_reader_t(const char * text, size_t size)
+{
+	fd = -1;
+	position = text;
+	end = text + size;
+	mapping = NULL;
+	mapping_size = 0;
+	// the whole text is in view, there is nothing to fill
+	started = true;
+	finished = true;
+}
+
+input_reader_t::~input_reader_t()
+{
+	if (mapping != NULL)
+	{
+		munmap(mapping, mapping_size);
+	}
+}
+
+void input_reader_t::start()
+{
+	started = true;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0)
+	{
+		return;
+	}
+
+	off_t offset = lseek(fd, 0, SEEK_CUR);
+	if (offset < 0 || offset >= info.st_size)
+	{
+		return;
+	}
+
+	void * data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED)
+	{
+		return;
+	}
+
+	mapping = (char *)data;
+	mapping_size = info.st_size;
+	position = mapping + offset;
+	end = mapping + mapping_size;
+	// the whole file is in view, there is nothing left to fill
+	finished = true;
+}
+
+bool input_reader_t::fill()
+{
+	if (finished)
+	{
+		return false;
+	}
+
+	ssize_t count;
+	do
+	{
+		count = read(fd, buffer, INPUT_BUFFER_SIZE);
+	} while (count < 0 && errno == EINTR);
+
+	if (count <= 0)
+	{
+		finished = true;
+		return false;
+	}
+
+	position = buffer;
+	end = buffer + count;
+	return true;
+}
+
+int input_reader_t::peek()
+{
+	if (position == end && !fill())
+	{
+		return -1;
+	}
+	return (unsigned char)*position;
+}
+
+int input_reader_t::read_int()
+{
+	if (!started)
+	{
+		start();
+	}
+
+	int c = peek();
+	while (is_space(c))
+	{
+		++position;
+		c = peek();
+	}
+
+	if (c < 0)
+	{
+		raise_error("READ: unexpected end of input");
+	}
+
+	bool negative = false;
+	if (c == '-' || c == '+')
+	{
+		negative = c == '-';
+		++position;
+		c = peek();
+	}
+
+	if (c < '0' || c > '9')
+	{
+		raise_error("READ: malformed integer");
+	}
+
+	// accumulated as a negative number, which covers INT_MIN
+	long long value = 0;
+	while (c >= '0' && c <= '9')
+	{
+		value = value * 10 - (c - '0');
+		if (value < INT_MIN)
+		{
+			raise_error("READ: integer out of range");
+		}
+		++position;
+		c = peek();
+	}
+
+	if (c >= 0 && !is_space(c))
+	{
+		raise_error("READ: malformed integer");
+	}
+
+	if (!negative)
+	{
+		value = -value;
+		if (value > INT_MAX)
+		{
+			raise_error("READ: integer out of range");
+		}
+	}
+	return (int)value;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+const size_t INPUT_BUFFER_SIZE = 1 << 16;
+
+// Integers for READ, parsed straight from the input of a run. A regular
+// file is mapped as a whole, anything else is read in large chunks.
+class input_reader_t
+{
+private:
+	char buffer[INPUT_BUFFER_SIZE];
+	const char * position;
+	const char * end;
+	int fd;
+	char * mapping;
+	size_t mapping_size;
+	bool started;
+	bool finished;
+
+	void start();
+	bool fill();
+	int peek();
+
+public:
+	input_reader_t(int fd);
+	// reads the text given, which has to outlive the reader
+	input_reader_t(const char * text, size_t size);
+	~input_reader_t();
+
+	// raises an error on malformed input and at the end of input
+	int read_int();
+};
@@ -0,0 +1,174 @@
+#include <memory>
+#include <thread>
+
+#include "interpreter.h"
+#include "parser.h"
+#include "image.h"
+#include "ir.h"
+
+// interpreter_t
+
+interpreter_t::interpreter_t()
+{
+	engine = ieTree;
+	optimize = true;
+	use_jit = true;
+	threads = std::thread::hardware_concurrency();
+}
+
+void interpreter_t::set_engine(interpreter_engine engine)
+{
+	this->engine = engine;
+}
+
+void interpreter_t::set_optimize(bool optimize)
+{
+	this->optimize = optimize;
+}
+
+void interpreter_t::set_jit(bool use_jit)
+{
+	this->use_jit = use_jit;
+}
+
+void interpreter_t::set_threads(size_t threads)
+{
+	this->threads = threads;
+}
+
+void interpreter_t::set_cache_directory(const std::string & directory)
+{
+	cache_directory = directory;
+}
+
+compiled_program_t * interpreter_t::compile(const std::string & source)
+{
+	error_trap_t trap;
+	// an error frees what was built of the tree with the arena
+	std::unique_ptr<tree_arena_t> arena(new tree_arena_t());
+	current_tree_arena_t current(arena.get());
+
+	program_t * program;
+	if (!cache_directory.empty())
+	{
+		program_cache_t cache(cache_directory);
+		program = cache.get(source);
+	}
+	else
+	{
+		program = parse_program(source);
+	}
+	program->resolve();
+	program->typecheck();
+	if (optimize)
+	{
+		ir_optimizer_t ir(true, NULL);
+		ir.install(program);
+		program->optimize();
+	}
+
+	std::unique_ptr<compiled_program_t> compiled(new compiled_program_t(arena.release(), program, engine == ieVm ? 1 : threads));
+	if (engine == ieVm)
+	{
+		compiled->vm = new vm_t();
+		compiled->vm->load(program);
+	}
+	else if (engine == ieClosure)
+	{
+		compiled->closures = new closure_engine_t();
+		compiled->closures->load(program);
+	}
+	else if (use_jit)
+	{
+		compiled->jit = new jit_t();
+		compiled->jit->compile(program);
+	}
+	return compiled.release();
+}
+
+// compiled_program_t
+
+compiled_program_t::compiled_program_t(tree_arena_t * arena, program_t * program, size_t threads)
+	: thread_pool(threads)
+{
+	this->arena = arena;
+	this->program = program;
+	vm = NULL;
+	closures = NULL;
+	jit = NULL;
+	has_output_mode = false;
+	mode = omBlock;
+	program->set_thread_pool(&thread_pool);
+}
+
+compiled_program_t::~compiled_program_t()
+{
+	delete vm;
+	delete closures;
+	delete jit;
+	program->set_thread_pool(NULL);
+	delete arena;
+}
+
+void compiled_program_t::set_output_mode(output_mode mode)
+{
+	has_output_mode = true;
+	this->mode = mode;
+}
+
+void compiled_program_t::run(runtime_t * runtime)
+{
+	error_trap_t trap;
+	if (has_output_mode)
+	{
+		runtime->output.set_mode(mode);
+	}
+
+	if (vm != NULL)
+	{
+		vm->run(runtime);
+	}
+	else if (closures != NULL)
+	{
+		closures->run(runtime);
+	}
+	else
+	{
+		program->run(runtime);
+	}
+	runtime->output.flush();
+}
+
+void compiled_program_t::run(int input_fd, FILE * output_stream)
+{
+	runtime_t runtime(input_fd, output_stream);
+	run(&runtime);
+}
+
+std::string compiled_program_t::run(const std::string & input)
+{
+	char * data = NULL;
+	size_t size = 0;
+	FILE * output_stream = open_memstream(&data, &size);
+	if (output_stream == NULL)
+	{
+		throw fortran_error_t("can't open the output of the run");
+	}
+
+	std::string result;
+	try
+	{
+		runtime_t runtime(input.data(), input.size(), output_stream);
+		run(&runtime);
+	}
+	catch (...)
+	{
+		fclose(output_stream);
+		free(data);
+		throw;
+	}
+	fclose(output_stream);
+	result.assign(data, size);
+	free(data);
+	return result;
+}
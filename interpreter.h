@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+#include "syntax_engine.h"
+#include "output.h"
+#include "runtime.h"
+#include "concurrency.h"
+#include "vm.h"
+#include "closure.h"
+#include "jit.h"
+
+// Embedding interface of libsimplefortran.a. Errors of a compile or a run
+// are thrown as fortran_error_t and leave the process and the other
+// programs alone. Any number of programs may be compiled and run in one
+// process, from any thread.
+
+class compiled_program_t;
+
+enum interpreter_engine
+{
+	ieTree,
+	ieVm,
+	ieClosure
+};
+
+// Compiles programs with the settings of the command line interpreter:
+// the tree engine with the JIT, optimized, DO CONCURRENT on as many threads
+// as the hardware has.
+class interpreter_t
+{
+private:
+	interpreter_engine engine;
+	bool optimize;
+	bool use_jit;
+	size_t threads;
+	std::string cache_directory;
+
+public:
+	interpreter_t();
+
+	void set_engine(interpreter_engine engine);
+	void set_optimize(bool optimize);
+	// the JIT works for the tree engine only
+	void set_jit(bool use_jit);
+	// threads of DO CONCURRENT, the tree and closure engines only
+	void set_threads(size_t threads);
+	// keeps images of the parsed programs there (see image.h), empty for
+	// none
+	void set_cache_directory(const std::string & directory);
+
+	// the caller owns the program returned
+	compiled_program_t * compile(const std::string & source);
+};
+
+// A program checked and compiled once, its runs share the code and change
+// nothing of it, so several may go on at once
+class compiled_program_t
+{
+private:
+	// holds the tree of the program
+	tree_arena_t * arena;
+	program_t * program;
+	thread_pool_t thread_pool;
+	vm_t * vm;
+	closure_engine_t * closures;
+	jit_t * jit;
+	bool has_output_mode;
+	output_mode mode;
+
+	// takes the arena
+	compiled_program_t(tree_arena_t * arena, program_t * program, size_t threads);
+
+	void run(runtime_t * runtime);
+
+	friend class interpreter_t;
+
+public:
+	~compiled_program_t();
+
+	void set_output_mode(output_mode mode);
+
+	// READ takes the integers from input_fd, WRITE goes to output_stream
+	void run(int input_fd, FILE * output_stream);
+	// returns what the run wrote
+	std::string run(const std::string & input);
+};
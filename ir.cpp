@@ -0,0 +1,1635 @@
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <set>
+
+#include "ir.h"
+#include "inliner.h"
+
+// value to use for the given one
+static ir_value_t * resolve_value(ir_value_t * value)
+{
+	while (value != NULL && value->forward != NULL)
+	{
+		value = value->forward;
+	}
+	return value;
+}
+
+static bool is_local(variable_slot_t slot, size_t size)
+{
+	return slot.depth == 0 && size == 0;
+}
+
+static size_t index_of(statement_list_t * list, statement_t * stmt)
+{
+	for(size_t index = 0; index < list->size(); ++index)
+	{
+		if (list->get_at(index) == stmt)
+		{
+			return index;
+		}
+	}
+	return list->size();
+}
+
+// calls visit for the statement and every one nested in it, the bodies of
+// DO CONCURRENT included, those inlined into calls not
+static void walk_statements(statement_t * stmt, const std::function<void(statement_t *)> & visit)
+{
+	if (stmt == NULL)
+	{
+		return;
+	}
+	visit(stmt);
+
+	if (code_block_statement_t * block = dynamic_cast<code_block_statement_t *>(stmt))
+	{
+		walk_statements(block->get_body(), visit);
+	}
+	else if (statement_list_t * list = dynamic_cast<statement_list_t *>(stmt))
+	{
+		for(size_t index = 0; index < list->size(); ++index)
+		{
+			walk_statements(list->get_at(index), visit);
+		}
+	}
+	else if (conditional_statement_t * conditional = dynamic_cast<conditional_statement_t *>(stmt))
+	{
+		walk_statements(conditional->get_true_way(), visit);
+		walk_statements(conditional->get_false_way(), visit);
+	}
+	else if (while_statement_t * loop = dynamic_cast<while_statement_t *>(stmt))
+	{
+		walk_statements(loop->get_body(), visit);
+	}
+	else if (do_statement_t * loop = dynamic_cast<do_statement_t *>(stmt))
+	{
+		walk_statements(loop->get_body(), visit);
+	}
+}
+
+// locals the statement may assign or declare
+static void collect_assigned(statement_t * stmt, std::vector<bool> & assigned)
+{
+	walk_statements(stmt, [&](statement_t * node)
+	{
+		if (declaration_t * declaration = dynamic_cast<declaration_t *>(node))
+		{
+			assigned[declaration->get_index()] = true;
+		}
+		else if (assignment_t * assignment = dynamic_cast<assignment_t *>(node))
+		{
+			if (is_local(assignment->get_slot(), assignment->get_array_size()))
+			{
+				assigned[assignment->get_slot().index] = true;
+			}
+		}
+		else if (read_statement_t * read = dynamic_cast<read_statement_t *>(node))
+		{
+			for(size_t index = 0; index < read->get_args()->size(); ++index)
+			{
+				if (read->get_args()->get_at(index).depth == 0)
+				{
+					assigned[read->get_args()->get_at(index).index] = true;
+				}
+			}
+		}
+		else if (do_statement_t * loop = dynamic_cast<do_statement_t *>(node))
+		{
+			if (loop->get_slot().depth == 0)
+			{
+				assigned[loop->get_slot().index] = true;
+			}
+		}
+	});
+}
+
+// ir_function_t
+
+ir_function_t::ir_function_t(method_t * method, const char * kind)
+{
+	this->method = method;
+	this->kind = kind;
+	temporaries = 0;
+	copies_propagated = 0;
+	stores_removed = 0;
+	expressions_hoisted = 0;
+	common_subexpressions = 0;
+}
+
+ir_function_t::~ir_function_t()
+{
+	for(size_t index = 0; index < values.size(); ++index)
+	{
+		delete values[index];
+	}
+	for(size_t index = 0; index < blocks.size(); ++index)
+	{
+		delete blocks[index];
+	}
+	for(size_t index = 0; index < reads.size(); ++index)
+	{
+		delete reads[index];
+	}
+	for(size_t index = 0; index < loops.size(); ++index)
+	{
+		delete loops[index];
+	}
+	for(size_t index = 0; index < expressions.size(); ++index)
+	{
+		delete expressions[index];
+	}
+	for(size_t index = 0; index < stores.size(); ++index)
+	{
+		delete stores[index];
+	}
+}
+
+ir_value_t * ir_function_t::add_value(ir_opcode opcode)
+{
+	ir_value_t * value = new ir_value_t();
+	value->opcode = opcode;
+	value->variable = IR_NO_VARIABLE;
+	values.push_back(value);
+	return value;
+}
+
+ir_block_t * ir_function_t::add_block()
+{
+	ir_block_t * block = new ir_block_t();
+	block->id = blocks.size();
+	blocks.push_back(block);
+	return block;
+}
+
+ir_value_t * ir_function_t::get_constant(variant_t value)
+{
+	std::pair<int, int> key(value.type, value.type == vtBool ? value.bool_value : value.int_value);
+	auto it = constants.find(key);
+	if (it != constants.end())
+	{
+		return it->second;
+	}
+
+	ir_value_t * constant = add_value(irConstant);
+	constant->constant = value;
+	constants.insert(std::make_pair(key, constant));
+	return constant;
+}
+
+ir_value_t * ir_function_t::get_undefined(size_t variable)
+{
+	if (undefined.size() <= variable)
+	{
+		undefined.resize(variable + 1, NULL);
+	}
+	if (undefined[variable] == NULL)
+	{
+		undefined[variable] = add_value(irUndefined);
+		undefined[variable]->variable = variable;
+	}
+	return undefined[variable];
+}
+
+// ir_builder_t
+
+ir_builder_t::ir_builder_t(ir_function_t * function)
+{
+	this->function = function;
+	block = NULL;
+	at_start = true;
+	value = NULL;
+	read = NULL;
+	pure = false;
+	expression = NULL;
+}
+
+void ir_builder_t::build()
+{
+	method_t * method = function->method;
+	size_t size = method->get_frame_size();
+	function->names.assign(size, "");
+	env.assign(size, NULL);
+	walk_statements(method->get_body(), [&](statement_t * node)
+	{
+		if (declaration_t * declaration = dynamic_cast<declaration_t *>(node))
+		{
+			function->names[declaration->get_index()] = declaration->get_id();
+		}
+	});
+
+	block = function->add_block();
+	for(size_t index = 0; index < method->get_arguments_count(); ++index)
+	{
+		function->names[index] = method->get_arguments()->get_at(index)->get_id();
+		ir_value_t * argument = append(irArgument);
+		argument->constant.type = vtInt;
+		argument->constant.int_value = (int)index;
+		argument->variable = index;
+		env[index] = argument;
+	}
+	function->names[method->get_result_index()] = method->ID;
+	env[method->get_result_index()] = function->get_undefined(method->get_result_index());
+
+	method->get_body()->accept(this);
+	finish();
+}
+
+// forwards the phis that merge a single value, then finds the values that
+// may be those of undefined locals
+void ir_builder_t::finish()
+{
+	std::vector<ir_value_t *> & values = function->values;
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for(size_t index = 0; index < values.size(); ++index)
+		{
+			ir_value_t * phi = values[index];
+			if (phi->opcode != irPhi || phi->forward != NULL)
+			{
+				continue;
+			}
+
+			ir_value_t * same = NULL;
+			bool trivial = true;
+			for(size_t operand = 0; operand < phi->operands.size(); ++operand)
+			{
+				ir_value_t * value = resolve_value(phi->operands[operand]);
+				if (value == phi || value == same)
+				{
+					continue;
+				}
+				if (same != NULL)
+				{
+					trivial = false;
+					break;
+				}
+				same = value;
+			}
+			if (trivial && same != NULL)
+			{
+				phi->forward = same;
+				changed = true;
+			}
+		}
+	}
+
+	for(size_t index = 0; index < function->blocks.size(); ++index)
+	{
+		std::vector<ir_value_t *> & block_values = function->blocks[index]->values;
+		block_values.erase(std::remove_if(block_values.begin(), block_values.end(), [](ir_value_t * value)
+		{
+			return value->forward != NULL;
+		}), block_values.end());
+	}
+	for(size_t index = 0; index < values.size(); ++index)
+	{
+		for(size_t operand = 0; operand < values[index]->operands.size(); ++operand)
+		{
+			values[index]->operands[operand] = resolve_value(values[index]->operands[operand]);
+		}
+		values[index]->maybe_undefined = values[index]->opcode == irUndefined || values[index]->opcode == irOpaque;
+	}
+
+	// a copy or an operation has read its operands, so only a phi can
+	// merge an undefined value
+	changed = true;
+	while (changed)
+	{
+		changed = false;
+		for(size_t index = 0; index < values.size(); ++index)
+		{
+			ir_value_t * phi = values[index];
+			if (phi->opcode != irPhi || phi->forward != NULL || phi->maybe_undefined)
+			{
+				continue;
+			}
+			for(size_t operand = 0; operand < phi->operands.size(); ++operand)
+			{
+				if (phi->operands[operand]->maybe_undefined)
+				{
+					phi->maybe_undefined = true;
+					changed = true;
+					break;
+				}
+			}
+		}
+	}
+}
+
+ir_value_t * ir_builder_t::append(ir_value_t * value)
+{
+	value->block = block;
+	block->values.push_back(value);
+	return value;
+}
+
+ir_value_t * ir_builder_t::append(ir_opcode opcode)
+{
+	return append(function->add_value(opcode));
+}
+
+void ir_builder_t::build_operand(ir_value_t * user, expression_t * expr)
+{
+	expr->accept(this);
+	if (read != NULL)
+	{
+		read->user = user;
+		read->operand = user->operands.size();
+	}
+	user->operands.push_back(value);
+}
+
+void ir_builder_t::link(ir_block_t * from, ir_block_t * to)
+{
+	from->successors.push_back(to);
+	to->predecessors.push_back(from);
+}
+
+void ir_builder_t::jump(ir_block_t * to)
+{
+	append(irJump);
+	link(block, to);
+}
+
+void ir_builder_t::branch(ir_value_t * terminator, ir_block_t *& on_true, ir_block_t *& on_false)
+{
+	append(terminator);
+	on_true = function->add_block();
+	on_false = function->add_block();
+	link(block, on_true);
+	link(block, on_false);
+}
+
+// continues in a block the edges join, with a phi for every local whose
+// value differs on them
+void ir_builder_t::merge(const std::vector<ir_edge_t> & edges)
+{
+	std::vector<const ir_edge_t *> reachable;
+	for(size_t index = 0; index < edges.size(); ++index)
+	{
+		if (edges[index].first != NULL)
+		{
+			reachable.push_back(&edges[index]);
+		}
+	}
+	if (reachable.empty())
+	{
+		block = NULL;
+		return;
+	}
+	if (reachable.size() == 1)
+	{
+		block = reachable[0]->first;
+		env = reachable[0]->second;
+		return;
+	}
+
+	ir_block_t * target = function->add_block();
+	for(size_t index = 0; index < reachable.size(); ++index)
+	{
+		block = reachable[index]->first;
+		jump(target);
+	}
+	block = target;
+
+	for(size_t variable = 0; variable < env.size(); ++variable)
+	{
+		ir_value_t * first = reachable[0]->second[variable];
+		bool same = true;
+		for(size_t index = 1; index < reachable.size(); ++index)
+		{
+			same = same && reachable[index]->second[variable] == first;
+		}
+		if (same)
+		{
+			env[variable] = first;
+			continue;
+		}
+
+		ir_value_t * phi = append(irPhi);
+		phi->variable = variable;
+		for(size_t index = 0; index < reachable.size(); ++index)
+		{
+			ir_value_t * value = reachable[index]->second[variable];
+			phi->operands.push_back(value != NULL ? value : function->get_undefined(variable));
+		}
+		env[variable] = phi;
+	}
+}
+
+ir_loop_t * ir_builder_t::add_loop(statement_t * stmt)
+{
+	ir_loop_t * loop = new ir_loop_t();
+	loop->statement = stmt;
+	loop->site = sites.back();
+	loop->entry = env;
+	loop->preheader = block;
+	function->loops.push_back(loop);
+	return loop;
+}
+
+// the locals the body assigns get a phi in the header, which takes the
+// value on the back edge from close_loop
+void ir_builder_t::enter_loop(ir_loop_t * loop, ir_block_t * header, statement_t * body, size_t variable, std::vector<ir_value_t *> & phis)
+{
+	std::vector<bool> assigned(env.size(), false);
+	collect_assigned(body, assigned);
+	if (variable != IR_NO_VARIABLE)
+	{
+		assigned[variable] = true;
+	}
+
+	block = header;
+	phis.assign(env.size(), NULL);
+	for(size_t index = 0; index < env.size(); ++index)
+	{
+		if (!assigned[index])
+		{
+			continue;
+		}
+		ir_value_t * phi = append(irPhi);
+		phi->variable = index;
+		phi->operands.push_back(env[index] != NULL ? env[index] : function->get_undefined(index));
+		env[index] = phi;
+		phis[index] = phi;
+	}
+
+	loops.push_back(loop);
+	continues.push_back(std::vector<ir_edge_t>());
+	breaks.push_back(std::vector<ir_edge_t>());
+}
+
+void ir_builder_t::close_loop(const std::vector<ir_value_t *> & phis)
+{
+	for(size_t index = 0; index < phis.size(); ++index)
+	{
+		if (phis[index] != NULL)
+		{
+			phis[index]->operands.push_back(env[index] != NULL ? env[index] : function->get_undefined(index));
+		}
+	}
+}
+
+void ir_builder_t::leave_loop()
+{
+	loops.pop_back();
+	continues.pop_back();
+	breaks.pop_back();
+}
+
+// statements
+
+void ir_builder_t::visit(statement_list_t * node)
+{
+	for(size_t index = 0; index < node->size() && block != NULL; ++index)
+	{
+		ir_site_t site = {node, node->get_at(index)};
+		sites.push_back(site);
+		node->get_at(index)->accept(this);
+		sites.pop_back();
+	}
+}
+
+// the locals of the block can't be named past it
+void ir_builder_t::visit(code_block_statement_t * node)
+{
+	node->get_body()->accept(this);
+	if (block == NULL)
+	{
+		return;
+	}
+
+	walk_statements(node->get_body(), [&](statement_t * stmt)
+	{
+		if (declaration_t * declaration = dynamic_cast<declaration_t *>(stmt))
+		{
+			env[declaration->get_index()] = NULL;
+		}
+	});
+}
+
+void ir_builder_t::visit(declaration_t * node)
+{
+	env[node->get_index()] = function->get_undefined(node->get_index());
+}
+
+void ir_builder_t::visit(assignment_t * node)
+{
+	variable_slot_t slot = node->get_slot();
+	if (!is_local(slot, node->get_array_size()))
+	{
+		ir_value_t * store = function->add_value(irStore);
+		store->statement = node;
+		store->name = node->get_id();
+		build_operand(store, node->get_value());
+		append(store);
+		return;
+	}
+
+	ir_value_t * copy = function->add_value(irCopy);
+	copy->statement = node;
+	copy->variable = slot.index;
+	build_operand(copy, node->get_value());
+	copy->copied = read;
+	append(copy);
+	env[slot.index] = copy;
+
+	if (pure)
+	{
+		ir_store_t * store = new ir_store_t();
+		store->copy = copy;
+		store->site = sites.back();
+		store->reads = leaves;
+		function->stores.push_back(store);
+	}
+}
+
+void ir_builder_t::visit(read_statement_t * node)
+{
+	read_arguments_t * args = node->get_args();
+	for(size_t index = 0; index < args->size(); ++index)
+	{
+		ir_value_t * input = append(irRead);
+		input->statement = node;
+		input->name = args->get_name(index);
+		if (args->get_at(index).depth == 0)
+		{
+			input->variable = args->get_at(index).index;
+			env[input->variable] = input;
+		}
+	}
+}
+
+void ir_builder_t::visit(write_statement_t * node)
+{
+	ir_value_t * output = function->add_value(irWrite);
+	output->statement = node;
+	write_arguments_t * args = node->get_args();
+	for(size_t index = 0; index < args->size(); ++index)
+	{
+		if (!args->is_message(index))
+		{
+			build_operand(output, args->get_expression(index));
+		}
+	}
+	append(output);
+}
+
+void ir_builder_t::visit(return_statement_t * node)
+{
+	ir_value_t * result = append(irReturn);
+	result->statement = node;
+	method_t * method = function->method;
+	if (method->get_return_type() != vtNoType)
+	{
+		ir_value_t * value = env[method->get_result_index()];
+		result->operands.push_back(value != NULL ? value : function->get_undefined(method->get_result_index()));
+	}
+	block = NULL;
+}
+
+void ir_builder_t::visit(conditional_statement_t * node)
+{
+	ir_value_t * condition = function->add_value(irBranch);
+	build_operand(condition, node->get_condition());
+	ir_block_t * on_true;
+	ir_block_t * on_false;
+	branch(condition, on_true, on_false);
+	std::vector<ir_value_t *> saved = env;
+	std::vector<ir_edge_t> edges;
+
+	block = on_true;
+	node->get_true_way()->accept(this);
+	edges.push_back(ir_edge_t(block, env));
+
+	block = on_false;
+	env = saved;
+	if (node->get_false_way() != NULL)
+	{
+		node->get_false_way()->accept(this);
+	}
+	edges.push_back(ir_edge_t(block, env));
+	merge(edges);
+}
+
+// the body runs before the condition, CYCLE goes on to the condition
+void ir_builder_t::visit(while_statement_t * node)
+{
+	ir_loop_t * loop = add_loop(node);
+	ir_block_t * header = function->add_block();
+	jump(header);
+
+	std::vector<ir_value_t *> phis;
+	enter_loop(loop, header, node->get_body(), IR_NO_VARIABLE, phis);
+	node->get_body()->accept(this);
+	continues.back().push_back(ir_edge_t(block, env));
+	merge(continues.back());
+
+	std::vector<ir_edge_t> exits = breaks.back();
+	if (block != NULL)
+	{
+		at_start = false;
+		ir_value_t * test = function->add_value(irBranch);
+		build_operand(test, node->get_condition());
+		at_start = true;
+		append(test);
+
+		ir_block_t * exit = function->add_block();
+		link(block, header);
+		link(block, exit);
+		close_loop(phis);
+		exits.push_back(ir_edge_t(exit, env));
+	}
+	leave_loop();
+	merge(exits);
+}
+
+// the iterations are counted on entry; the variable is assigned the first
+// value even when there are none
+void ir_builder_t::visit(do_statement_t * node)
+{
+	size_t variable = node->get_slot().depth == 0 ? node->get_slot().index : IR_NO_VARIABLE;
+
+	if (dynamic_cast<do_concurrent_statement_t *>(node) != NULL)
+	{
+		// the body is not looked into, so it may read any local
+		ir_value_t * concurrent = function->add_value(irConcurrent);
+		concurrent->statement = node;
+		build_operand(concurrent, node->get_first());
+		build_operand(concurrent, node->get_last());
+		if (node->get_step() != NULL)
+		{
+			build_operand(concurrent, node->get_step());
+		}
+		for(size_t index = 0; index < env.size(); ++index)
+		{
+			if (env[index] != NULL)
+			{
+				concurrent->operands.push_back(env[index]);
+			}
+		}
+		append(concurrent);
+
+		std::vector<bool> assigned(env.size(), false);
+		collect_assigned(node->get_body(), assigned);
+		if (variable != IR_NO_VARIABLE)
+		{
+			assigned[variable] = true;
+		}
+		for(size_t index = 0; index < env.size(); ++index)
+		{
+			if (assigned[index])
+			{
+				ir_value_t * opaque = append(irOpaque);
+				opaque->variable = index;
+				opaque->operands.push_back(concurrent);
+				env[index] = opaque;
+			}
+		}
+		return;
+	}
+
+	ir_value_t * trip = function->add_value(irTrip);
+	trip->statement = node;
+	build_operand(trip, node->get_first());
+	build_operand(trip, node->get_last());
+	if (node->get_step() != NULL)
+	{
+		build_operand(trip, node->get_step());
+	}
+	else
+	{
+		variant_t one;
+		one.type = vtInt;
+		one.int_value = 1;
+		trip->operands.push_back(function->get_constant(one));
+	}
+
+	ir_loop_t * loop = add_loop(node);
+	append(trip);
+	ir_value_t * test = function->add_value(irBranch);
+	test->operands.push_back(trip);
+	ir_block_t * header;
+	ir_block_t * skip;
+	branch(test, header, skip);
+
+	if (variable != IR_NO_VARIABLE)
+	{
+		env[variable] = trip->operands[0];
+	}
+	std::vector<ir_edge_t> exits;
+	exits.push_back(ir_edge_t(skip, env));
+
+	std::vector<ir_value_t *> phis;
+	enter_loop(loop, header, node->get_body(), variable, phis);
+	node->get_body()->accept(this);
+	continues.back().push_back(ir_edge_t(block, env));
+	merge(continues.back());
+
+	if (block != NULL)
+	{
+		if (variable != IR_NO_VARIABLE)
+		{
+			ir_value_t * next = append(irBinary);
+			next->op = opAdd;
+			next->variable = variable;
+			next->operands.push_back(env[variable]);
+			next->operands.push_back(trip->operands[2]);
+			env[variable] = next;
+		}
+		ir_value_t * more = append(irTrip);
+		more->operands.push_back(trip);
+		test = append(irBranch);
+		test->operands.push_back(more);
+
+		ir_block_t * done = function->add_block();
+		link(block, header);
+		link(block, done);
+		close_loop(phis);
+		exits.push_back(ir_edge_t(done, env));
+	}
+	std::vector<ir_edge_t> & loop_breaks = breaks.back();
+	exits.insert(exits.end(), loop_breaks.begin(), loop_breaks.end());
+	leave_loop();
+	merge(exits);
+}
+
+void ir_builder_t::visit(break_statement_t * node)
+{
+	if (breaks.empty())
+	{
+		append(irReturn);
+	}
+	else
+	{
+		breaks.back().push_back(ir_edge_t(block, env));
+	}
+	block = NULL;
+}
+
+void ir_builder_t::visit(cycle_statement_t * node)
+{
+	if (continues.empty())
+	{
+		append(irReturn);
+	}
+	else
+	{
+		continues.back().push_back(ir_edge_t(block, env));
+	}
+	block = NULL;
+}
+
+void ir_builder_t::visit(invoke_statement_t * node)
+{
+	node->get_invokee()->accept(this);
+}
+
+void ir_builder_t::visit(array_declaration_t * node)
+{
+	ir_value_t * store = append(irStore);
+	store->statement = node;
+	store->name = node->get_id();
+}
+
+void ir_builder_t::visit(element_assignment_t * node)
+{
+	ir_value_t * store = function->add_value(irStore);
+	store->statement = node;
+	store->name = node->get_id();
+	build_operand(store, node->get_index());
+	build_operand(store, node->get_value());
+	append(store);
+}
+
+// expressions
+
+void ir_builder_t::visit(constant_t * node)
+{
+	value = function->get_constant(node->get_value());
+	read = NULL;
+	pure = node->get_value().type == vtInt;
+	leaves.clear();
+	expression = NULL;
+}
+
+// a read of a local refers to its value; when that is a copy of another
+// local which still holds the value copied, the read may go to that one
+void ir_builder_t::visit(variable_expression_t * node)
+{
+	variable_slot_t slot = node->get_slot();
+	if (!is_local(slot, node->get_array_size()))
+	{
+		value = append(irLoad);
+		value->expression = node;
+		value->name = node->get_id();
+		read = NULL;
+		pure = false;
+		leaves.clear();
+		expression = NULL;
+		return;
+	}
+
+	ir_value_t * current = env[slot.index];
+	if (current == NULL)
+	{
+		current = function->get_undefined(slot.index);
+	}
+
+	read = new ir_read_t();
+	read->node = node;
+	read->user = NULL;
+	read->operand = 0;
+	read->variable = slot.index;
+	read->value = current;
+	read->source = slot.index;
+	read->source_value = current;
+	function->reads.push_back(read);
+
+	if (current->opcode == irCopy && current->copied != NULL)
+	{
+		ir_read_t * copied = current->copied;
+		if (env[copied->source] == copied->source_value)
+		{
+			read->source = copied->source;
+			read->source_value = copied->source_value;
+		}
+		else if (env[copied->variable] == copied->value)
+		{
+			read->source = copied->variable;
+			read->source_value = copied->value;
+		}
+	}
+
+	value = current;
+	pure = node->typecheck() == vtInt;
+	leaves.assign(1, read);
+	expression = NULL;
+}
+
+void ir_builder_t::visit(binary_expression_t * node)
+{
+	ir_value_t * result = function->add_value(irBinary);
+	result->op = node->get_operation();
+	result->expression = node;
+
+	build_operand(result, node->get_left());
+	bool left_pure = pure;
+	std::vector<ir_read_t *> reads = leaves;
+	ir_expression_t * left = expression;
+
+	build_operand(result, node->get_right());
+	bool right_pure = pure;
+	reads.insert(reads.end(), leaves.begin(), leaves.end());
+	ir_expression_t * right = expression;
+	append(result);
+
+	operation op = node->get_operation();
+	value = result;
+	read = NULL;
+	pure = left_pure && right_pure && (op == opAdd || op == opSub || op == opMul) && node->get_array_size() == 0;
+	if (!pure)
+	{
+		leaves.clear();
+		expression = NULL;
+		return;
+	}
+
+	expression = new ir_expression_t();
+	expression->value = result;
+	expression->node = node;
+	expression->sites = sites;
+	expression->at_start = at_start;
+	expression->reads = reads;
+	expression->loops = loops;
+	expression->parent = NULL;
+	expression->taken = false;
+	if (left != NULL)
+	{
+		left->parent = expression;
+		expression->children.push_back(left);
+	}
+	if (right != NULL)
+	{
+		right->parent = expression;
+		expression->children.push_back(right);
+	}
+	function->expressions.push_back(expression);
+	leaves = reads;
+}
+
+void ir_builder_t::visit(short_circuit_expression_t * node)
+{
+	ir_value_t * result = function->add_value(irBinary);
+	result->op = node->get_operation();
+	result->expression = node;
+	build_operand(result, node->get_left());
+	build_operand(result, node->get_right());
+	append(result);
+
+	value = result;
+	read = NULL;
+	pure = false;
+	leaves.clear();
+	expression = NULL;
+}
+
+void ir_builder_t::visit(invocation_expression_t * node)
+{
+	ir_value_t * call = function->add_value(irCall);
+	call->expression = node;
+	call->name = node->get_method_id();
+	parameter_list_t * params = node->get_params();
+	for(size_t index = 0; index < params->size(); ++index)
+	{
+		build_operand(call, params->get_at(index));
+	}
+	append(call);
+
+	value = call;
+	read = NULL;
+	pure = false;
+	leaves.clear();
+	expression = NULL;
+}
+
+void ir_builder_t::visit(element_expression_t * node)
+{
+	ir_value_t * load = function->add_value(irLoad);
+	load->expression = node;
+	load->name = node->get_id();
+	build_operand(load, node->get_index());
+	append(load);
+
+	value = load;
+	read = NULL;
+	pure = false;
+	leaves.clear();
+	expression = NULL;
+}
+
+void ir_builder_t::visit(reduction_expression_t * node)
+{
+	ir_value_t * reduction = function->add_value(irReduction);
+	reduction->expression = node;
+	reduction->name = node->get_reduction() == reduction_expression_t::rtSum ? "SUM" : "MAXVAL";
+	build_operand(reduction, node->get_arg());
+	append(reduction);
+
+	value = reduction;
+	read = NULL;
+	pure = false;
+	leaves.clear();
+	expression = NULL;
+}
+
+// ir_optimizer_t
+
+// Operations on the same value numbers compute the same value; a copy has
+// the number of what it copies
+class value_numbering_t
+{
+private:
+	std::map<ir_value_t *, size_t> numbers;
+	std::map<std::pair<int, std::pair<size_t, size_t> >, size_t> keys;
+
+	size_t add_key(int kind, size_t first, size_t second)
+	{
+		std::pair<int, std::pair<size_t, size_t> > key(kind, std::make_pair(first, second));
+		auto it = keys.find(key);
+		if (it != keys.end())
+		{
+			return it->second;
+		}
+		size_t number = numbers.size() + keys.size();
+		keys.insert(std::make_pair(key, number));
+		return number;
+	}
+
+public:
+	size_t get(ir_value_t * value)
+	{
+		value = resolve_value(value);
+		auto it = numbers.find(value);
+		if (it != numbers.end())
+		{
+			return it->second;
+		}
+
+		size_t number;
+		if (value->opcode == irConstant)
+		{
+			number = add_key(-1 - (int)value->constant.type, (size_t)(unsigned int)value->constant.int_value, 0);
+		}
+		else if (value->opcode == irCopy)
+		{
+			number = get(value->operands[0]);
+		}
+		else if (value->opcode == irBinary && value->expression != NULL && value->operands.size() == 2)
+		{
+			size_t first = get(value->operands[0]);
+			size_t second = get(value->operands[1]);
+			if ((value->op == opAdd || value->op == opMul) && second < first)
+			{
+				std::swap(first, second);
+			}
+			number = add_key(value->op, first, second);
+		}
+		else
+		{
+			number = add_key(-100, (size_t)value, 0);
+		}
+		numbers.insert(std::make_pair(value, number));
+		return number;
+	}
+};
+
+static bool reads_defined(const std::vector<ir_read_t *> & reads)
+{
+	for(size_t index = 0; index < reads.size(); ++index)
+	{
+		if (resolve_value(reads[index]->value)->maybe_undefined)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// an expression inside one replaced already goes with it
+static bool is_taken(ir_expression_t * expression)
+{
+	for(; expression != NULL; expression = expression->parent)
+	{
+		if (expression->taken)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// the values of the expression and of those inside it, operands first
+static void collect_values(ir_expression_t * expression, std::vector<ir_value_t *> & values)
+{
+	for(size_t index = 0; index < expression->children.size(); ++index)
+	{
+		collect_values(expression->children[index], values);
+	}
+	values.push_back(expression->value);
+}
+
+static void remove_value(ir_value_t * value)
+{
+	std::vector<ir_value_t *> & values = value->block->values;
+	values.erase(std::find(values.begin(), values.end(), value));
+}
+
+ir_optimizer_t::ir_optimizer_t(bool passes, FILE * dump_stream)
+{
+	this->passes = passes;
+	this->dump_stream = dump_stream;
+}
+
+void ir_optimizer_t::install(program_t * program)
+{
+	std::vector<method_t *> methods;
+	methods.push_back(program->get_main());
+	for(auto it = program->get_methods().begin(); it != program->get_methods().end(); ++it)
+	{
+		methods.push_back(it->second);
+	}
+
+	bool changed = false;
+	for(size_t index = 0; index < methods.size(); ++index)
+	{
+		method_t * method = methods[index];
+		const char * kind = method == program->get_main() ? "PROGRAM" : method->get_return_type() == vtNoType ? "SUBROUTINE" : "FUNCTION";
+		std::unique_ptr<ir_function_t> function(new ir_function_t(method, kind));
+
+		ir_builder_t builder(function.get());
+		builder.build();
+		if (passes)
+		{
+			propagate_copies(function.get());
+			mark_live(function.get());
+			remove_dead_stores(function.get());
+			mark_defined(function.get());
+			hoist_invariants(function.get());
+			eliminate_common(function.get());
+			sweep(function.get());
+			changed = changed || function->copies_propagated != 0 || function->stores_removed != 0 || function->temporaries != 0;
+		}
+		if (dump_stream != NULL)
+		{
+			dump(dump_stream, function.get(), index == 0);
+		}
+	}
+
+	if (changed)
+	{
+		program->resolve();
+		program->typecheck();
+	}
+}
+
+void ir_optimizer_t::propagate_copies(ir_function_t * function)
+{
+	for(size_t index = 0; index < function->reads.size(); ++index)
+	{
+		ir_read_t * read = function->reads[index];
+		if (read->source == read->variable || read->user == NULL)
+		{
+			continue;
+		}
+
+		read->user->operands[read->operand] = resolve_value(read->source_value);
+		read->node->rename(function->names[read->source]);
+		read->variable = read->source;
+		read->value = read->source_value;
+		function->copies_propagated++;
+	}
+}
+
+// the values the effects of the method depend on; an assignment is one
+// unless it can't fail and may be removed
+void ir_optimizer_t::mark_live(ir_function_t * function)
+{
+	std::set<ir_value_t *> removable;
+	for(size_t index = 0; index < function->stores.size(); ++index)
+	{
+		if (reads_defined(function->stores[index]->reads))
+		{
+			removable.insert(function->stores[index]->copy);
+		}
+	}
+
+	std::vector<ir_value_t *> work;
+	for(size_t index = 0; index < function->values.size(); ++index)
+	{
+		ir_value_t * value = function->values[index];
+		value->live = false;
+		if (value->forward != NULL || value->block == NULL)
+		{
+			continue;
+		}
+
+		switch (value->opcode)
+		{
+		case irCopy:
+			if (removable.count(value) != 0)
+			{
+				break;
+			}
+		case irCall:
+		case irRead:
+		case irStore:
+		case irWrite:
+		case irConcurrent:
+		case irJump:
+		case irBranch:
+		case irReturn:
+			value->live = true;
+			work.push_back(value);
+			break;
+		default:
+			break;
+		}
+	}
+
+	while (!work.empty())
+	{
+		ir_value_t * value = work.back();
+		work.pop_back();
+		for(size_t index = 0; index < value->operands.size(); ++index)
+		{
+			ir_value_t * operand = resolve_value(value->operands[index]);
+			if (!operand->live)
+			{
+				operand->live = true;
+				work.push_back(operand);
+			}
+		}
+	}
+}
+
+void ir_optimizer_t::remove_dead_stores(ir_function_t * function)
+{
+	for(size_t index = 0; index < function->stores.size(); ++index)
+	{
+		ir_store_t * store = function->stores[index];
+		if (store->copy->live || !reads_defined(store->reads))
+		{
+			continue;
+		}
+
+		ir_site_t & site = store->site;
+		site.list->remove_at(index_of(site.list, site.statement));
+		remove_value(store->copy);
+		store->copy->block = NULL;
+		function->stores_removed++;
+	}
+}
+
+// An expression whose locals hold the values they have before a loop
+// around it is computed once before the outermost such loop; the same
+// expression in the loop takes the same temporary
+void ir_optimizer_t::hoist_invariants(ir_function_t * function)
+{
+	value_numbering_t numbering;
+	std::map<std::pair<ir_loop_t *, size_t>, std::pair<std::string, ir_value_t *> > hoisted;
+
+	// parents come after their operands
+	for(size_t index = function->expressions.size(); index-- > 0;)
+	{
+		ir_expression_t * expression = function->expressions[index];
+		if (is_taken(expression) || !expression->value->live || expression->reads.empty() || !reads_defined(expression->reads))
+		{
+			continue;
+		}
+
+		ir_loop_t * target = NULL;
+		for(size_t loop = 0; loop < expression->loops.size() && target == NULL; ++loop)
+		{
+			ir_loop_t * candidate = expression->loops[loop];
+			bool invariant = true;
+			for(size_t read = 0; read < expression->reads.size() && invariant; ++read)
+			{
+				ir_read_t * leaf = expression->reads[read];
+				ir_value_t * entry = candidate->entry[leaf->variable];
+				invariant = entry != NULL && resolve_value(entry) == resolve_value(leaf->value);
+			}
+			if (invariant)
+			{
+				target = candidate;
+			}
+		}
+		if (target == NULL)
+		{
+			continue;
+		}
+
+		std::pair<ir_loop_t *, size_t> key(target, numbering.get(expression->value));
+		auto it = hoisted.find(key);
+		if (it == hoisted.end())
+		{
+			std::string name = add_temporary(function, target->site, expression->node);
+			it = hoisted.insert(std::make_pair(key, std::make_pair(name, expression->value))).first;
+
+			// before the jump or branch into the loop
+			std::vector<ir_value_t *> values;
+			collect_values(expression, values);
+			std::vector<ir_value_t *> & preheader = target->preheader->values;
+			for(size_t value = 0; value < values.size(); ++value)
+			{
+				remove_value(values[value]);
+				values[value]->block = target->preheader;
+				preheader.insert(preheader.end() - 1, values[value]);
+			}
+			function->expressions_hoisted++;
+		}
+		else
+		{
+			expression->value->forward = it->second.second;
+		}
+
+		variable_expression_t * temporary = new variable_expression_t(it->second.first.c_str());
+		temporary->set_line(expression->node->get_line());
+		expression->node->replace_with(temporary);
+		expression->taken = true;
+	}
+}
+
+// An expression computed again where its locals still hold the values they
+// had at an earlier one is computed once, into a temporary assigned before
+// the statement of the first. The later ones have to be in that statement
+// or after it in its list.
+void ir_optimizer_t::eliminate_common(ir_function_t * function)
+{
+	value_numbering_t numbering;
+	std::map<size_t, std::vector<ir_expression_t *> > groups;
+	for(size_t index = 0; index < function->expressions.size(); ++index)
+	{
+		ir_expression_t * expression = function->expressions[index];
+		if (expression->value->live && !expression->reads.empty())
+		{
+			groups[numbering.get(expression->value)].push_back(expression);
+		}
+	}
+
+	// parents come after their operands
+	for(size_t index = function->expressions.size(); index-- > 0;)
+	{
+		ir_expression_t * first = function->expressions[index];
+		auto group = groups.find(numbering.get(first->value));
+		if (group == groups.end() || group->second.size() < 2)
+		{
+			continue;
+		}
+
+		std::vector<ir_expression_t *> & members = group->second;
+		first = NULL;
+		for(size_t member = 0; member < members.size() && first == NULL; ++member)
+		{
+			if (!is_taken(members[member]) && members[member]->at_start)
+			{
+				first = members[member];
+			}
+		}
+		if (first == NULL || !reads_defined(first->reads))
+		{
+			continue;
+		}
+
+		const ir_site_t & site = first->sites.back();
+		size_t first_index = index_of(site.list, site.statement);
+		std::vector<ir_expression_t *> later;
+		for(size_t member = 0; member < members.size(); ++member)
+		{
+			ir_expression_t * expression = members[member];
+			if (expression == first || is_taken(expression))
+			{
+				continue;
+			}
+			for(size_t outer = 0; outer < expression->sites.size(); ++outer)
+			{
+				if (expression->sites[outer].list == site.list)
+				{
+					if (index_of(site.list, expression->sites[outer].statement) >= first_index)
+					{
+						later.push_back(expression);
+					}
+					break;
+				}
+			}
+		}
+		if (later.empty())
+		{
+			continue;
+		}
+
+		std::string name = add_temporary(function, site, first->node);
+		later.push_back(first);
+		for(size_t member = 0; member < later.size(); ++member)
+		{
+			ir_expression_t * expression = later[member];
+			variable_expression_t * temporary = new variable_expression_t(name.c_str());
+			temporary->set_line(expression->node->get_line());
+			expression->node->replace_with(temporary);
+			expression->taken = true;
+			if (expression != first)
+			{
+				expression->value->forward = first->value;
+				function->common_subexpressions++;
+			}
+		}
+	}
+}
+
+// drops the values replaced and those nothing depends on any more
+void ir_optimizer_t::sweep(ir_function_t * function)
+{
+	std::vector<ir_value_t *> & values = function->values;
+	for(size_t index = 0; index < values.size(); ++index)
+	{
+		for(size_t operand = 0; operand < values[index]->operands.size(); ++operand)
+		{
+			values[index]->operands[operand] = resolve_value(values[index]->operands[operand]);
+		}
+	}
+	mark_live(function);
+
+	for(size_t index = 0; index < function->blocks.size(); ++index)
+	{
+		std::vector<ir_value_t *> & block_values = function->blocks[index]->values;
+		block_values.erase(std::remove_if(block_values.begin(), block_values.end(), [](ir_value_t * value)
+		{
+			return value->forward != NULL || (!value->live && value->opcode != irCopy);
+		}), block_values.end());
+	}
+}
+
+// the tree optimizer drops only reads which can't fail, as the dead stores;
+// the temporaries take the copies of the reads marked
+void ir_optimizer_t::mark_defined(ir_function_t * function)
+{
+	for(size_t index = 0; index < function->reads.size(); ++index)
+	{
+		ir_read_t * read = function->reads[index];
+		if (!resolve_value(read->value)->maybe_undefined)
+		{
+			read->node->set_defined();
+		}
+	}
+}
+
+// declares a temporary assigned a copy of the node before the statement
+// of the site; the statements have no line, so the profiler leaves them
+// out as those the parser adds
+std::string ir_optimizer_t::add_temporary(ir_function_t * function, ir_site_t site, binary_expression_t * node)
+{
+	char name[VALUE_BUFFER_SIZE];
+	sprintf(name, "$%u", (unsigned int)++function->temporaries);
+
+	tree_cloner_t cloner(NULL);
+	declaration_t * declaration = new declaration_t(name, vtInt);
+	assignment_t * assignment = new assignment_t(name, cloner.clone_expression(node));
+
+	size_t index = index_of(site.list, site.statement);
+	site.list->insert_at(index, assignment);
+	site.list->insert_at(index, declaration);
+	return name;
+}
+
+static void dump_operand(FILE * stream, ir_value_t * value)
+{
+	char buffer[VALUE_BUFFER_SIZE];
+	if (value->opcode == irConstant)
+	{
+		fputs(to_string(value->constant, buffer), stream);
+	}
+	else if (value->opcode == irUndefined)
+	{
+		fputs("undef", stream);
+	}
+	else
+	{
+		fprintf(stream, "%%%u", (unsigned int)value->id);
+	}
+}
+
+// after a space
+static void dump_operands(FILE * stream, ir_value_t * value, size_t first)
+{
+	for(size_t index = first; index < value->operands.size(); ++index)
+	{
+		fputs(index == first ? " " : ", ", stream);
+		dump_operand(stream, value->operands[index]);
+	}
+}
+
+// the values the others refer to, which get a number
+static bool has_result(ir_value_t * value)
+{
+	switch (value->opcode)
+	{
+	case irStore:
+	case irWrite:
+	case irConcurrent:
+	case irJump:
+	case irBranch:
+	case irReturn:
+		return false;
+	default:
+		return true;
+	}
+}
+
+void ir_optimizer_t::dump(FILE * stream, ir_function_t * function, bool first)
+{
+	method_t * method = function->method;
+	fprintf(stream, "%s%s %s", first ? "" : "\n", function->kind, method->get_id());
+	for(size_t index = 0; index < method->get_arguments_count(); ++index)
+	{
+		fprintf(stream, "%s%s", index == 0 ? "(" : ", ", method->get_arguments()->get_at(index)->get_id().c_str());
+	}
+	fputs(method->get_arguments_count() != 0 ? ")\n" : "\n", stream);
+	if (passes)
+	{
+		fprintf(stream, "; %u copies propagated, %u dead stores removed, %u invariants hoisted, %u common subexpressions\n",
+			(unsigned int)function->copies_propagated, (unsigned int)function->stores_removed,
+			(unsigned int)function->expressions_hoisted, (unsigned int)function->common_subexpressions);
+	}
+
+	size_t next_id = 0;
+	for(size_t index = 0; index < function->blocks.size(); ++index)
+	{
+		std::vector<ir_value_t *> & values = function->blocks[index]->values;
+		for(size_t value = 0; value < values.size(); ++value)
+		{
+			if (has_result(values[value]))
+			{
+				values[value]->id = next_id++;
+			}
+		}
+	}
+
+	for(size_t index = 0; index < function->blocks.size(); ++index)
+	{
+		ir_block_t * block = function->blocks[index];
+		fprintf(stream, "b%u:", (unsigned int)block->id);
+		for(size_t predecessor = 0; predecessor < block->predecessors.size(); ++predecessor)
+		{
+			fprintf(stream, "%s b%u", predecessor == 0 ? "\t\t; from" : ",", (unsigned int)block->predecessors[predecessor]->id);
+		}
+		fputs("\n", stream);
+
+		for(size_t position = 0; position < block->values.size(); ++position)
+		{
+			ir_value_t * value = block->values[position];
+			fputs("\t", stream);
+			if (has_result(value))
+			{
+				fprintf(stream, "%%%u = ", (unsigned int)value->id);
+			}
+
+			switch (value->opcode)
+			{
+			case irArgument:
+				fprintf(stream, "argument %d", value->constant.int_value);
+				break;
+			case irPhi:
+				fputs("phi", stream);
+				dump_operands(stream, value, 0);
+				break;
+			case irCopy:
+				dump_operand(stream, value->operands[0]);
+				break;
+			case irBinary:
+				dump_operand(stream, value->operands[0]);
+				fprintf(stream, " %s ", to_string(value->op));
+				dump_operand(stream, value->operands[1]);
+				break;
+			case irCall:
+				fprintf(stream, "call %s(", value->name.c_str());
+				for(size_t index = 0; index < value->operands.size(); ++index)
+				{
+					fputs(index == 0 ? "" : ", ", stream);
+					dump_operand(stream, value->operands[index]);
+				}
+				fputs(")", stream);
+				break;
+			case irLoad:
+			case irReduction:
+				fprintf(stream, "%s %s", value->opcode == irLoad ? "load" : "reduce", value->name.c_str());
+				if (!value->operands.empty())
+				{
+					fputs("(", stream);
+					dump_operand(stream, value->operands[0]);
+					fputs(")", stream);
+				}
+				break;
+			case irRead:
+				fputs("read", stream);
+				if (value->variable == IR_NO_VARIABLE)
+				{
+					fprintf(stream, " %s", value->name.c_str());
+				}
+				break;
+			case irOpaque:
+				fputs("concurrent result", stream);
+				break;
+			case irTrip:
+				fputs("trip", stream);
+				dump_operands(stream, value, 0);
+				break;
+			case irStore:
+				fprintf(stream, "store %s", value->name.c_str());
+				if (value->operands.size() == 2)
+				{
+					fputs("(", stream);
+					dump_operand(stream, value->operands[0]);
+					fputs(")", stream);
+				}
+				if (!value->operands.empty())
+				{
+					fputs(", ", stream);
+					dump_operand(stream, value->operands.back());
+				}
+				break;
+			case irWrite:
+				fputs("write", stream);
+				dump_operands(stream, value, 0);
+				break;
+			case irConcurrent:
+				fputs("concurrent", stream);
+				dump_operands(stream, value, 0);
+				break;
+			case irJump:
+				fprintf(stream, "jump b%u", (unsigned int)block->successors[0]->id);
+				break;
+			case irBranch:
+				fputs("branch ", stream);
+				dump_operand(stream, value->operands[0]);
+				fprintf(stream, ", b%u, b%u", (unsigned int)block->successors[0]->id, (unsigned int)block->successors[1]->id);
+				break;
+			case irReturn:
+				fputs("return", stream);
+				dump_operands(stream, value, 0);
+				break;
+			default:
+				break;
+			}
+
+			if (value->variable != IR_NO_VARIABLE && !function->names[value->variable].empty())
+			{
+				fprintf(stream, "\t\t; %s", function->names[value->variable].c_str());
+			}
+			fputs("\n", stream);
+		}
+	}
+}
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "syntax_engine.h"
+
+// Mid-level IR of the methods (--dump-ir): a graph of basic blocks in SSA
+// form built from a checked tree, with a value per local that every read
+// of it refers to. The passes on it propagate copies of locals, remove the
+// assignments nobody reads, move integer arithmetic on invariant locals out
+// of loops and compute a repeated one once. Their results are put back into
+// the tree, which every engine runs: the reads are renamed, the dead
+// assignments removed and a hoisted or common expression becomes a
+// temporary assigned before the loop or its first use. Arrays, fields,
+// calls and DO CONCURRENT stay opaque.
+
+enum ir_opcode
+{
+	irConstant,
+	irArgument,
+	// value of a local before its first assignment, reading it is an error
+	irUndefined,
+	irPhi,
+	// assignment of a local
+	irCopy,
+	irBinary,
+	irCall,
+	// element, whole array or field
+	irLoad,
+	irReduction,
+	irRead,
+	// local assigned by a DO CONCURRENT
+	irOpaque,
+	// whether a counted DO has iterations (left)
+	irTrip,
+	irStore,
+	irWrite,
+	irConcurrent,
+	irJump,
+	irBranch,
+	irReturn
+};
+
+// no local
+const size_t IR_NO_VARIABLE = (size_t)-1;
+
+struct ir_block_t;
+struct ir_read_t;
+
+struct ir_value_t
+{
+	size_t id;
+	ir_opcode opcode;
+	operation op;
+	variant_t constant;
+	std::vector<ir_value_t *> operands;
+	// NULL for constants and undefined values
+	ir_block_t * block;
+	// local assigned or merged
+	size_t variable;
+	// set when the value is replaced by another one
+	ir_value_t * forward;
+	// read a copy of a local takes its value from
+	ir_read_t * copied;
+	statement_t * statement;
+	expression_t * expression;
+	// callee or array
+	std::string name;
+	bool live;
+	bool maybe_undefined;
+};
+
+struct ir_block_t
+{
+	size_t id;
+	// phis first, the terminator last
+	std::vector<ir_value_t *> values;
+	std::vector<ir_block_t *> predecessors;
+	// of a branch the true way first
+	std::vector<ir_block_t *> successors;
+};
+
+// Statement of a list, where a temporary can be put
+struct ir_site_t
+{
+	statement_list_t * list;
+	statement_t * statement;
+};
+
+// Read of a local; copy propagation makes it read the local copied
+// instead (source), when that still holds the value
+struct ir_read_t
+{
+	variable_expression_t * node;
+	ir_value_t * user;
+	size_t operand;
+	size_t variable;
+	ir_value_t * value;
+	size_t source;
+	ir_value_t * source_value;
+};
+
+struct ir_loop_t
+{
+	statement_t * statement;
+	ir_site_t site;
+	// locals before the loop statement
+	std::vector<ir_value_t *> entry;
+	ir_block_t * preheader;
+};
+
+// + - * of int locals and constants, which can't fail, so it may be
+// computed anywhere its locals hold the same values
+struct ir_expression_t
+{
+	ir_value_t * value;
+	binary_expression_t * node;
+	// innermost statement and those around it
+	std::vector<ir_site_t> sites;
+	// evaluated before anything else of the statement
+	bool at_start;
+	std::vector<ir_read_t *> reads;
+	// innermost last
+	std::vector<ir_loop_t *> loops;
+	ir_expression_t * parent;
+	std::vector<ir_expression_t *> children;
+	// hoisted, or part of an expression replaced already
+	bool taken;
+};
+
+// Assignment of a local that can't fail, removed when it is dead
+struct ir_store_t
+{
+	ir_value_t * copy;
+	ir_site_t site;
+	std::vector<ir_read_t *> reads;
+};
+
+struct ir_function_t
+{
+	method_t * method;
+	const char * kind;
+	std::vector<std::string> names;
+	std::vector<ir_block_t *> blocks;
+	std::vector<ir_value_t *> values;
+	// by type and value
+	std::map<std::pair<int, int>, ir_value_t *> constants;
+	std::vector<ir_value_t *> undefined;
+	std::vector<ir_read_t *> reads;
+	std::vector<ir_loop_t *> loops;
+	std::vector<ir_expression_t *> expressions;
+	std::vector<ir_store_t *> stores;
+	size_t temporaries;
+	size_t copies_propagated;
+	size_t stores_removed;
+	size_t expressions_hoisted;
+	size_t common_subexpressions;
+
+	ir_function_t(method_t * method, const char * kind);
+	~ir_function_t();
+
+	ir_value_t * add_value(ir_opcode opcode);
+	ir_block_t * add_block();
+	ir_value_t * get_constant(variant_t value);
+	ir_value_t * get_undefined(size_t variable);
+};
+
+class ir_optimizer_t
+{
+private:
+	bool passes;
+	FILE * dump_stream;
+
+	void propagate_copies(ir_function_t * function);
+	void mark_live(ir_function_t * function);
+	void remove_dead_stores(ir_function_t * function);
+	void hoist_invariants(ir_function_t * function);
+	void eliminate_common(ir_function_t * function);
+	void sweep(ir_function_t * function);
+	void mark_defined(ir_function_t * function);
+	std::string add_temporary(ir_function_t * function, ir_site_t site, binary_expression_t * node);
+	void dump(FILE * stream, ir_function_t * function, bool first);
+
+public:
+	// without passes the IR is only built, for the dump; with a stream the
+	// IR of every function is dumped to it
+	ir_optimizer_t(bool passes, FILE * dump_stream);
+
+	// the program has to be typechecked; it is resolved and typechecked
+	// again when a pass changed it. The IR of a function is freed once it
+	// is lowered back to the tree
+	void install(program_t * program);
+};
+
+// way into a block with the values of the locals on it
+typedef std::pair<ir_block_t *, std::vector<ir_value_t *> > ir_edge_t;
+
+// Builds the IR of a method body
+class ir_builder_t : public ast_visitor_t
+{
+private:
+	ir_function_t * function;
+	// NULL in code that can't be reached
+	ir_block_t * block;
+	std::vector<ir_value_t *> env;
+	std::vector<ir_site_t> sites;
+	std::vector<ir_loop_t *> loops;
+	// edges of CYCLE and EXIT of every loop
+	std::vector<std::vector<ir_edge_t> > continues;
+	std::vector<std::vector<ir_edge_t> > breaks;
+	bool at_start;
+
+	// result of the expression visited last
+	ir_value_t * value;
+	ir_read_t * read;
+	bool pure;
+	std::vector<ir_read_t *> leaves;
+	ir_expression_t * expression;
+
+	ir_value_t * append(ir_value_t * value);
+	ir_value_t * append(ir_opcode opcode);
+	void build_operand(ir_value_t * user, expression_t * expr);
+	void link(ir_block_t * from, ir_block_t * to);
+	void jump(ir_block_t * to);
+	// ends the block with the branch, its ways are new blocks
+	void branch(ir_value_t * terminator, ir_block_t *& on_true, ir_block_t *& on_false);
+	void merge(const std::vector<ir_edge_t> & edges);
+	ir_loop_t * add_loop(statement_t * stmt);
+	void enter_loop(ir_loop_t * loop, ir_block_t * header, statement_t * body, size_t variable, std::vector<ir_value_t *> & phis);
+	void close_loop(const std::vector<ir_value_t *> & phis);
+	void leave_loop();
+	void finish();
+
+public:
+	ir_builder_t(ir_function_t * function);
+
+	void build();
+
+	void visit(statement_list_t * node);
+	void visit(code_block_statement_t * node);
+	void visit(declaration_t * node);
+	void visit(assignment_t * node);
+	void visit(read_statement_t * node);
+	void visit(write_statement_t * node);
+	void visit(return_statement_t * node);
+	void visit(conditional_statement_t * node);
+	void visit(while_statement_t * node);
+	void visit(do_statement_t * node);
+	void visit(break_statement_t * node);
+	void visit(cycle_statement_t * node);
+	void visit(invoke_statement_t * node);
+	void visit(constant_t * node);
+	void visit(variable_expression_t * node);
+	void visit(binary_expression_t * node);
+	void visit(short_circuit_expression_t * node);
+	void visit(invocation_expression_t * node);
+	void visit(array_declaration_t * node);
+	void visit(element_expression_t * node);
+	void visit(element_assignment_t * node);
+	void visit(reduction_expression_t * node);
+};
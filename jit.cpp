@@ -0,0 +1,928 @@
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include <sys/mman.h>
+
+#include "jit.h"
+
+// x86-64 registers and condition codes used by the generated code
+
+enum
+{
+	rEax = 0,
+	rEcx = 1,
+	rEdx = 2
+};
+
+enum
+{
+	ccAboveEquals = 0x3,
+	ccEquals = 0x4,
+	ccNotEquals = 0x5,
+	ccLesser = 0xC,
+	ccGreaterEquals = 0xD,
+	ccLesserEquals = 0xE,
+	ccGreater = 0xF
+};
+
+static int condition_code(operation type)
+{
+	switch (type)
+	{
+	case opEquals:
+		return ccEquals;
+	case opNotEquals:
+		return ccNotEquals;
+	case opLesser:
+		return ccLesser;
+	case opGreater:
+		return ccGreater;
+	case opLesserEquals:
+		return ccLesserEquals;
+	case opGreaterEquals:
+		return ccGreaterEquals;
+	default:
+		return -1;
+	}
+}
+
+// the lowest address native code may push to, checked on every entry. Each
+// thread has its own, DO CONCURRENT may enter native code from any of them.
+static thread_local const char * jit_stack_limit;
+
+// the generated code finds jit_stack_limit at this offset from the thread
+// pointer, it is the same in every thread as the variable is in static TLS
+static int jit_stack_limit_offset()
+{
+#if defined(__x86_64__)
+	const char * thread_pointer;
+	asm("mov %%fs:0, %0" : "=r"(thread_pointer));
+	return (int)((const char *)&jit_stack_limit - thread_pointer);
+#else
+	return 0;
+#endif
+}
+
+// arguments of a tail call of another method, which takes them from here
+// once the caller's frame is gone; at the same offset in every thread
+static thread_local int jit_tail_arguments[JIT_MAX_ARGUMENTS];
+
+static int jit_tail_arguments_offset()
+{
+#if defined(__x86_64__)
+	const char * thread_pointer;
+	asm("mov %%fs:0, %0" : "=r"(thread_pointer));
+	return (int)((const char *)jit_tail_arguments - thread_pointer);
+#else
+	return 0;
+#endif
+}
+
+// where the overflow check and a failed division leave native code for;
+// native frames have no unwind info, so a trapped error can't be thrown
+// through them
+static thread_local void * jit_error_target[5];
+
+// operands and line of the division that failed, the line is 0 for a stack
+// overflow
+static thread_local int jit_division[3];
+
+static void jit_stack_overflow()
+{
+	jit_division[2] = 0;
+	__builtin_longjmp(jit_error_target, 1);
+}
+
+static void jit_division_error(int left, int right, int line)
+{
+	jit_division[0] = left;
+	jit_division[1] = right;
+	jit_division[2] = line;
+	__builtin_longjmp(jit_error_target, 1);
+}
+
+int jit_call(native_function_t function, const int * args)
+{
+	// native code never calls back into the interpreter, so the limit and
+	// the target are only set here; a call made deep in the tree walker gets
+	// what is left of the thread's stack
+	char marker;
+	jit_stack_limit = std::max<const char *>(&marker - JIT_STACK_SIZE, get_native_stack_limit());
+	if (__builtin_setjmp(jit_error_target) != 0)
+	{
+		if (jit_division[2] != 0)
+		{
+			check_division(jit_division[0], jit_division[1], jit_division[2]);
+		}
+		raise_error("stack overflow");
+	}
+	return function(args);
+}
+
+// jit_t
+
+jit_t::jit_t()
+{
+	code = NULL;
+	code_size = 0;
+}
+
+jit_t::~jit_t()
+{
+	if (code != NULL)
+	{
+		munmap(code, code_size);
+	}
+}
+
+void jit_t::compile(program_t * program)
+{
+#if defined(__x86_64__)
+	std::vector<method_t *> methods;
+	std::map<method_t *, size_t> indices;
+	for(auto it = program->get_methods().begin(); it != program->get_methods().end(); ++it)
+	{
+		indices.insert(std::make_pair(it->second, methods.size()));
+		methods.push_back(it->second);
+	}
+	if (methods.empty())
+	{
+		return;
+	}
+	entries.assign(methods.size(), NULL);
+
+	std::vector<std::vector<unsigned char> > codes(methods.size());
+	std::vector<std::vector<size_t> > callees(methods.size());
+	std::vector<bool> compiled(methods.size());
+	for(size_t index = 0; index < methods.size(); ++index)
+	{
+		jit_compiler_t compiler(indices, &entries[0], codes[index]);
+		// native recursion would go around the cache of a memoized method
+		compiled[index] = methods[index]->get_memo_table() == NULL && compiler.compile(methods[index]);
+		callees[index] = compiler.get_callees();
+	}
+
+	// a method calling an interpreted one stays interpreted as well
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for(size_t index = 0; index < methods.size(); ++index)
+		{
+			for(size_t callee = 0; compiled[index] && callee < callees[index].size(); ++callee)
+			{
+				if (!compiled[callees[index][callee]])
+				{
+					compiled[index] = false;
+					changed = true;
+				}
+			}
+		}
+	}
+
+	std::vector<size_t> offsets(methods.size());
+	for(size_t index = 0; index < methods.size(); ++index)
+	{
+		offsets[index] = code_size;
+		if (compiled[index])
+		{
+			code_size += codes[index].size();
+		}
+	}
+	if (code_size == 0)
+	{
+		return;
+	}
+
+	void * memory = mmap(NULL, code_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED)
+	{
+		code_size = 0;
+		return;
+	}
+	code = (unsigned char *)memory;
+
+	for(size_t index = 0; index < methods.size(); ++index)
+	{
+		if (compiled[index])
+		{
+			memcpy(code + offsets[index], &codes[index][0], codes[index].size());
+			entries[index] = (native_function_t)(code + offsets[index]);
+		}
+	}
+
+	if (mprotect(code, code_size, PROT_READ | PROT_EXEC) != 0)
+	{
+		return;
+	}
+
+	for(size_t index = 0; index < methods.size(); ++index)
+	{
+		methods[index]->set_native_code(entries[index]);
+	}
+#endif
+}
+
+// jit_compiler_t
+
+jit_compiler_t::jit_compiler_t(const std::map<method_t *, size_t> & indices, native_function_t * entries, std::vector<unsigned char> & code)
+	: indices(indices), code(code)
+{
+	this->entries = entries;
+	method = NULL;
+	restart = 0;
+	supported = true;
+	next_temp = 0;
+	temps_count = 0;
+}
+
+void jit_compiler_t::emit(unsigned char byte)
+{
+	code.push_back(byte);
+}
+
+void jit_compiler_t::emit_int(int value)
+{
+	unsigned char bytes[sizeof(int)];
+	memcpy(bytes, &value, sizeof(int));
+	code.insert(code.end(), bytes, bytes + sizeof(int));
+}
+
+void jit_compiler_t::emit_pointer(const void * pointer)
+{
+	unsigned char bytes[sizeof(pointer)];
+	memcpy(bytes, &pointer, sizeof(pointer));
+	code.insert(code.end(), bytes, bytes + sizeof(pointer));
+}
+
+// opcode reg, [rbp - 4 * (slot + 1)]
+void jit_compiler_t::emit_slot(unsigned char opcode, unsigned char reg, size_t slot)
+{
+	emit(opcode);
+	emit(0x85 | (reg << 3));
+	emit_int(-4 * (int)(slot + 1));
+}
+
+// jmp, or jcc when condition is given; the target is patched later
+size_t jit_compiler_t::emit_jump(int condition)
+{
+	if (condition < 0)
+	{
+		emit(0xE9);
+	}
+	else
+	{
+		emit(0x0F);
+		emit(0x80 | condition);
+	}
+	size_t position = code.size();
+	emit_int(0);
+	return position;
+}
+
+void jit_compiler_t::patch(size_t jump, size_t target)
+{
+	int offset = (int)target - (int)(jump + sizeof(int));
+	memcpy(&code[jump], &offset, sizeof(int));
+}
+
+void jit_compiler_t::patch(const std::vector<size_t> & jumps, size_t target)
+{
+	for(size_t index = 0; index < jumps.size(); ++index)
+	{
+		patch(jumps[index], target);
+	}
+}
+
+size_t jit_compiler_t::alloc_temp()
+{
+	size_t temp = next_temp++;
+	if (next_temp > temps_count)
+	{
+		temps_count = next_temp;
+	}
+	return method->get_frame_size() + temp;
+}
+
+void jit_compiler_t::set_unreachable()
+{
+	assigned.assign(assigned.size(), true);
+}
+
+void jit_compiler_t::merge_state(const std::vector<bool> & other)
+{
+	for(size_t index = 0; index < assigned.size(); ++index)
+	{
+		assigned[index] = assigned[index] && other[index];
+	}
+}
+
+bool jit_compiler_t::compile(method_t * method)
+{
+	this->method = method;
+	size_t arguments_count = method->get_arguments_count();
+	if (arguments_count > JIT_MAX_ARGUMENTS)
+	{
+		return false;
+	}
+
+	assigned.assign(method->get_frame_size(), false);
+	for(size_t index = 0; index < arguments_count; ++index)
+	{
+		assigned[index] = true;
+	}
+	// an unassigned result is returned as is, the interpreter doesn't check it
+	assigned[method->get_result_index()] = true;
+
+	// push rbp; mov rbp, rsp; sub rsp, frame
+	emit(0x55);
+	emit(0x48); emit(0x89); emit(0xE5);
+	emit(0x48); emit(0x81); emit(0xEC);
+	size_t frame_bytes = code.size();
+	emit_int(0);
+
+	// the frame stays 16 byte aligned, so helpers may be called from here
+	// mov rax, fs:[offset]; cmp rsp, rax
+	emit(0x64); emit(0x48); emit(0x8B); emit(0x04); emit(0x25); emit_int(jit_stack_limit_offset());
+	emit(0x48); emit(0x3B); emit(0xE0);
+	size_t stack_ok = emit_jump(ccAboveEquals);
+	emit(0x48); emit(0xB8); emit_pointer((const void *)&jit_stack_overflow);
+	emit(0xFF); emit(0xD0);
+	patch(stack_ok, code.size());
+
+	// arguments come in [rdi]
+	for(size_t index = 0; index < arguments_count; ++index)
+	{
+		emit(0x8B); emit(0x87); emit_int(4 * (int)index);
+		emit_slot(0x89, rEax, index);
+	}
+	restart = code.size();
+	emit_slot(0xC7, rEax, method->get_result_index());
+	emit_int(0);
+
+	method->get_body()->accept(this);
+	if (!supported)
+	{
+		return false;
+	}
+
+	patch(returns, code.size());
+	if (method->get_return_type() == vtNoType)
+	{
+		emit(0x31); emit(0xC0);
+	}
+	else
+	{
+		emit_slot(0x8B, rEax, method->get_result_index());
+	}
+	emit(0xC9);
+	emit(0xC3);
+
+	int frame = (int)((method->get_frame_size() + temps_count) * 4 + 15) & ~15;
+	memcpy(&code[frame_bytes], &frame, sizeof(int));
+	return true;
+}
+
+// statements
+
+void jit_compiler_t::visit(statement_list_t * node)
+{
+	for(size_t index = 0; index < node->size() && supported; ++index)
+	{
+		node->get_at(index)->accept(this);
+	}
+}
+
+void jit_compiler_t::visit(code_block_statement_t * node)
+{
+	node->get_body()->accept(this);
+}
+
+void jit_compiler_t::visit(declaration_t * node)
+{
+	assigned[node->get_index()] = false;
+}
+
+void jit_compiler_t::visit(assignment_t * node)
+{
+	variable_slot_t slot = node->get_slot();
+	if (slot.depth != 0)
+	{
+		supported = false;
+		return;
+	}
+
+	invocation_expression_t * call = dynamic_cast<invocation_expression_t *>(node->get_value());
+	if (call != NULL && call->is_tail_call())
+	{
+		compile_tail_call(call);
+		return;
+	}
+
+	compile_expression(node->get_value());
+	emit_slot(0x89, rEax, slot.index);
+	assigned[slot.index] = true;
+}
+
+void jit_compiler_t::visit(read_statement_t * node)
+{
+	supported = false;
+}
+
+void jit_compiler_t::visit(write_statement_t * node)
+{
+	supported = false;
+}
+
+void jit_compiler_t::visit(return_statement_t * node)
+{
+	returns.push_back(emit_jump());
+	set_unreachable();
+}
+
+void jit_compiler_t::visit(conditional_statement_t * node)
+{
+	std::vector<size_t> skip_true;
+	compile_condition(node->get_condition(), false, skip_true);
+	std::vector<bool> state = assigned;
+
+	node->get_true_way()->accept(this);
+
+	if (node->get_false_way() != NULL)
+	{
+		size_t skip_false = emit_jump();
+		patch(skip_true, code.size());
+
+		std::vector<bool> true_state = assigned;
+		assigned = state;
+		node->get_false_way()->accept(this);
+		merge_state(true_state);
+		patch(skip_false, code.size());
+	}
+	else
+	{
+		patch(skip_true, code.size());
+		merge_state(state);
+	}
+}
+
+void jit_compiler_t::visit(while_statement_t * node)
+{
+	size_t start = code.size();
+
+	loops.push_back(loop_t());
+	node->get_body()->accept(this);
+
+	loop_t & loop = loops.back();
+	patch(loop.cycles, code.size());
+	for(size_t index = 0; index < loop.cycle_states.size(); ++index)
+	{
+		merge_state(loop.cycle_states[index]);
+	}
+
+	std::vector<size_t> repeat;
+	compile_condition(node->get_condition(), true, repeat);
+	patch(repeat, start);
+
+	patch(loop.breaks, code.size());
+	for(size_t index = 0; index < loop.break_states.size(); ++index)
+	{
+		merge_state(loop.break_states[index]);
+	}
+	loops.pop_back();
+}
+
+// the remaining iterations are counted down in a temporary, a variable step
+// stays interpreted since it has to be checked for zero
+void jit_compiler_t::visit(do_statement_t * node)
+{
+	variable_slot_t slot = node->get_slot();
+	constant_t * step_constant = dynamic_cast<constant_t *>(node->get_step());
+	int step = 1;
+	if (node->get_step() != NULL)
+	{
+		step = step_constant != NULL ? step_constant->get_value().int_value : 0;
+	}
+	if (slot.depth != 0 || step == 0)
+	{
+		supported = false;
+		return;
+	}
+
+	size_t mark = next_temp;
+	size_t first = alloc_temp();
+	size_t remaining = alloc_temp();
+
+	// the index of DO CONCURRENT is the loop's own, the variable is put back
+	// after it
+	bool concurrent = dynamic_cast<do_concurrent_statement_t *>(node) != NULL;
+	size_t saved = 0;
+	bool was_assigned = assigned[slot.index];
+	if (concurrent)
+	{
+		saved = alloc_temp();
+		emit_slot(0x8B, rEax, slot.index);
+		emit_slot(0x89, rEax, saved);
+	}
+
+	compile_expression(node->get_first());
+	emit_slot(0x89, rEax, first);
+	compile_expression(node->get_last());
+	emit_slot(0x8B, rEcx, first);
+	emit_slot(0x89, rEcx, slot.index);
+	assigned[slot.index] = true;
+
+	// cmp ecx, eax; the distance to cover goes to eax
+	emit(0x39); emit(0xC1);
+	size_t skip = emit_jump(step > 0 ? ccGreater : ccLesser);
+	if (step > 0)
+	{
+		// sub eax, ecx
+		emit(0x29); emit(0xC8);
+	}
+	else
+	{
+		// sub ecx, eax; mov eax, ecx
+		emit(0x29); emit(0xC1);
+		emit(0x89); emit(0xC8);
+	}
+	unsigned int distance = step > 0 ? (unsigned int)step : 0u - (unsigned int)step;
+	if (distance != 1)
+	{
+		// xor edx, edx; mov ecx, |step|; div ecx
+		emit(0x31); emit(0xD2);
+		emit(0xB9); emit_int((int)distance);
+		emit(0xF7); emit(0xF1);
+	}
+	emit_slot(0x89, rEax, remaining);
+
+	std::vector<bool> state = assigned;
+	size_t start = code.size();
+	loops.push_back(loop_t());
+	node->get_body()->accept(this);
+
+	loop_t & loop = loops.back();
+	patch(loop.cycles, code.size());
+	for(size_t index = 0; index < loop.cycle_states.size(); ++index)
+	{
+		merge_state(loop.cycle_states[index]);
+	}
+
+	// the variable is set from the counter in first, like the tree walker
+	// does, so assigning it in the body changes neither
+	// add dword [first], step; mov eax, [first]; mov [variable], eax
+	emit_slot(0x81, 0, first);
+	emit_int(step);
+	emit_slot(0x8B, rEax, first);
+	emit_slot(0x89, rEax, slot.index);
+	// sub dword [remaining], 1; jae start
+	emit_slot(0x81, 5, remaining);
+	emit_int(1);
+	patch(emit_jump(ccAboveEquals), start);
+
+	patch(skip, code.size());
+	patch(loop.breaks, code.size());
+	merge_state(state);
+	for(size_t index = 0; index < loop.break_states.size(); ++index)
+	{
+		merge_state(loop.break_states[index]);
+	}
+	loops.pop_back();
+
+	if (concurrent)
+	{
+		emit_slot(0x8B, rEax, saved);
+		emit_slot(0x89, rEax, slot.index);
+		assigned[slot.index] = was_assigned;
+	}
+	next_temp = mark;
+}
+
+void jit_compiler_t::visit(break_statement_t * node)
+{
+	if (loops.empty())
+	{
+		// a break outside of a loop leaves the method, like the tree walker does
+		returns.push_back(emit_jump());
+	}
+	else
+	{
+		loops.back().breaks.push_back(emit_jump());
+		loops.back().break_states.push_back(assigned);
+	}
+	set_unreachable();
+}
+
+void jit_compiler_t::visit(cycle_statement_t * node)
+{
+	if (loops.empty())
+	{
+		returns.push_back(emit_jump());
+	}
+	else
+	{
+		loops.back().cycles.push_back(emit_jump());
+		loops.back().cycle_states.push_back(assigned);
+	}
+	set_unreachable();
+}
+
+void jit_compiler_t::visit(invoke_statement_t * node)
+{
+	compile_expression(node->get_invokee());
+}
+
+// expressions, the value is left in eax
+
+void jit_compiler_t::compile_expression(expression_t * expr)
+{
+	size_t mark = next_temp;
+	expr->accept(this);
+	next_temp = mark;
+}
+
+bool jit_compiler_t::is_leaf(expression_t * expr)
+{
+	return dynamic_cast<constant_t *>(expr) != NULL || dynamic_cast<variable_expression_t *>(expr) != NULL;
+}
+
+void jit_compiler_t::load_leaf(expression_t * expr, unsigned char reg)
+{
+	constant_t * constant = dynamic_cast<constant_t *>(expr);
+	if (constant != NULL)
+	{
+		variant_t value = constant->get_value();
+		emit(0xB8 + reg);
+		emit_int(value.type == vtBool ? (value.bool_value ? 1 : 0) : value.int_value);
+		return;
+	}
+
+	variable_expression_t * variable = (variable_expression_t *)expr;
+	variable_slot_t slot = variable->get_slot();
+	if (slot.depth != 0 || !assigned[slot.index])
+	{
+		supported = false;
+		return;
+	}
+	emit_slot(0x8B, reg, slot.index);
+}
+
+// left operand in eax, right one in ecx
+void jit_compiler_t::compile_operands(binary_expression_t * expr)
+{
+	if (is_leaf(expr->get_right()))
+	{
+		compile_expression(expr->get_left());
+		load_leaf(expr->get_right(), rEcx);
+		return;
+	}
+
+	compile_expression(expr->get_left());
+	size_t temp = alloc_temp();
+	emit_slot(0x89, rEax, temp);
+	compile_expression(expr->get_right());
+	// mov ecx, eax
+	emit(0x89); emit(0xC1);
+	emit_slot(0x8B, rEax, temp);
+}
+
+void jit_compiler_t::compile_condition(expression_t * expr, bool jump_if, std::vector<size_t> & jumps)
+{
+	short_circuit_expression_t * logical = dynamic_cast<short_circuit_expression_t *>(expr);
+	if (logical != NULL)
+	{
+		// the second operand may be skipped, so its assignments do not count
+		bool is_and = logical->get_operation() == opAnd;
+		if (jump_if != is_and)
+		{
+			compile_condition(logical->get_left(), jump_if, jumps);
+			std::vector<bool> state = assigned;
+			compile_condition(logical->get_right(), jump_if, jumps);
+			assigned = state;
+		}
+		else
+		{
+			std::vector<size_t> skip;
+			compile_condition(logical->get_left(), !jump_if, skip);
+			std::vector<bool> state = assigned;
+			compile_condition(logical->get_right(), jump_if, jumps);
+			assigned = state;
+			patch(skip, code.size());
+		}
+		return;
+	}
+
+	binary_expression_t * comparison = dynamic_cast<binary_expression_t *>(expr);
+	if (comparison != NULL && condition_code(comparison->get_operation()) >= 0)
+	{
+		size_t mark = next_temp;
+		compile_operands(comparison);
+		next_temp = mark;
+		// cmp eax, ecx
+		emit(0x39); emit(0xC8);
+		int condition = condition_code(comparison->get_operation());
+		jumps.push_back(emit_jump(jump_if ? condition : condition ^ 1));
+		return;
+	}
+
+	compile_expression(expr);
+	// test eax, eax
+	emit(0x85); emit(0xC0);
+	jumps.push_back(emit_jump(jump_if ? ccNotEquals : ccEquals));
+}
+
+void jit_compiler_t::visit(constant_t * node)
+{
+	load_leaf(node, rEax);
+}
+
+void jit_compiler_t::visit(variable_expression_t * node)
+{
+	load_leaf(node, rEax);
+}
+
+void jit_compiler_t::visit(binary_expression_t * node)
+{
+	compile_operands(node);
+
+	operation type = node->get_operation();
+	switch (type)
+	{
+	case opAdd:
+		emit(0x01); emit(0xC8);
+		break;
+	case opSub:
+		emit(0x29); emit(0xC8);
+		break;
+	case opMul:
+		emit(0x0F); emit(0xAF); emit(0xC1);
+		break;
+	case opDiv:
+	case opMod:
+	{
+		// x / 0 and INT_MIN / -1 call the error stub instead of trapping
+		// test ecx, ecx; je error; cmp ecx, -1; jne divide
+		// cmp eax, INT_MIN; jne divide
+		emit(0x85); emit(0xC9);
+		size_t by_zero = emit_jump(ccEquals);
+		emit(0x83); emit(0xF9); emit(0xFF);
+		size_t divide = emit_jump(ccNotEquals);
+		emit(0x3D); emit_int(INT_MIN);
+		size_t no_overflow = emit_jump(ccNotEquals);
+		// error: mov edi, eax; mov esi, ecx; mov edx, line; mov rax, stub; call rax
+		patch(by_zero, code.size());
+		emit(0x89); emit(0xC7);
+		emit(0x89); emit(0xCE);
+		emit(0xBA); emit_int(node->get_line());
+		emit(0x48); emit(0xB8); emit_pointer((const void *)&jit_division_error);
+		emit(0xFF); emit(0xD0);
+		patch(divide, code.size());
+		patch(no_overflow, code.size());
+		// cdq; idiv ecx
+		emit(0x99);
+		emit(0xF7); emit(0xF9);
+		if (type == opMod)
+		{
+			emit(0x89); emit(0xD0);
+		}
+		break;
+	}
+	case opAnd:
+		emit(0x21); emit(0xC8);
+		break;
+	case opOr:
+		emit(0x09); emit(0xC8);
+		break;
+	default:
+		// cmp eax, ecx; setcc al; movzx eax, al
+		emit(0x39); emit(0xC8);
+		emit(0x0F); emit(0x90 | condition_code(type)); emit(0xC0);
+		emit(0x0F); emit(0xB6); emit(0xC0);
+		break;
+	}
+}
+
+void jit_compiler_t::visit(short_circuit_expression_t * node)
+{
+	compile_expression(node->get_left());
+	// test eax, eax
+	emit(0x85); emit(0xC0);
+	size_t skip = emit_jump(node->get_operation() == opAnd ? ccEquals : ccNotEquals);
+
+	std::vector<bool> state = assigned;
+	compile_expression(node->get_right());
+	assigned = state;
+	patch(skip, code.size());
+}
+
+void jit_compiler_t::visit(invocation_expression_t * node)
+{
+	method_t * callee = node->get_method();
+	parameter_list_t * params = node->get_params();
+	auto it = indices.find(callee);
+	if (it == indices.end())
+	{
+		supported = false;
+		return;
+	}
+
+	// arguments are stored from the highest slot down, so they end up in
+	// order in memory
+	size_t count = params->size();
+	size_t base = method->get_frame_size() + next_temp;
+	for(size_t index = 0; index < count; ++index)
+	{
+		alloc_temp();
+	}
+	for(size_t index = 0; index < count; ++index)
+	{
+		compile_expression(params->get_at(index));
+		emit_slot(0x89, rEax, base + count - 1 - index);
+	}
+
+	// lea rdi, [first argument]; mov rax, entry; call [rax]
+	emit(0x48); emit(0x8D); emit(0xBD); emit_int(-4 * (int)(base + count));
+	emit(0x48); emit(0xB8); emit_pointer(&entries[it->second]);
+	emit(0xFF); emit(0x10);
+	callees.push_back(it->second);
+}
+
+// the arguments are evaluated into temporaries first, they may read the
+// slots being replaced. The method itself is run again in its frame,
+// another one gets the frame's place on the stack and returns to the caller.
+void jit_compiler_t::compile_tail_call(invocation_expression_t * expr)
+{
+	method_t * callee = expr->get_method();
+	auto it = indices.find(callee);
+	if (it == indices.end())
+	{
+		supported = false;
+		return;
+	}
+
+	parameter_list_t * params = expr->get_params();
+	size_t count = params->size();
+	size_t mark = next_temp;
+	size_t base = method->get_frame_size() + next_temp;
+	for(size_t index = 0; index < count; ++index)
+	{
+		alloc_temp();
+	}
+	for(size_t index = 0; index < count; ++index)
+	{
+		compile_expression(params->get_at(index));
+		emit_slot(0x89, rEax, base + index);
+	}
+	next_temp = mark;
+
+	if (callee == method)
+	{
+		for(size_t index = 0; index < count; ++index)
+		{
+			emit_slot(0x8B, rEax, base + index);
+			emit_slot(0x89, rEax, index);
+		}
+		patch(emit_jump(), restart);
+		set_unreachable();
+		return;
+	}
+
+	// mov fs:[argument], eax
+	int offset = jit_tail_arguments_offset();
+	for(size_t index = 0; index < count; ++index)
+	{
+		emit_slot(0x8B, rEax, base + index);
+		emit(0x64); emit(0x89); emit(0x04); emit(0x25); emit_int(offset + 4 * (int)index);
+	}
+
+	// leave; mov rdi, fs:0; lea rdi, [rdi + offset]; mov rax, entry; jmp [rax]
+	emit(0xC9);
+	emit(0x64); emit(0x48); emit(0x8B); emit(0x3C); emit(0x25); emit_int(0);
+	emit(0x48); emit(0x8D); emit(0xBF); emit_int(offset);
+	emit(0x48); emit(0xB8); emit_pointer(&entries[it->second]);
+	emit(0xFF); emit(0x20);
+	callees.push_back(it->second);
+	set_unreachable();
+}
+
+// arrays stay interpreted
+
+void jit_compiler_t::visit(array_declaration_t * node)
+{
+	supported = false;
+}
+
+void jit_compiler_t::visit(element_expression_t * node)
+{
+	supported = false;
+}
+
+void jit_compiler_t::visit(element_assignment_t * node)
+{
+	supported = false;
+}
+
+void jit_compiler_t::visit(reduction_expression_t * node)
+{
+	supported = false;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "syntax_engine.h"
+
+// Native tier of the tree walker (x86-64 only). Methods built from integer
+// arithmetic, comparisons, assignments, IF, DO...WHILE, counted DO with a
+// constant step and calls of other such methods are translated to machine code; the rest keep being
+// interpreted. A method is only taken when every read of a local is
+// definitely assigned, so the native code needs no checks for it. A tail
+// call becomes a jump.
+
+// Native calls take the arguments from an array of this size at most
+const size_t JIT_MAX_ARGUMENTS = 16;
+
+// Native stack a call from the interpreter may use before "stack overflow"
+const size_t JIT_STACK_SIZE = 4 << 20;
+
+class jit_t
+{
+private:
+	unsigned char * code;
+	size_t code_size;
+	// entry points of the compiled methods, native calls go through it
+	std::vector<native_function_t> entries;
+
+public:
+	jit_t();
+	~jit_t();
+
+	// sets the native code of every method that can be compiled
+	void compile(program_t * program);
+};
+
+// Enters native code from the interpreter
+int jit_call(native_function_t function, const int * args);
+
+// Assembles the code of one method, calls are made through
+// entries[callee index]
+class jit_compiler_t : public ast_visitor_t
+{
+private:
+	struct loop_t
+	{
+		std::vector<size_t> breaks;
+		std::vector<std::vector<bool> > break_states;
+		std::vector<size_t> cycles;
+		std::vector<std::vector<bool> > cycle_states;
+	};
+
+	const std::map<method_t *, size_t> & indices;
+	native_function_t * entries;
+	method_t * method;
+	std::vector<unsigned char> & code;
+	std::vector<size_t> returns;
+	std::vector<loop_t> loops;
+	std::vector<size_t> callees;
+	// where a tail call of the method itself jumps back to, past the
+	// arguments
+	size_t restart;
+	bool supported;
+
+	size_t next_temp;
+	size_t temps_count;
+	std::vector<bool> assigned;
+
+	void emit(unsigned char byte);
+	void emit_int(int value);
+	void emit_pointer(const void * pointer);
+	void emit_slot(unsigned char opcode, unsigned char reg, size_t slot);
+	size_t emit_jump(int condition = -1);
+	void patch(size_t jump, size_t target);
+	void patch(const std::vector<size_t> & jumps, size_t target);
+
+	size_t alloc_temp();
+	void set_unreachable();
+	void merge_state(const std::vector<bool> & other);
+
+	bool is_leaf(expression_t * expr);
+	void load_leaf(expression_t * expr, unsigned char reg);
+	void compile_expression(expression_t * expr);
+	void compile_operands(binary_expression_t * expr);
+	void compile_condition(expression_t * expr, bool jump_if, std::vector<size_t> & jumps);
+	void compile_tail_call(invocation_expression_t * expr);
+
+public:
+	jit_compiler_t(const std::map<method_t *, size_t> & indices, native_function_t * entries, std::vector<unsigned char> & code);
+
+	// false when the method has to stay interpreted
+	bool compile(method_t * method);
+
+	const std::vector<size_t> & get_callees()
+	{
+		return callees;
+	}
+
+	void visit(statement_list_t * node);
+	void visit(code_block_statement_t * node);
+	void visit(declaration_t * node);
+	void visit(assignment_t * node);
+	void visit(read_statement_t * node);
+	void visit(write_statement_t * node);
+	void visit(return_statement_t * node);
+	void visit(conditional_statement_t * node);
+	void visit(while_statement_t * node);
+	void visit(do_statement_t * node);
+	void visit(break_statement_t * node);
+	void visit(cycle_statement_t * node);
+	void visit(invoke_statement_t * node);
+	void visit(constant_t * node);
+	void visit(variable_expression_t * node);
+	void visit(binary_expression_t * node);
+	void visit(short_circuit_expression_t * node);
+	void visit(invocation_expression_t * node);
+	void visit(array_declaration_t * node);
+	void visit(element_expression_t * node);
+	void visit(element_assignment_t * node);
+	void visit(reduction_expression_t * node);
+};
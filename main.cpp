@@ -0,0 +1,356 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+
+#include "parser.h"
+#include "image.h"
+#include "vm.h"
+#include "closure.h"
+#include "output.h"
+#include "cpp_emitter.h"
+#include "jit.h"
+#include "profiler.h"
+#include "memoizer.h"
+#include "inliner.h"
+#include "ir.h"
+#include "concurrency.h"
+#include "runtime.h"
+#include "batch.h"
+
+static bool read_file(const char * file_name, std::string & text)
+{
+	FILE * file = fopen(file_name, "rb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	char buffer[4096];
+	size_t count;
+	while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		text.append(buffer, count);
+	}
+	fclose(file);
+	return true;
+}
+
+int main(int argc, const char* argv[]) 
+{
+	const char * file_name = NULL;
+	bool use_vm = false;
+	bool use_closures = false;
+	bool optimize = true;
+	bool emit_cpp = false;
+	bool use_jit = true;
+	bool profile = false;
+	size_t memo_limit = 0;
+	bool memo_stats = false;
+	size_t inline_limit = 0;
+	bool inline_report = false;
+	bool dump_ir = false;
+	size_t threads = std::thread::hardware_concurrency();
+	bool has_output_mode = false;
+	output_mode mode = omBlock;
+	std::vector<std::string> batch_inputs;
+	bool batch = false;
+	size_t jobs = std::thread::hardware_concurrency();
+	const char * cache_directory = NULL;
+
+	for(int index = 1; index < argc; ++index)
+	{
+		if (!strcmp(argv[index], "--engine=tree"))
+		{
+			use_vm = false;
+			use_closures = false;
+		}
+		else if (!strcmp(argv[index], "--engine=vm"))
+		{
+			use_vm = true;
+			use_closures = false;
+		}
+		else if (!strcmp(argv[index], "--engine=closure"))
+		{
+			use_vm = false;
+			use_closures = true;
+		}
+		else if (!strcmp(argv[index], "--no-optimize"))
+		{
+			optimize = false;
+		}
+		else if (!strcmp(argv[index], "--no-jit"))
+		{
+			use_jit = false;
+		}
+		else if (!strcmp(argv[index], "--emit-cpp"))
+		{
+			emit_cpp = true;
+		}
+		else if (!strcmp(argv[index], "--profile"))
+		{
+			profile = true;
+		}
+		else if (!strcmp(argv[index], "--memoize"))
+		{
+			memo_limit = MEMO_DEFAULT_LIMIT;
+		}
+		else if (!strncmp(argv[index], "--memoize=", 10))
+		{
+			int limit = atoi(argv[index] + 10);
+			if (limit <= 0)
+			{
+				raise_error("memoization limit must be positive: %s", argv[index] + 10);
+			}
+			memo_limit = limit;
+		}
+		else if (!strcmp(argv[index], "--inline"))
+		{
+			inline_limit = INLINE_DEFAULT_LIMIT;
+		}
+		else if (!strncmp(argv[index], "--inline=", 9))
+		{
+			int limit = atoi(argv[index] + 9);
+			if (limit <= 0)
+			{
+				raise_error("inlining limit must be positive: %s", argv[index] + 9);
+			}
+			inline_limit = limit;
+		}
+		else if (!strcmp(argv[index], "--inline-report"))
+		{
+			inline_report = true;
+		}
+		else if (!strcmp(argv[index], "--dump-ir"))
+		{
+			dump_ir = true;
+		}
+		else if (!strncmp(argv[index], "--threads=", 10))
+		{
+			int count = atoi(argv[index] + 10);
+			if (count <= 0)
+			{
+				raise_error("thread count must be positive: %s", argv[index] + 10);
+			}
+			threads = count;
+		}
+		else if (!strcmp(argv[index], "--memo-stats"))
+		{
+			memo_stats = true;
+		}
+		else if (!strncmp(argv[index], "--output=", 9))
+		{
+			if (!parse_output_mode(argv[index] + 9, mode))
+			{
+				raise_error("unknown output mode: %s", argv[index] + 9);
+			}
+			has_output_mode = true;
+		}
+		else if (!strcmp(argv[index], "--batch"))
+		{
+			// the inputs go on up to the next option
+			batch = true;
+			while (index + 1 < argc && argv[index + 1][0] != '-')
+			{
+				batch_inputs.push_back(argv[++index]);
+			}
+		}
+		else if (!strncmp(argv[index], "--jobs", 6) && (argv[index][6] == '=' || argv[index][6] == '\0'))
+		{
+			const char * count_text = argv[index][6] == '=' ? argv[index] + 7 : (index + 1 < argc ? argv[++index] : "");
+			int count = atoi(count_text);
+			if (count <= 0)
+			{
+				raise_error("job count must be positive: %s", count_text);
+			}
+			jobs = count;
+		}
+		else if (!strncmp(argv[index], "--cache=", 8))
+		{
+			cache_directory = argv[index] + 8;
+		}
+		else if (argv[index][0] == '-')
+		{
+			raise_error("unknown option: %s", argv[index]);
+		}
+		else
+		{
+			file_name = argv[index];
+		}
+	}
+
+	if (file_name == NULL) 
+	{
+		printf("Usage: %s [--engine=tree|vm|closure] [--no-optimize] [--no-jit] [--emit-cpp] [--profile] [--memoize[=N]] [--memo-stats] [--inline[=N]] [--inline-report] [--dump-ir] [--threads=N] [--output=line|block|unbuffered] [--cache=DIR] <input_file> [--batch <data_files> [--jobs N]]\n", argv[0]);
+		exit(0);
+	}
+
+	std::string source;
+	if (!read_file(file_name, source))
+	{
+		raise_error("can't open %s", file_name);
+	}
+
+	program_t * program;
+	if (cache_directory != NULL)
+	{
+		program_cache_t cache(cache_directory);
+		program = cache.get(source);
+	}
+	else
+	{
+		program = parse_program(source);
+	}
+	program->resolve();
+	program->typecheck();
+
+	// the copies are optimized with the methods they are put in
+	inliner_t inliner(inline_limit);
+	if (inline_limit != 0)
+	{
+		inliner.install(program);
+		if (inline_report)
+		{
+			inliner.report(stderr);
+		}
+	}
+	// the passes on the IR only run when optimizing, the dump shows the IR
+	// as built otherwise
+	if (optimize || dump_ir)
+	{
+		ir_optimizer_t ir(optimize, dump_ir ? stdout : NULL);
+		ir.install(program);
+	}
+	if (dump_ir)
+	{
+		return 0;
+	}
+	if (optimize)
+	{
+		program->optimize();
+	}
+
+	if (profile && (emit_cpp || use_vm || use_closures))
+	{
+		raise_error("--profile works with the tree engine only");
+	}
+	if (memo_limit != 0 && (emit_cpp || use_vm || use_closures))
+	{
+		raise_error("--memoize works with the tree engine only");
+	}
+	if (inline_limit != 0 && (emit_cpp || use_vm))
+	{
+		raise_error("--inline works with the tree and closure engines only");
+	}
+	if (inline_limit != 0 && profile)
+	{
+		raise_error("--profile can't be combined with --inline");
+	}
+	if (inline_report && inline_limit == 0)
+	{
+		raise_error("--inline-report needs --inline");
+	}
+	if (memo_stats && memo_limit == 0)
+	{
+		raise_error("--memo-stats needs --memoize");
+	}
+	if (batch && (emit_cpp || profile || memo_limit != 0))
+	{
+		raise_error("--batch can't be combined with --emit-cpp, --profile or --memoize");
+	}
+	if (batch && batch_inputs.empty())
+	{
+		raise_error("--batch needs input files");
+	}
+
+	// only the tree walker runs DO CONCURRENT in parallel, the profile
+	// counters are not shared safely and the runs of a batch are parallel
+	// already
+	thread_pool_t thread_pool(emit_cpp || use_vm || profile || batch ? 1 : threads);
+	program->set_thread_pool(&thread_pool);
+
+	// cached functions have to be known before the JIT picks its methods
+	memoizer_t memoizer(memo_limit);
+	if (memo_limit != 0)
+	{
+		memoizer.install(program);
+	}
+
+	if (batch)
+	{
+		vm_t vm;
+		closure_engine_t closures;
+		jit_t jit;
+		if (use_vm)
+		{
+			vm.load(program);
+		}
+		else if (use_closures)
+		{
+			closures.load(program);
+		}
+		else if (use_jit)
+		{
+			jit.compile(program);
+		}
+
+		batch_t runner(program, use_vm ? &vm : NULL, use_closures ? &closures : NULL);
+		if (has_output_mode)
+		{
+			runner.set_output_mode(mode);
+		}
+		return runner.run(batch_inputs, jobs) == 0 ? 0 : -1;
+	}
+
+	runtime_t runtime(STDIN_FILENO, stdout);
+	if (has_output_mode)
+	{
+		runtime.output.set_mode(mode);
+	}
+
+	if (emit_cpp)
+	{
+		cpp_emitter_t emitter;
+		fputs(emitter.emit(program).c_str(), stdout);
+	}
+	else if (use_vm)
+	{
+		vm_t vm;
+		vm.load(program);
+		vm.run(&runtime);
+	}
+	else if (use_closures)
+	{
+		// the closures call the methods themselves, native code would be
+		// reached only through the nodes they leave to the tree walker
+		closure_engine_t closures;
+		closures.load(program);
+		closures.run(&runtime);
+	}
+	else if (profile)
+	{
+		// native code would bypass the counters, so the JIT stays off
+		profiler_t profiler;
+		profiler.instrument(program);
+		program->run(&runtime);
+		runtime.output.flush();
+		profiler.report(file_name, stderr);
+	}
+	else
+	{
+		jit_t jit;
+		if (use_jit)
+		{
+			jit.compile(program);
+		}
+		program->run(&runtime);
+	}
+	runtime.output.flush();
+	if (memo_stats)
+	{
+		memoizer.report(stderr);
+	}
+	return 0;
+}
+
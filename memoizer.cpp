@@ -0,0 +1,290 @@
+#include <algorithm>
+
+#include "memoizer.h"
+
+// memo_table_t
+
+memo_table_t::memo_table_t(size_t arguments_count, size_t limit)
+{
+	this->arguments_count = arguments_count;
+	size_t capacity = 1;
+	while (capacity * 2 <= limit)
+	{
+		capacity *= 2;
+	}
+	mask = capacity - 1;
+	keys.resize(capacity * arguments_count);
+	results.resize(capacity);
+	used.resize(capacity);
+	hits = 0;
+	misses = 0;
+}
+
+// FNV-1a over whole ints keeps consecutive arguments in distinct buckets
+size_t memo_table_t::get_bucket(const int * args)
+{
+	unsigned int hash = 2166136261u;
+	for(size_t index = 0; index < arguments_count; ++index)
+	{
+		hash = (hash ^ (unsigned int)args[index]) * 16777619u;
+	}
+	return hash & mask;
+}
+
+bool memo_table_t::find(const int * args, int & result)
+{
+	size_t bucket = get_bucket(args);
+	if (used[bucket] && std::equal(args, args + arguments_count, keys.begin() + bucket * arguments_count))
+	{
+		result = results[bucket];
+		++hits;
+		return true;
+	}
+	++misses;
+	return false;
+}
+
+void memo_table_t::store(const int * args, int result)
+{
+	size_t bucket = get_bucket(args);
+	std::copy(args, args + arguments_count, keys.begin() + bucket * arguments_count);
+	results[bucket] = result;
+	used[bucket] = true;
+}
+
+// memoizer_t
+
+memoizer_t::memoizer_t(size_t limit)
+{
+	this->limit = limit;
+}
+
+memoizer_t::~memoizer_t()
+{
+	for(auto it = tables.begin(); it != tables.end(); ++it)
+	{
+		delete it->second;
+	}
+}
+
+void memoizer_t::install(program_t * program)
+{
+	std::set<method_t *> pure;
+	std::map<method_t *, std::set<method_t *> > callees;
+	for(auto it = program->get_methods().begin(); it != program->get_methods().end(); ++it)
+	{
+		purity_checker_t checker;
+		if (checker.check(it->second))
+		{
+			pure.insert(it->second);
+			callees[it->second] = checker.get_callees();
+		}
+	}
+
+	// a method calling an impure one is impure as well
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for(auto it = callees.begin(); it != callees.end(); ++it)
+		{
+			if (pure.count(it->first) == 0)
+			{
+				continue;
+			}
+			for(auto callee = it->second.begin(); callee != it->second.end(); ++callee)
+			{
+				if (pure.count(*callee) == 0)
+				{
+					pure.erase(it->first);
+					changed = true;
+					break;
+				}
+			}
+		}
+	}
+
+	// pure subroutines may be called, but only functions have a result
+	for(auto it = pure.begin(); it != pure.end(); ++it)
+	{
+		method_t * method = *it;
+		if (method->get_return_type() == vtNoType || method->get_arguments_count() > MEMO_MAX_ARGUMENTS)
+		{
+			continue;
+		}
+		memo_table_t * table = new memo_table_t(method->get_arguments_count(), limit);
+		tables.insert(std::make_pair(method->ID, table));
+		method->set_memo_table(table);
+	}
+}
+
+void memoizer_t::report(FILE * stream)
+{
+	fprintf(stream, "\nmemoized functions\n\n");
+	fprintf(stream, "%-24s %10s %12s %12s %7s\n", "function", "capacity", "hits", "misses", "hits %");
+	for(auto it = tables.begin(); it != tables.end(); ++it)
+	{
+		memo_table_t * table = it->second;
+		unsigned long long calls = table->hits + table->misses;
+		double share = calls != 0 ? 100.0 * table->hits / calls : 0.0;
+		fprintf(stream, "%-24s %10u %12llu %12llu %6.1f%%\n", it->first.c_str(), (unsigned int)table->get_capacity(), table->hits, table->misses, share);
+	}
+}
+
+// purity_checker_t
+
+purity_checker_t::purity_checker_t()
+{
+	pure = true;
+}
+
+bool purity_checker_t::check(method_t * method)
+{
+	pure = true;
+	callees.clear();
+	method->get_body()->accept(this);
+	return pure;
+}
+
+// fields are shared by every call
+void purity_checker_t::check_slot(variable_slot_t slot)
+{
+	if (slot.depth != 0)
+	{
+		pure = false;
+	}
+}
+
+void purity_checker_t::visit(statement_list_t * node)
+{
+	for(size_t index = 0; index < node->size(); ++index)
+	{
+		node->get_at(index)->accept(this);
+	}
+}
+
+void purity_checker_t::visit(code_block_statement_t * node)
+{
+	node->get_body()->accept(this);
+}
+
+void purity_checker_t::visit(declaration_t * node)
+{
+}
+
+void purity_checker_t::visit(assignment_t * node)
+{
+	check_slot(node->get_slot());
+	node->get_value()->accept(this);
+}
+
+void purity_checker_t::visit(read_statement_t * node)
+{
+	pure = false;
+}
+
+void purity_checker_t::visit(write_statement_t * node)
+{
+	pure = false;
+}
+
+void purity_checker_t::visit(return_statement_t * node)
+{
+}
+
+void purity_checker_t::visit(conditional_statement_t * node)
+{
+	node->get_condition()->accept(this);
+	node->get_true_way()->accept(this);
+	if (node->get_false_way() != NULL)
+	{
+		node->get_false_way()->accept(this);
+	}
+}
+
+void purity_checker_t::visit(while_statement_t * node)
+{
+	node->get_condition()->accept(this);
+	node->get_body()->accept(this);
+}
+
+void purity_checker_t::visit(do_statement_t * node)
+{
+	check_slot(node->get_slot());
+	node->get_first()->accept(this);
+	node->get_last()->accept(this);
+	if (node->get_step() != NULL)
+	{
+		node->get_step()->accept(this);
+	}
+	node->get_body()->accept(this);
+}
+
+void purity_checker_t::visit(break_statement_t * node)
+{
+}
+
+void purity_checker_t::visit(cycle_statement_t * node)
+{
+}
+
+void purity_checker_t::visit(invoke_statement_t * node)
+{
+	node->get_invokee()->accept(this);
+}
+
+void purity_checker_t::visit(constant_t * node)
+{
+}
+
+void purity_checker_t::visit(variable_expression_t * node)
+{
+	check_slot(node->get_slot());
+}
+
+void purity_checker_t::visit(binary_expression_t * node)
+{
+	node->get_left()->accept(this);
+	if (node->get_right() != NULL)
+	{
+		node->get_right()->accept(this);
+	}
+}
+
+void purity_checker_t::visit(short_circuit_expression_t * node)
+{
+	node->get_left()->accept(this);
+	node->get_right()->accept(this);
+}
+
+void purity_checker_t::visit(invocation_expression_t * node)
+{
+	parameter_list_t * params = node->get_params();
+	callees.insert(node->get_method());
+	for(size_t index = 0; index < params->size(); ++index)
+	{
+		params->get_at(index)->accept(this);
+	}
+}
+
+void purity_checker_t::visit(array_declaration_t * node)
+{
+}
+
+void purity_checker_t::visit(element_expression_t * node)
+{
+	check_slot(node->get_slot());
+	node->get_index()->accept(this);
+}
+
+void purity_checker_t::visit(element_assignment_t * node)
+{
+	check_slot(node->get_slot());
+	node->get_index()->accept(this);
+	node->get_value()->accept(this);
+}
+
+void purity_checker_t::visit(reduction_expression_t * node)
+{
+	node->get_arg()->accept(this);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdio>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "syntax_engine.h"
+
+// Caching of FUNCTION results by argument tuple (--memoize). A function is
+// pure when it does no READ or WRITE, neither reads nor writes a field and
+// only calls pure functions, so a second call with the same arguments can
+// take the result of the first one.
+
+// Functions with more arguments are not cached
+const size_t MEMO_MAX_ARGUMENTS = 8;
+
+// Results kept per function unless --memoize=N says otherwise
+const size_t MEMO_DEFAULT_LIMIT = 4096;
+
+// Direct-mapped table: a new result replaces the one in its bucket, so it
+// never holds more than the limit and a lookup is one probe
+class memo_table_t
+{
+private:
+	size_t arguments_count;
+	size_t mask;
+	std::vector<int> keys;
+	std::vector<int> results;
+	std::vector<bool> used;
+
+	size_t get_bucket(const int * args);
+
+public:
+	unsigned long long hits;
+	unsigned long long misses;
+
+	memo_table_t(size_t arguments_count, size_t limit);
+
+	bool find(const int * args, int & result);
+	void store(const int * args, int result);
+
+	size_t get_capacity()
+	{
+		return used.size();
+	}
+};
+
+class memoizer_t
+{
+private:
+	size_t limit;
+	std::map<std::string, memo_table_t *> tables;
+
+public:
+	memoizer_t(size_t limit);
+	~memoizer_t();
+
+	// attaches a table to every pure function, must run before the JIT so
+	// the cached functions stay interpreted
+	void install(program_t * program);
+
+	// hits and misses of every cached function
+	void report(FILE * stream);
+};
+
+// Finds what keeps a method from being pure on its own, the callees are
+// checked afterwards
+class purity_checker_t : public ast_visitor_t
+{
+private:
+	bool pure;
+	std::set<method_t *> callees;
+
+	void check_slot(variable_slot_t slot);
+
+public:
+	purity_checker_t();
+
+	bool check(method_t * method);
+
+	const std::set<method_t *> & get_callees()
+	{
+		return callees;
+	}
+
+	void visit(statement_list_t * node);
+	void visit(code_block_statement_t * node);
+	void visit(declaration_t * node);
+	void visit(assignment_t * node);
+	void visit(read_statement_t * node);
+	void visit(write_statement_t * node);
+	void visit(return_statement_t * node);
+	void visit(conditional_statement_t * node);
+	void visit(while_statement_t * node);
+	void visit(do_statement_t * node);
+	void visit(break_statement_t * node);
+	void visit(cycle_statement_t * node);
+	void visit(invoke_statement_t * node);
+	void visit(constant_t * node);
+	void visit(variable_expression_t * node);
+	void visit(binary_expression_t * node);
+	void visit(short_circuit_expression_t * node);
+	void visit(invocation_expression_t * node);
+	void visit(array_declaration_t * node);
+	void visit(element_expression_t * node);
+	void visit(element_assignment_t * node);
+	void visit(reduction_expression_t * node);
+};
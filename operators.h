@@ -0,0 +1,132 @@
+#pragma once
+
+#include "syntax_engine.h"
+
+// Integer operators, one type each so that templates over them get the
+// operation inlined; a comparison or a boolean one yields 0 or 1. check
+// raises the error of operands apply has no result for, with the line of
+// the operation.
+
+// an operator with a result for any operands
+struct total_operator_t
+{
+	static void check(int left, int right, int line)
+	{
+	}
+};
+
+struct add_operator_t : total_operator_t
+{
+	static int apply(int left, int right)
+	{
+		return left + right;
+	}
+};
+
+struct sub_operator_t : total_operator_t
+{
+	static int apply(int left, int right)
+	{
+		return left - right;
+	}
+};
+
+struct mul_operator_t : total_operator_t
+{
+	static int apply(int left, int right)
+	{
+		return left * right;
+	}
+};
+
+struct div_operator_t
+{
+	static void check(int left, int right, int line)
+	{
+		check_division(left, right, line);
+	}
+
+	static int apply(int left, int right)
+	{
+		return left / right;
+	}
+};
+
+struct mod_operator_t
+{
+	static void check(int left, int right, int line)
+	{
+		check_division(left, right, line);
+	}
+
+	static int apply(int left, int right)
+	{
+		return left % right;
+	}
+};
+
+// both operands are evaluated, as by the tree walker; the optimizer turns
+// the AND and OR it may into short_circuit_expression_t
+struct and_operator_t : total_operator_t
+{
+	static int apply(int left, int right)
+	{
+		return left && right;
+	}
+};
+
+struct or_operator_t : total_operator_t
+{
+	static int apply(int left, int right)
+	{
+		return left || right;
+	}
+};
+
+struct equals_operator_t : total_operator_t
+{
+	static int apply(int left, int right)
+	{
+		return left == right;
+	}
+};
+
+struct not_equals_operator_t : total_operator_t
+{
+	static int apply(int left, int right)
+	{
+		return left != right;
+	}
+};
+
+struct lesser_operator_t : total_operator_t
+{
+	static int apply(int left, int right)
+	{
+		return left < right;
+	}
+};
+
+struct greater_operator_t : total_operator_t
+{
+	static int apply(int left, int right)
+	{
+		return left > right;
+	}
+};
+
+struct lesser_equals_operator_t : total_operator_t
+{
+	static int apply(int left, int right)
+	{
+		return left <= right;
+	}
+};
+
+struct greater_equals_operator_t : total_operator_t
+{
+	static int apply(int left, int right)
+	{
+		return left >= right;
+	}
+};
@@ -0,0 +1,176 @@
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#include "output.h"
+
+// output of the thread being captured, see output_capture_t
+static thread_local std::string * captured = NULL;
+
+// output_buffer_t
+
+output_buffer_t::output_buffer_t(FILE * stream, bool interactive_input)
+{
+	used = 0;
+	this->stream = stream;
+	mode = isatty(fileno(stream)) ? omLine : omBlock;
+	this->interactive_input = interactive_input;
+}
+
+void output_buffer_t::set_mode(output_mode mode)
+{
+	flush();
+	this->mode = mode;
+}
+
+void output_buffer_t::append(const char * data, size_t size)
+{
+	if (captured != NULL)
+	{
+		captured->append(data, size);
+		return;
+	}
+	if (used + size > OUTPUT_BUFFER_SIZE)
+	{
+		flush();
+		if (size > OUTPUT_BUFFER_SIZE)
+		{
+			fwrite(data, 1, size, stream);
+			fflush(stream);
+			return;
+		}
+	}
+	memcpy(buffer + used, data, size);
+	used += size;
+}
+
+void output_buffer_t::write(const char * string)
+{
+	append(string, strlen(string));
+	append(" ", 1);
+	if (mode == omUnbuffered)
+	{
+		flush();
+	}
+}
+
+void output_buffer_t::write_int(int value)
+{
+	char digits[INT_BUFFER_SIZE + 1];
+	size_t size = format_int(value, digits);
+	digits[size++] = ' ';
+	append(digits, size);
+	if (mode == omUnbuffered)
+	{
+		flush();
+	}
+}
+
+void output_buffer_t::write_bool(bool value)
+{
+	write(value ? "true" : "false");
+}
+
+void output_buffer_t::end_line()
+{
+	append("\n", 1);
+	if (mode != omBlock)
+	{
+		flush();
+	}
+}
+
+void output_buffer_t::flush()
+{
+	if (captured != NULL)
+	{
+		return;
+	}
+	if (used > 0)
+	{
+		fwrite(buffer, 1, used, stream);
+		used = 0;
+	}
+	fflush(stream);
+}
+
+void output_buffer_t::flush_for_input()
+{
+	if (interactive_input)
+	{
+		flush();
+	}
+}
+
+void output_buffer_t::write_captured(const std::string & text)
+{
+	if (text.empty())
+	{
+		return;
+	}
+	append(text.data(), text.size());
+	if (mode != omBlock)
+	{
+		flush();
+	}
+}
+
+// output_capture_t
+
+output_capture_t::output_capture_t(std::string * target)
+{
+	outer = captured;
+	captured = target;
+}
+
+output_capture_t::~output_capture_t()
+{
+	captured = outer;
+}
+
+// Utilities
+
+bool parse_output_mode(const char * string, output_mode & mode)
+{
+	if (!strcmp(string, "line"))
+	{
+		mode = omLine;
+		return true;
+	}
+	if (!strcmp(string, "block"))
+	{
+		mode = omBlock;
+		return true;
+	}
+	if (!strcmp(string, "unbuffered"))
+	{
+		mode = omUnbuffered;
+		return true;
+	}
+	return false;
+}
+
+size_t format_int(int value, char * buffer)
+{
+	// digits are produced from the end, unsigned keeps INT_MIN negatable
+	char digits[INT_BUFFER_SIZE];
+	size_t count = 0;
+	unsigned int rest = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+	do
+	{
+		digits[count++] = (char)('0' + rest % 10);
+		rest /= 10;
+	} while (rest != 0);
+
+	size_t size = 0;
+	if (value < 0)
+	{
+		buffer[size++] = '-';
+	}
+	while (count > 0)
+	{
+		buffer[size++] = digits[--count];
+	}
+	buffer[size] = '\0';
+	return size;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+enum output_mode
+{
+	omLine,				// flush at the end of every WRITE
+	omBlock,			// flush when the buffer is full
+	omUnbuffered		// flush after every item
+};
+
+const size_t OUTPUT_BUFFER_SIZE = 1 << 16;
+
+// Enough to hold any formatted int
+const size_t INT_BUFFER_SIZE = 12;
+
+// Output of WRITE shared by both engines. Everything goes through one block
+// buffer, so a WRITE neither allocates nor makes a syscall unless the mode
+// asks for it.
+class output_buffer_t
+{
+private:
+	char buffer[OUTPUT_BUFFER_SIZE];
+	size_t used;
+	FILE * stream;
+	output_mode mode;
+	bool interactive_input;
+
+	void append(const char * data, size_t size);
+
+public:
+	output_buffer_t(FILE * stream, bool interactive_input);
+
+	void set_mode(output_mode mode);
+
+	// each item is followed by a space
+	void write(const char * string);
+	void write_int(int value);
+	void write_bool(bool value);
+	void end_line();
+
+	void flush();
+	// READ on a terminal has to show the prompt written before it
+	void flush_for_input();
+
+	// appends output captured before, in the mode of a single WRITE
+	void write_captured(const std::string & text);
+};
+
+// Sends the output of the calling thread to target for the lifetime of the
+// object, a chunk of DO CONCURRENT writes apart from the others this way
+class output_capture_t
+{
+private:
+	std::string * outer;
+
+public:
+	output_capture_t(std::string * target);
+	~output_capture_t();
+};
+
+bool parse_output_mode(const char * string, output_mode & mode);
+// Writes the digits into buffer, returns the number of chars without '\0'
+size_t format_int(int value, char * buffer);
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+
+#include "syntax_engine.h"
+
+// Parses the text of a program into a new program_t, which is not resolved
+// or checked yet. A syntax error is raised like any other error. Parses may
+// go on side by side on different threads.
+program_t * parse_program(const std::string & source);
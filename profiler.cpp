@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <vector>
+
+#include "profiler.h"
+
+// profiler_t
+
+void profiler_t::instrument(program_t * program)
+{
+	std::vector<method_t *> all_methods;
+	all_methods.push_back(program->get_main());
+	for(auto it = program->get_methods().begin(); it != program->get_methods().end(); ++it)
+	{
+		all_methods.push_back(it->second);
+	}
+
+	main_id = program->get_main()->ID;
+
+	profile_instrumenter_t instrumenter(this);
+	for(size_t index = 0; index < all_methods.size(); ++index)
+	{
+		method_t * method = all_methods[index];
+		method->get_body()->accept(&instrumenter);
+
+		// the whole body is timed once more for the method
+		statement_list_t * body = new statement_list_t();
+		body->add(new profiled_statement_t(method->get_body(), &methods[method->ID]));
+		method->replace_body(body);
+	}
+}
+
+static bool hotter(const std::pair<std::string, profile_entry_t> & first, const std::pair<std::string, profile_entry_t> & second)
+{
+	return first.second.time > second.second.time;
+}
+
+void profiler_t::report(const char * file_name, FILE * stream)
+{
+	fprintf(stream, "\nprofile of %s, %s include nested statements and calls\n\n", file_name, PROFILE_CLOCK_UNIT);
+	fprintf(stream, "%6s %12s %16s  %s\n", "line", "count", PROFILE_CLOCK_UNIT, "source");
+
+	FILE * source = fopen(file_name, "r");
+	if (source != NULL)
+	{
+		char text[1024];
+		int line = 1;
+		while (fgets(text, sizeof(text), source) != NULL)
+		{
+			size_t length = strlen(text);
+			bool complete = length > 0 && text[length - 1] == '\n';
+			while (length > 0 && (text[length - 1] == '\n' || text[length - 1] == '\r'))
+			{
+				text[--length] = '\0';
+			}
+
+			auto it = lines.find(line);
+			if (it != lines.end() && it->second.count != 0)
+			{
+				fprintf(stream, "%6d %12llu %16llu  %s\n", line, it->second.count, it->second.time, text);
+			}
+			else
+			{
+				fprintf(stream, "%6d %12s %16s  %s\n", line, "", "", text);
+			}
+
+			// the rest of a very long line is skipped
+			while (!complete && fgets(text, sizeof(text), source) != NULL)
+			{
+				length = strlen(text);
+				complete = length > 0 && text[length - 1] == '\n';
+			}
+			++line;
+		}
+		fclose(source);
+	}
+
+	std::vector<std::pair<std::string, profile_entry_t> > hot(methods.begin(), methods.end());
+	std::sort(hot.begin(), hot.end(), hotter);
+	unsigned long long total = hot.empty() ? 0 : hot[0].second.time;
+
+	fprintf(stream, "\nhot methods\n\n");
+	fprintf(stream, "%-24s %12s %16s %7s\n", "method", "calls", PROFILE_CLOCK_UNIT, "%");
+	for(size_t index = 0; index < hot.size() && index < PROFILE_TOP_METHODS; ++index)
+	{
+		const profile_entry_t & entry = hot[index].second;
+		double share = total != 0 ? 100.0 * entry.time / total : 0.0;
+		fprintf(stream, "%-24s %12llu %16llu %6.1f%%\n", hot[index].first.c_str(), entry.count, entry.time, share);
+	}
+
+	unsigned long long statements = 0;
+	for(auto it = lines.begin(); it != lines.end(); ++it)
+	{
+		statements += it->second.count;
+	}
+	unsigned long long calls = 0;
+	for(auto it = methods.begin(); it != methods.end(); ++it)
+	{
+		if (it->first != main_id)
+		{
+			calls += it->second.count;
+		}
+	}
+	fprintf(stream, "\nexecuted %llu statements, %llu calls\n", statements, calls);
+}
+
+// profile_instrumenter_t
+
+// statements added by the parser itself have no line and stay as they are,
+// nested lists are only looked into so their lines are not counted twice
+void profile_instrumenter_t::visit(statement_list_t * node)
+{
+	for(size_t index = 0; index < node->size(); ++index)
+	{
+		statement_t * stmt = node->get_at(index);
+		stmt->accept(this);
+		if (stmt->get_line() > 0 && dynamic_cast<statement_list_t *>(stmt) == NULL)
+		{
+			node->set_at(index, new profiled_statement_t(stmt, profiler->get_line_entry(stmt->get_line())));
+		}
+	}
+}
+
+void profile_instrumenter_t::visit(code_block_statement_t * node)
+{
+	node->get_body()->accept(this);
+}
+
+void profile_instrumenter_t::visit(declaration_t * node)
+{
+}
+
+void profile_instrumenter_t::visit(assignment_t * node)
+{
+}
+
+void profile_instrumenter_t::visit(read_statement_t * node)
+{
+}
+
+void profile_instrumenter_t::visit(write_statement_t * node)
+{
+}
+
+void profile_instrumenter_t::visit(return_statement_t * node)
+{
+}
+
+void profile_instrumenter_t::visit(conditional_statement_t * node)
+{
+	node->get_true_way()->accept(this);
+	if (node->get_false_way() != NULL)
+	{
+		node->get_false_way()->accept(this);
+	}
+}
+
+void profile_instrumenter_t::visit(while_statement_t * node)
+{
+	node->get_body()->accept(this);
+}
+
+void profile_instrumenter_t::visit(do_statement_t * node)
+{
+	node->get_body()->accept(this);
+}
+
+void profile_instrumenter_t::visit(break_statement_t * node)
+{
+}
+
+void profile_instrumenter_t::visit(cycle_statement_t * node)
+{
+}
+
+void profile_instrumenter_t::visit(invoke_statement_t * node)
+{
+}
+
+void profile_instrumenter_t::visit(constant_t * node)
+{
+}
+
+void profile_instrumenter_t::visit(variable_expression_t * node)
+{
+}
+
+void profile_instrumenter_t::visit(binary_expression_t * node)
+{
+}
+
+void profile_instrumenter_t::visit(short_circuit_expression_t * node)
+{
+}
+
+void profile_instrumenter_t::visit(invocation_expression_t * node)
+{
+}
+
+void profile_instrumenter_t::visit(array_declaration_t * node)
+{
+}
+
+void profile_instrumenter_t::visit(element_expression_t * node)
+{
+}
+
+void profile_instrumenter_t::visit(element_assignment_t * node)
+{
+}
+
+void profile_instrumenter_t::visit(reduction_expression_t * node)
+{
+}
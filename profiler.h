@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstdio>
+#include <map>
+#include <string>
+
+#include "syntax_engine.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// Execution profile of a run of the tree walker (--profile). The statements
+// are wrapped into counting nodes after the other passes, so a run without
+// the option executes exactly the same tree as before.
+
+struct profile_entry_t
+{
+	unsigned long long count;
+	unsigned long long time;
+	// nesting of the entry on the current path, only the outermost one is
+	// timed so recursion is not counted twice
+	unsigned int active;
+
+	profile_entry_t()
+	{
+		count = 0;
+		time = 0;
+		active = 0;
+	}
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+const char * const PROFILE_CLOCK_UNIT = "cycles";
+#else
+const char * const PROFILE_CLOCK_UNIT = "ns";
+#endif
+
+inline unsigned long long read_profile_clock()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Hot methods shown in the report
+const size_t PROFILE_TOP_METHODS = 10;
+
+class profiler_t
+{
+private:
+	std::map<int, profile_entry_t> lines;
+	std::map<std::string, profile_entry_t> methods;
+	std::string main_id;
+
+public:
+	// wraps the statements of every method, the tree must not be changed
+	// by other passes afterwards
+	void instrument(program_t * program);
+
+	// annotated listing of the source followed by the hot methods and the
+	// totals, the last line is "executed <n> statements, <n> calls"
+	void report(const char * file_name, FILE * stream);
+
+	profile_entry_t * get_line_entry(int line)
+	{
+		return &lines[line];
+	}
+};
+
+// Counts the executions of a statement and the time spent in it, nested
+// statements and calls included
+class profiled_statement_t : public statement_t
+{
+private:
+	statement_t * stmt;
+	profile_entry_t * entry;
+
+public:
+	profiled_statement_t(statement_t * stmt, profile_entry_t * entry)
+	{
+		this->stmt = stmt;
+		this->entry = entry;
+		line = stmt->get_line();
+	}
+
+	flow_interruption_type execute(code_block_t * block)
+	{
+		profile_entry_t * entry = this->entry;
+		++entry->count;
+		if (entry->active++ != 0)
+		{
+			flow_interruption_type result = stmt->execute(block);
+			--entry->active;
+			return result;
+		}
+
+		unsigned long long start = read_profile_clock();
+		flow_interruption_type result = stmt->execute(block);
+		entry->time += read_profile_clock() - start;
+		--entry->active;
+		return result;
+	}
+
+	void resolve(scope_t * scope)
+	{
+		stmt->resolve(scope);
+	}
+
+	void typecheck()
+	{
+		stmt->typecheck();
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		stmt->accept(visitor);
+	}
+};
+
+// Wraps every statement reachable from the visited one
+class profile_instrumenter_t : public ast_visitor_t
+{
+private:
+	profiler_t * profiler;
+
+public:
+	profile_instrumenter_t(profiler_t * profiler)
+	{
+		this->profiler = profiler;
+	}
+
+	void visit(statement_list_t * node);
+	void visit(code_block_statement_t * node);
+	void visit(declaration_t * node);
+	void visit(assignment_t * node);
+	void visit(read_statement_t * node);
+	void visit(write_statement_t * node);
+	void visit(return_statement_t * node);
+	void visit(conditional_statement_t * node);
+	void visit(while_statement_t * node);
+	void visit(do_statement_t * node);
+	void visit(break_statement_t * node);
+	void visit(cycle_statement_t * node);
+	void visit(invoke_statement_t * node);
+	void visit(constant_t * node);
+	void visit(variable_expression_t * node);
+	void visit(binary_expression_t * node);
+	void visit(short_circuit_expression_t * node);
+	void visit(invocation_expression_t * node);
+	void visit(array_declaration_t * node);
+	void visit(element_expression_t * node);
+	void visit(element_assignment_t * node);
+	void visit(reduction_expression_t * node);
+};
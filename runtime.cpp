@@ -0,0 +1,54 @@
+#include <unistd.h>
+
+#include "runtime.h"
+
+static thread_local runtime_t * current = NULL;
+static thread_local bool trapping = false;
+
+// runtime_t
+
+runtime_t::runtime_t(int input_fd, FILE * output_stream)
+	: output(output_stream, isatty(input_fd) != 0), input(input_fd)
+{
+}
+
+runtime_t::runtime_t(const char * input_text, size_t input_size, FILE * output_stream)
+	: output(output_stream, false), input(input_text, input_size)
+{
+}
+
+runtime_t * runtime_t::get_current()
+{
+	return current;
+}
+
+// current_runtime_t
+
+current_runtime_t::current_runtime_t(runtime_t * runtime)
+{
+	outer = current;
+	current = runtime;
+}
+
+current_runtime_t::~current_runtime_t()
+{
+	current = outer;
+}
+
+// error_trap_t
+
+error_trap_t::error_trap_t(bool active)
+{
+	outer = trapping;
+	trapping = active;
+}
+
+error_trap_t::~error_trap_t()
+{
+	trapping = outer;
+}
+
+bool error_trap_t::is_active()
+{
+	return trapping;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#include "output.h"
+#include "input.h"
+
+// State of one run of a program: the streams of READ and WRITE. Apart from
+// its frames a run changes nothing else, so runs of the same program may go
+// on side by side on different threads (--batch).
+class runtime_t
+{
+public:
+	output_buffer_t output;
+	input_reader_t input;
+
+	runtime_t(int input_fd, FILE * output_stream);
+	// READ takes the integers from the given text, which has to outlive the
+	// run
+	runtime_t(const char * input_text, size_t input_size, FILE * output_stream);
+
+	// the run going on on the calling thread, NULL outside of a run
+	static runtime_t * get_current();
+};
+
+// Error raised while an error_trap_t is alive, the message is formatted
+// already
+class fortran_error_t : public std::runtime_error
+{
+public:
+	fortran_error_t(const std::string & message)
+		: std::runtime_error(message)
+	{
+	}
+};
+
+// Turns the errors raised on the calling thread into fortran_error_t for the
+// lifetime of the object, without it an error ends the process
+class error_trap_t
+{
+private:
+	bool outer;
+
+public:
+	// active false lifts an outer trap
+	error_trap_t(bool active = true);
+	~error_trap_t();
+
+	static bool is_active();
+};
+
+// Makes a runtime the current one of the thread for the lifetime of the
+// object
+class current_runtime_t
+{
+private:
+	runtime_t * outer;
+
+public:
+	current_runtime_t(runtime_t * runtime);
+	~current_runtime_t();
+};
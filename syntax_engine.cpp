@@ -1,567 +1,2173 @@
-#include <utility>
-#include <cstdio>
-#include <cstdarg>
-#include <sstream>
-#include <algorithm>
-#include <iostream>
-
-#include "syntax_engine.h"
-
-void yyerror(const char *);
-
-// code_block_t
-
-bool code_block_t::check_declared(const std::string & ID)
-{
-	auto it = scope_variables.find(ID);
-	if (it != scope_variables.end())
-	{
-		return true;
-	}
-	else
-	{
-		if (parent == NULL)
-		{
-			return false;
-		}
-		else
-		{
-			return parent->check_declared(ID);
-		}
-	}
-}
-
-variable_t code_block_t::get_variable(const std::string & ID)
-{
-	auto it = scope_variables.find(ID);
-	if (it == scope_variables.end())
-	{
-		// trying to search in parent scope
-		if (parent == NULL)
-		{
-			raise_error("undeclared variable: %s", ID.c_str());
-		}
-		else
-		{
-			return parent->get_variable(ID);
-		}
-	}
-	else
-	{
-		return it->second;		
-	}
-}
-
-void code_block_t::declare_variable(const std::string & ID, variable_type type)
-{
-	if (check_declared(ID))
-	{
-		raise_error("redefinition of %s", ID.c_str());
-	}
-
-	variable_t var;
-	var.is_declared = true;
-	var.set_type(type);
-
-	scope_variables.insert(std::make_pair(ID, var));
-}
-
-void code_block_t::set_variable(const std::string & ID, variant_t value)
-{
-	auto it = scope_variables.find(ID);
-	if (it == scope_variables.end())
-	{
-		if (parent != NULL)
-		{
-			parent->set_variable(ID, value);
-		}
-		else
-		{
-			raise_error("assignment to undeclared variable: %s", ID.c_str());
-		}
-		return;
-	}
-	
-	variable_t & ref = it->second;
-	if (!ref.is_assignable_from(value.type))
-	{
-		raise_error("conversion error: can't convert %s to %s", to_string(value.type), to_string(ref.get_type()));
-	}
-	ref.is_assigned = true;
-	ref.value = value;
-}
-
-void code_block_t::declare_set_variable(const std::string & name, variant_t value)
-{
-	declare_variable(name, value.type);
-	set_variable(name, value);
-}
-
-// program_t
-void program_t::add_method(method_t * method)
-{
-	auto it = methods.find(method->ID);
-	if (it != methods.end())
-	{
-		raise_error("method redeclaration: %s", method->ID.c_str());
-	}
-	method->set_block(class_block);
-	methods.insert(std::make_pair(method->ID, method));
-}
-
-void program_t::set_name(const char * name)
-{
-	ID = name;
-}
-
-void program_t::run()
-{
-	if (main == NULL)
-	{
-		raise_error("main method not found");
-	}
-
-	fields_declaration->execute(class_block);
-	main->run();
-}
-
-program_t::program_t()
-{
-	main = NULL;
-	class_block = new code_block_t();
-	fields_declaration = new statement_list_t;
-}
-
-void program_t::add_field_declaration(statement_t * stmt)
-{
-	fields_declaration->add(stmt);
-}
-
-// method_t
-
-method_t::method_t(const char * name, variable_type return_type, method_signature_t * args)
-{
-	this->return_type = return_type;
-	arguments = args;
-	ID = name;
-	arguments_passed = 0;
-}
-
-void method_t::set_body(statement_list_t * body)
-{
-	this->body = body;
-	body->add(new return_statement_t(this));
-}
-
-void method_t::set_block(code_block_t * method_block)
-{
-	this->method_block = method_block;
-}
-
-void method_t::set_return_value(variant_t value)
-{
-	if (return_type != vtNoType)
-	{
-		return_value = value;
-	}
-}
-
-variable_type method_t::get_return_type()
-{
-	return return_type;
-}
-
-const char * method_t::get_id()
-{
-	return ID.c_str();
-}
-
-variant_t method_t::run()
-{
-	if (arguments_passed != arguments->size())
-	{
-		raise_error("'%s': too few arguments", ID.c_str());
-	}
-
-	arguments_passed = 0;
-
-	method_block->declare_variable(ID, vtInt);
-
-	flow_interruption_type result = body->execute(method_block);
-
-	if (return_type == vtNoType)
-	{
-		return variant_t();
-	}
-	else
-	{
-		return method_block->get_variable(ID).value;
-	}
-}
-
-void method_t::add_argument(variant_t value)
-{
-	if (arguments_passed + 1 > arguments->size())
-	{
-		raise_error("'%s': too many arguments", ID.c_str());
-	}
-
-	argument_t * arg = arguments->get_at(arguments_passed);
-	method_block->declare_set_variable(arg->ID, value);
-	arguments_passed += 1;
-}
-
-// while_statement_t
-
-while_statement_t::while_statement_t(expression_t * condition, statement_t * body)
-{
-	this->condition = condition;
-	this->body = body;
-}
-
-flow_interruption_type while_statement_t::execute(code_block_t * block)
-{
-	flow_interruption_type result = fitNoIterruption;
-
-	do
-	{
-		result = body->execute(block);
-		if (result != fitNoIterruption)
-		{
-			break;
-		}
-	} while(condition_true(block));
-
-	if (result == fitReturn)
-	{
-		return fitReturn;
-	}
-	else
-	{
-		return fitNoIterruption;
-	}
-}
-
-bool while_statement_t::condition_true(code_block_t * block)
-{
-	variant_t cond = condition->eval(block);
-	if (cond.type != vtBool)
-	{
-		raise_error("expected boolean expression in while");
-	}
-	return cond.bool_value;
-}
-
-// statement_list_t
-statement_list_t::statement_list_t()
-{
-}
-
-// return_statement_t
-flow_interruption_type return_statement_t::execute(code_block_t * block)
-{
-	variant_t result = block->get_variable(method->ID).value;
-	method->set_return_value(result);
-	return fitReturn;
-}
-
-// code_block_statement_t
-
-code_block_statement_t::code_block_statement_t(statement_list_t * body)
-{
-	this->body = body;
-}
-
-flow_interruption_type code_block_statement_t::execute(code_block_t * block)
-{
-	return body->execute(new code_block_t(block));
-}
-
-// variable_expression_t 
-
-variant_t variable_expression_t::eval(code_block_t * block)
-{
-	variable_t var = block->get_variable(ID);
-	if (!var.is_assigned)
-	{
-		raise_error("'%s': using uninitialized variable", ID.c_str());
-	}
-	return var.value;
-}
-
-// conditional_statement_t
-
-conditional_statement_t::conditional_statement_t(expression_t * condition, statement_t * true_way, statement_t * false_way)
-{
-	this->true_way = true_way;
-	this->false_way = false_way;
-	this->condition = condition;
-}
-
-flow_interruption_type conditional_statement_t::execute(code_block_t * block)
-{
-	variant_t cond = condition->eval(block);
-	if (cond.type != vtBool)
-	{
-		raise_error("expected boolean expression in if");
-	}
-
-	flow_interruption_type result = fitNoIterruption;
-
-	if (cond.bool_value == true)
-	{
-		result = true_way->execute(block);
-	}
-	else
-	{
-		if (false_way != NULL)
-		{
-			result = false_way->execute(block);
-		}
-	}
-	return result;
-}
-
-// binary_expression_t
-
-variant_t binary_expression_t::eval(code_block_t * block)
-{
-	variant_t value1 = arg1->eval(block);
-	variant_t value2 = arg2->eval(block);
-
-	check_types(value1, value2);
-
-	variant_t result;
-	switch (type)
-	{
-	case opAdd:
-		result.type = vtInt;
-		result.int_value = value1.int_value + value2.int_value;
-		break;
-	case opSub:
-		result.type = vtInt;
-		result.int_value = value1.int_value - value2.int_value;
-		break;
-	case opMul:
-		result.type = vtInt;
-		result.int_value = value1.int_value * value2.int_value;
-		break;
-	case opDiv:
-		result.type = vtInt;
-		result.int_value = value1.int_value / value2.int_value;
-		break;
-	case opMod:
-		result.type = vtInt;
-		result.int_value = value1.int_value % value2.int_value;
-		break;
-	case opAnd:
-		result.type = vtBool;
-		result.bool_value = value1.bool_value && value2.bool_value;
-		break;
-	case opOr:
-		result.type = vtBool;
-		result.bool_value = value1.bool_value || value2.bool_value;
-		break;
-	case opEquals:
-		result.type = vtBool;
-		result.bool_value = variant_equals(value1, value2);
-		break;
-	case opNotEquals:
-		result.type = vtBool;
-		result.bool_value = !variant_equals(value1, value2);
-		break;
-	case opLesser:
-		result.type = vtBool;
-		result.bool_value = value1.int_value < value2.int_value;
-		break;
-	case opGreater:
-		result.type = vtBool;
-		result.bool_value = value1.int_value > value2.int_value;
-		break;
-	case opLesserEquals:
-		result.type = vtBool;
-		result.bool_value = value1.int_value <= value2.int_value;
-		break;
-	case opGreaterEquals:
-		result.type = vtBool;
-		result.bool_value = value1.int_value >= value2.int_value;
-		break;
-	default:
-		break;
-	}
-	return result;
-}
-
-bool binary_expression_t::check_types(variant_t value1, variant_t value2)
-{
-	switch (type)
-	{
-	case opAdd:
-	case opSub:
-	case opMul:
-	case opDiv:
-	case opMod:
-		return value1.type == value2.type && value1.type == vtInt;
-	case opAnd:
-	case opOr:
-		return value1.type == value2.type && value1.type == vtBool;
-	case opEquals:
-	case opNotEquals:
-		return value1.type == value2.type;
-		break;
-	case opLesser:
-	case opGreater:
-	case opLesserEquals:
-	case opGreaterEquals:
-		return value1.type == value2.type && value1.type == vtInt;
-	default:
-		return false;
-	}
-}
-
-// invokation_expression_t
-variant_t invocation_expression_t::eval(code_block_t * block)
-{
-	method_t * method = clazz->get_method(method_id);
-	if (method == NULL)
-	{
-		raise_error("'%s': method not found", method_id.c_str());
-	}
-
-	method->set_block(new code_block_t());
-
-	for(size_t index = 0; index < params->size(); ++index)
-	{
-		variant_t value = params->get_at(index)->eval(block);
-		method->add_argument(value);
-	}
-	
-	return method->run();
-}
-
-// break_statement_t 
-
-flow_interruption_type break_statement_t::execute(code_block_t * block)
-{
-	return fitBreak;
-}
-
-// invoke_statement_t
-
-invoke_statement_t::invoke_statement_t(expression_t * invokee)
-{
-	this->invokee = invokee;
-}
-
-flow_interruption_type invoke_statement_t::execute(code_block_t * block)
-{
-	invokee->eval(block);
-	return fitNoIterruption;
-}
-
-// read_statement_t
-
-flow_interruption_type read_statement_t::execute(code_block_t * block)
-{
-	for(size_t index = 0; index < args->size(); ++index)
-	{
-		variant_t value;
-		value.type = vtInt;
-		std::cin >> value.int_value;
-		block->set_variable(args->get_at(index), value);
-	}
-	return fitNoIterruption;
-}
-
-// write_arguments_t
-
-std::string write_arguments_t::get_at(size_t index, code_block_t * block)
-{
-	if (order[index] == 0)
-	{
-		variant_t result = exprs[exprs_index++]->eval(block);
-		return to_string(result);
-	}
-	else
-	{
-		return messages[messages_index++];
-	}
-}
-
-// write_statement_t 
-
-flow_interruption_type write_statement_t::execute(code_block_t * block)
-{
-	for(size_t index = 0; index < args->size(); ++index)
-	{
-		std::cout << args->get_at(index, block) << " ";
-	}
-	std::cout << std::endl;
-	return fitNoIterruption;
-}
-
-// Utilities
-
-void raise_error(const char * format, ...)
-{
-	//char message[256];
-	va_list args;
-	va_start(args, format);
-	vfprintf(stderr, format, args);
-	fprintf(stderr, "\n");
-	//yyerror(message);
-	va_end(args);
-	exit(-1);
-}
-
-variable_type parse_type(const char * string)
-{
-	if (!strcmp(string, "int"))
-	{
-		return vtInt;
-	}
-
-	if (!strcmp(string, "boolean"))
-	{
-		return vtBool;
-	}
-
-	return vtNoType;
-}
-
-
-const char * to_string(variable_type type)
-{
-	switch (type)
-	{
-	case vtInt:
-		return "int";
-	case vtBool:
-		return "boolean";
-	case vtNoType:
-		return "undefined type";
-	default:
-		return NULL;
-	}
-}
-
-const char * to_string(variant_t value)
-{
-	char * result = new char[256];
-	switch (value.type)
-	{
-	case vtInt:
-		sprintf(result, "%d", value.int_value);
-		break;
-	case vtBool:
-		strcpy(result, value.bool_value ? "true" : "false");
-	default:
-		break;
-	}
-	return result;
-}
-
-bool variant_equals(variant_t first, variant_t second)
-{
-	return memcmp(&first, &second, sizeof(variant_t)) == 0;
-}
+#include <utility>
+#include <climits>
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+#include <memory>
+#include <pthread.h>
+
+#include "syntax_engine.h"
+#include "runtime.h"
+#include "jit.h"
+#include "memoizer.h"
+#include "concurrency.h"
+#include "operators.h"
+#include "inliner.h"
+
+void yyerror(const char *);
+
+// tree_node_t
+
+static thread_local tree_arena_t * current_tree_arena = NULL;
+
+tree_node_t::tree_node_t()
+{
+	if (current_tree_arena != NULL)
+	{
+		current_tree_arena->adopt(this);
+	}
+}
+
+tree_node_t::tree_node_t(const tree_node_t & node)
+{
+	if (current_tree_arena != NULL)
+	{
+		current_tree_arena->adopt(this);
+	}
+}
+
+// tree_arena_t
+
+tree_arena_t::~tree_arena_t()
+{
+	for(size_t index = 0; index < nodes.size(); ++index)
+	{
+		delete nodes[index];
+	}
+}
+
+tree_arena_t * tree_arena_t::get_current()
+{
+	return current_tree_arena;
+}
+
+// current_tree_arena_t
+
+current_tree_arena_t::current_tree_arena_t(tree_arena_t * arena)
+{
+	outer = current_tree_arena;
+	current_tree_arena = arena;
+}
+
+current_tree_arena_t::~current_tree_arena_t()
+{
+	current_tree_arena = outer;
+}
+
+// scope_t
+
+scope_t::scope_t(scope_t * parent, bool new_frame, bool isolated)
+{
+	this->parent = parent;
+	this->isolated = isolated && parent != NULL;
+	frame_size = 0;
+	array_area_size = 0;
+	if ((new_frame && !this->isolated) || parent == NULL)
+	{
+		frame_owner = this;
+	}
+	else
+	{
+		frame_owner = parent->frame_owner;
+	}
+}
+
+bool scope_t::check_declared(const std::string & ID)
+{
+	variable_slot_t slot;
+	return find_variable(ID, slot);
+}
+
+size_t scope_t::declare_variable(const std::string & ID, variable_type type, int line)
+{
+	if (check_declared(ID))
+	{
+		raise_error_at(line, "redefinition of %s", ID.c_str());
+	}
+
+	entry_t entry;
+	entry.index = frame_owner->frame_size++;
+	entry.type = type;
+	entry.size = 0;
+	names.insert(std::make_pair(ID, entry));
+	return entry.index;
+}
+
+size_t scope_t::declare_array(const std::string & ID, size_t size, int line)
+{
+	if (check_declared(ID))
+	{
+		raise_error_at(line, "redefinition of %s", ID.c_str());
+	}
+
+	entry_t entry;
+	entry.index = frame_owner->array_area_size;
+	entry.type = vtArray;
+	entry.size = size;
+	frame_owner->array_area_size += array_storage_size(size);
+	names.insert(std::make_pair(ID, entry));
+	return entry.index;
+}
+
+bool scope_t::find_variable(const std::string & ID, variable_slot_t & slot, variable_type * type, size_t * size)
+{
+	slot.depth = 0;
+	scope_t * next;
+	for(scope_t * scope = this; scope != NULL; scope = next)
+	{
+		auto it = scope->names.find(ID);
+		if (it != scope->names.end())
+		{
+			slot.index = it->second.index;
+			if (type != NULL)
+			{
+				*type = it->second.type;
+			}
+			if (size != NULL)
+			{
+				*size = it->second.size;
+			}
+			return true;
+		}
+
+		// an isolated scope goes on past the scopes of its frame
+		next = scope->isolated ? scope->frame_owner->parent : scope->parent;
+		if (next != NULL && next->frame_owner != scope->frame_owner)
+		{
+			slot.depth += 1;
+		}
+	}
+	return false;
+}
+
+// frame_stack_t
+
+frame_stack_t::frame_stack_t(size_t size, size_t arrays_size)
+{
+	this->size = size;
+	top = 0;
+	this->arrays_size = arrays_size;
+	arrays_top = 0;
+	storage = (variable_t *)malloc(size * sizeof(variable_t));
+	if (storage == NULL)
+	{
+		raise_error("can't allocate %d variables", (int)size);
+	}
+	if (posix_memalign((void **)&arrays, ARRAY_ALIGNMENT, arrays_size * sizeof(int)) != 0)
+	{
+		raise_error("can't allocate %d array elements", (int)arrays_size);
+	}
+}
+
+frame_stack_t::~frame_stack_t()
+{
+	free(storage);
+	free(arrays);
+}
+
+variable_t * frame_stack_t::push(size_t size)
+{
+	if (top + size > this->size)
+	{
+		raise_error("stack overflow");
+	}
+
+	variable_t * frame = &storage[top];
+	top += size;
+	for(size_t index = 0; index < size; ++index)
+	{
+		frame[index] = variable_t();
+	}
+	return frame;
+}
+
+int * frame_stack_t::push_arrays(size_t size)
+{
+	if (arrays_top + size > arrays_size)
+	{
+		raise_error("stack overflow");
+	}
+
+	int * area = arrays + arrays_top;
+	arrays_top += size;
+	return area;
+}
+
+// code_block_t
+
+void code_block_t::declare_variable(size_t index, variable_type type)
+{
+	variable_t & var = slots[index];
+	var.is_declared = true;
+	var.is_assigned = false;
+	var.value.type = type;
+}
+
+void code_block_t::declare_set_variable(size_t index, variant_t value)
+{
+	declare_variable(index, value.type);
+	store_variable(variable_slot_t{0, index}, value);
+}
+
+// program_t
+void program_t::add_method(method_t * method)
+{
+	auto it = methods.find(method->ID);
+	if (it != methods.end())
+	{
+		raise_error("method redeclaration: %s", method->ID.c_str());
+	}
+	methods.insert(std::make_pair(method->ID, method));
+}
+
+void program_t::set_name(const char * name)
+{
+	ID = name;
+}
+
+void program_t::run(runtime_t * runtime)
+{
+	if (main == NULL)
+	{
+		raise_error("main method not found");
+	}
+
+	current_runtime_t current(runtime);
+	frame_stack_t stack(STACK_SIZE, ARRAY_STACK_SIZE);
+	code_block_t class_block(NULL, runtime, &stack, stack.push(class_frame_size), class_frame_size);
+	fields_declaration->execute(&class_block);
+
+	code_block_t main_block(&class_block, runtime, &stack, stack.push(main->get_frame_size()), main->get_frame_size(), stack.push_arrays(main->get_array_area_size()));
+	main->run(&main_block);
+}
+
+void program_t::resolve()
+{
+	if (main == NULL)
+	{
+		raise_error("main method not found");
+	}
+
+	scope_t class_scope;
+	fields_declaration->resolve(&class_scope);
+	class_frame_size = class_scope.get_frame_size();
+
+	main->resolve(&class_scope);
+	for(auto it = methods.begin(); it != methods.end(); ++it)
+	{
+		it->second->resolve(&class_scope);
+	}
+}
+
+void program_t::typecheck()
+{
+	fields_declaration->typecheck();
+	main->typecheck();
+	for(auto it = methods.begin(); it != methods.end(); ++it)
+	{
+		it->second->typecheck();
+	}
+}
+
+void program_t::optimize()
+{
+	fields_declaration->optimize();
+	main->optimize();
+	for(auto it = methods.begin(); it != methods.end(); ++it)
+	{
+		it->second->optimize();
+	}
+}
+
+program_t::program_t()
+{
+	main = NULL;
+	class_frame_size = 0;
+	thread_pool = NULL;
+	fields_declaration = new statement_list_t;
+}
+
+void program_t::add_field_declaration(statement_t * stmt)
+{
+	fields_declaration->add(stmt);
+}
+
+// method_t
+
+method_t::method_t(const char * name, variable_type return_type, method_signature_t * args)
+{
+	this->return_type = return_type;
+	arguments = args;
+	ID = name;
+	frame_size = 0;
+	array_area_size = 0;
+	result_index = 0;
+	native_code = NULL;
+	memo_table = NULL;
+}
+
+void method_t::set_body(statement_list_t * body)
+{
+	this->body = body;
+	body->add(new return_statement_t(this));
+}
+
+variable_type method_t::get_return_type()
+{
+	return return_type;
+}
+
+size_t method_t::get_arguments_count()
+{
+	return arguments->size();
+}
+
+const char * method_t::get_id()
+{
+	return ID.c_str();
+}
+
+void method_t::resolve(scope_t * class_scope)
+{
+	scope_t method_scope(class_scope);
+	for(size_t index = 0; index < arguments->size(); ++index)
+	{
+		method_scope.declare_variable(arguments->get_at(index)->ID, vtInt);
+	}
+	result_index = method_scope.declare_variable(ID, vtInt);
+
+	body->resolve(&method_scope);
+	frame_size = method_scope.get_frame_size();
+	array_area_size = method_scope.get_array_area_size();
+}
+
+variant_t method_t::run(code_block_t * frame)
+{
+	frame->declare_variable(result_index, vtInt);
+
+	flow_interruption_type result = body->execute(frame);
+
+	if (return_type == vtNoType)
+	{
+		return variant_t();
+	}
+	else
+	{
+		return frame->get_variable(variable_slot_t{0, result_index}).value;
+	}
+}
+
+// the calls are bound by now, so the tail calls are known to every engine,
+// optimizing or not
+void method_t::typecheck()
+{
+	body->typecheck();
+	if (return_type != vtNoType)
+	{
+		tail_call_marker_t marker(this);
+		marker.mark();
+	}
+}
+
+// Runs the tail calls where they are made instead of below the frame, so
+// a chain of them needs one frame, however long
+variant_t method_t::run_tail_calls(code_block_t * frame)
+{
+	frame_stack_t * stack = frame->stack;
+	variant_t result;
+	while (frame->tail_method != NULL)
+	{
+		// the arguments are kept by the stack, not in the slots popped
+		method_t * method = frame->tail_method;
+		*frame = code_block_t(frame->parent, frame->runtime, stack, stack->push(method->get_frame_size()), method->get_frame_size(), stack->push_arrays(method->get_array_area_size()));
+		for(size_t index = 0; index < method->get_arguments_count(); ++index)
+		{
+			frame->declare_set_variable(index, stack->tail_arguments[index]);
+		}
+
+		result = method->run(frame);
+		stack->pop_arrays(method->get_array_area_size());
+		stack->pop(method->get_frame_size());
+	}
+	return result;
+}
+
+// the optimized body may have calls in tail position it did not have
+void method_t::optimize()
+{
+	body->optimize();
+	if (return_type != vtNoType)
+	{
+		tail_call_marker_t marker(this);
+		marker.mark();
+	}
+}
+
+// while_statement_t
+
+while_statement_t::while_statement_t(expression_t * condition, statement_t * body)
+{
+	this->condition = condition;
+	this->body = body;
+}
+
+flow_interruption_type while_statement_t::execute(code_block_t * block)
+{
+	flow_interruption_type result = fitNoIterruption;
+
+	do
+	{
+		// CYCLE goes on to the condition
+		result = body->execute(block);
+		if (result == fitBreak || result == fitReturn)
+		{
+			break;
+		}
+	} while(condition_true(block));
+
+	if (result == fitReturn)
+	{
+		return fitReturn;
+	}
+	else
+	{
+		return fitNoIterruption;
+	}
+}
+
+void while_statement_t::resolve(scope_t * scope)
+{
+	body->resolve(scope);
+	condition->resolve(scope);
+}
+
+void while_statement_t::typecheck()
+{
+	body->typecheck();
+	if (condition->typecheck() != vtBool)
+	{
+		raise_error_at(line, "expected boolean expression in while");
+	}
+}
+
+// do_statement_t
+
+do_statement_t::do_statement_t(const char * name, expression_t * first, expression_t * last, expression_t * step, statement_t * body)
+{
+	this->ID = name;
+	this->first = first;
+	this->last = last;
+	this->step = step;
+	this->body = body;
+}
+
+flow_interruption_type do_statement_t::execute(code_block_t * block)
+{
+	int value = first->eval_int(block);
+	int last_value = last->eval_int(block);
+	int step_value = step != NULL ? step->eval_int(block) : 1;
+
+	variable_t & var = block->get_variable(slot);
+	var.is_assigned = true;
+	var.value.int_value = value;
+
+	unsigned int remaining;
+	if (!do_loop_count(value, last_value, step_value, remaining))
+	{
+		return fitNoIterruption;
+	}
+
+	for(;;)
+	{
+		flow_interruption_type result = body->execute(block);
+		if (result == fitReturn)
+		{
+			return fitReturn;
+		}
+		if (result == fitBreak)
+		{
+			break;
+		}
+
+		value = (int)((unsigned int)value + (unsigned int)step_value);
+		var.value.int_value = value;
+		if (remaining-- == 0)
+		{
+			break;
+		}
+	}
+	return fitNoIterruption;
+}
+
+void do_statement_t::resolve(scope_t * scope)
+{
+	first->resolve(scope);
+	last->resolve(scope);
+	if (step != NULL)
+	{
+		step->resolve(scope);
+	}
+	if (!scope->find_variable(ID, slot, &type))
+	{
+		raise_error_at(line, "undeclared variable: %s", ID.c_str());
+	}
+	body->resolve(scope);
+}
+
+void do_statement_t::typecheck()
+{
+	if (type != vtInt)
+	{
+		raise_error_at(line, "DO variable %s must be int", ID.c_str());
+	}
+	if (first->typecheck() != vtInt || last->typecheck() != vtInt || (step != NULL && step->typecheck() != vtInt))
+	{
+		raise_error_at(line, "expected int bounds in DO");
+	}
+	body->typecheck();
+}
+
+statement_t * do_statement_t::optimize()
+{
+	first = first->optimize();
+	last = last->optimize();
+	if (step != NULL)
+	{
+		step = step->optimize();
+	}
+	body = body->optimize();
+	return this;
+}
+
+// do_concurrent_statement_t
+
+// stack of the chunks run by a pool thread, made with its first chunk and
+// freed when the thread ends
+static thread_local std::unique_ptr<frame_stack_t> pool_thread_stack;
+
+flow_interruption_type do_concurrent_statement_t::execute(code_block_t * block)
+{
+	int first_value = first->eval_int(block);
+	int last_value = last->eval_int(block);
+	int step_value = step != NULL ? step->eval_int(block) : 1;
+
+	unsigned int remaining;
+	if (!do_loop_count(first_value, last_value, step_value, remaining))
+	{
+		return fitNoIterruption;
+	}
+
+	unsigned long long count = (unsigned long long)remaining + 1;
+	size_t threads = clazz->get_thread_pool() != NULL ? clazz->get_thread_pool()->size() : 1;
+	size_t chunks_count = (size_t)std::min<unsigned long long>(count, threads * CONCURRENT_CHUNKS_PER_THREAD);
+	std::vector<std::string> outputs(chunks_count);
+	// set for the chunks that failed, written once the loop is over
+	std::vector<char> failed(chunks_count);
+	// an error of a chunk is always trapped, the pool hands it over to this
+	// thread, which writes the output before it and then fails as it would
+	bool trapping = error_trap_t::is_active();
+
+	chunk_function_t run_chunk = [&](size_t thread, size_t chunk)
+	{
+		frame_stack_t * stack = block->stack;
+		if (thread != 0)
+		{
+			if (pool_thread_stack == NULL)
+			{
+				pool_thread_stack.reset(new frame_stack_t(CONCURRENT_STACK_SIZE, ARRAY_STACK_SIZE));
+			}
+			stack = pool_thread_stack.get();
+		}
+		error_trap_t trap;
+
+		code_block_t frame = block->fork(stack);
+		variable_t & var = frame.get_variable(slot);
+		var.is_assigned = true;
+		// a loop nested in a chunk captures into the output of that chunk
+		output_capture_t capture(&outputs[chunk]);
+
+		unsigned long long end = (chunk + 1) * count / chunks_count;
+		try
+		{
+			for(unsigned long long index = chunk * count / chunks_count; index < end; ++index)
+			{
+				var.value.int_value = (int)((unsigned int)first_value + (unsigned int)index * (unsigned int)step_value);
+				body->execute(&frame);
+			}
+		}
+		catch (...)
+		{
+			// calls left frames behind, a pool thread starts over on a fresh
+			// stack
+			if (thread != 0)
+			{
+				pool_thread_stack.reset();
+			}
+			failed[chunk] = true;
+			throw;
+		}
+
+		stack->pop(frame.get_size());
+	};
+
+	try
+	{
+		if (clazz->get_thread_pool() != NULL)
+		{
+			clazz->get_thread_pool()->run(chunks_count, run_chunk);
+		}
+		else
+		{
+			for(size_t chunk = 0; chunk < chunks_count; ++chunk)
+			{
+				run_chunk(0, chunk);
+			}
+		}
+	}
+	catch (const fortran_error_t & error)
+	{
+		// a sequential run would have written the chunks before the first
+		// failed one and that one up to the error
+		for(size_t chunk = 0; chunk < chunks_count; ++chunk)
+		{
+			block->runtime->output.write_captured(outputs[chunk]);
+			if (failed[chunk])
+			{
+				break;
+			}
+		}
+		if (trapping)
+		{
+			throw;
+		}
+		raise_error("%s", error.what());
+	}
+
+	for(size_t chunk = 0; chunk < chunks_count; ++chunk)
+	{
+		block->runtime->output.write_captured(outputs[chunk]);
+	}
+	return fitNoIterruption;
+}
+
+void do_concurrent_statement_t::typecheck()
+{
+	do_statement_t::typecheck();
+	concurrent_body_checker_t checker;
+	body->accept(&checker);
+}
+
+// statement_list_t
+statement_list_t::statement_list_t()
+{
+}
+
+// return_statement_t
+flow_interruption_type return_statement_t::execute(code_block_t * block)
+{
+	return fitReturn;
+}
+
+// code_block_statement_t
+
+code_block_statement_t::code_block_statement_t(statement_list_t * body)
+{
+	this->body = body;
+}
+
+flow_interruption_type code_block_statement_t::execute(code_block_t * block)
+{
+	return body->execute(block);
+}
+
+void code_block_statement_t::resolve(scope_t * scope)
+{
+	scope_t block_scope(scope, false);
+	body->resolve(&block_scope);
+}
+
+// variable_expression_t 
+
+variant_t variable_expression_t::eval(code_block_t * block)
+{
+	variable_t & var = block->get_variable(slot);
+	if (!var.is_assigned)
+	{
+		raise_error("'%s': using uninitialized variable", ID.c_str());
+	}
+	return var.value;
+}
+
+int variable_expression_t::eval_int(code_block_t * block)
+{
+	variable_t & var = block->get_variable(slot);
+	if (!var.is_assigned)
+	{
+		raise_error("'%s': using uninitialized variable", ID.c_str());
+	}
+	return var.value.int_value;
+}
+
+void variable_expression_t::resolve(scope_t * scope)
+{
+	if (!scope->find_variable(ID, slot, &type, &size))
+	{
+		raise_error_at(line, "undeclared variable: %s", ID.c_str());
+	}
+}
+
+void variable_expression_t::eval_array(code_block_t * block, int * dst, size_t size)
+{
+	if (this->size == 0)
+	{
+		expression_t::eval_array(block, dst, size);
+		return;
+	}
+
+	const int * data = block->get_array(slot);
+	if (data != dst)
+	{
+		memcpy(dst, data, size * sizeof(int));
+	}
+}
+
+// expression_t
+
+void expression_t::eval_array(code_block_t * block, int * dst, size_t size)
+{
+	array_fill(dst, eval_int(block), size);
+}
+
+// assignment_t
+
+// the elements of the target can be overwritten while the value is computed
+// only if every element is read before the one stored at its index
+static bool is_direct_array_value(expression_t * value)
+{
+	binary_expression_t * binary = dynamic_cast<binary_expression_t *>(value);
+	if (binary == NULL)
+	{
+		return value->get_array_size() == 0 || dynamic_cast<variable_expression_t *>(value) != NULL;
+	}
+
+	expression_t * left = binary->get_left();
+	expression_t * right = binary->get_right();
+	return (left->get_array_size() == 0 || dynamic_cast<variable_expression_t *>(left) != NULL)
+		&& (right->get_array_size() == 0 || dynamic_cast<variable_expression_t *>(right) != NULL);
+}
+
+void assignment_t::assign_array(code_block_t * block)
+{
+	int * dst = block->get_array(slot);
+	if (is_direct_array_value(value))
+	{
+		value->eval_array(block, dst, size);
+		return;
+	}
+
+	frame_stack_t * stack = block->stack;
+	size_t area_size = array_storage_size(size);
+	int * scratch = stack->push_arrays(area_size);
+	value->eval_array(block, scratch, size);
+	memcpy(dst, scratch, size * sizeof(int));
+	stack->pop_arrays(area_size);
+}
+
+void assignment_t::resolve(scope_t * scope)
+{
+	value->resolve(scope);
+	if (!scope->find_variable(ID, slot, &type, &size))
+	{
+		raise_error_at(line, "assignment to undeclared variable: %s", ID.c_str());
+	}
+}
+
+// an array takes an array of its size or an int stored to every element
+void assignment_t::typecheck()
+{
+	variable_type value_type = value->typecheck();
+	if (type == vtArray && value_type == vtInt)
+	{
+		return;
+	}
+	if (value_type != type)
+	{
+		raise_error_at(line, "conversion error: can't convert %s to %s", to_string(value_type), to_string(type));
+	}
+	if (type == vtArray && value->get_array_size() != size)
+	{
+		raise_error_at(line, "can't assign an array of %d elements to %s of %d", (int)value->get_array_size(), ID.c_str(), (int)size);
+	}
+}
+
+// conditional_statement_t
+
+conditional_statement_t::conditional_statement_t(expression_t * condition, statement_t * true_way, statement_t * false_way)
+{
+	this->true_way = true_way;
+	this->false_way = false_way;
+	this->condition = condition;
+}
+
+flow_interruption_type conditional_statement_t::execute(code_block_t * block)
+{
+	flow_interruption_type result = fitNoIterruption;
+
+	if (condition->eval_bool(block))
+	{
+		result = true_way->execute(block);
+	}
+	else
+	{
+		if (false_way != NULL)
+		{
+			result = false_way->execute(block);
+		}
+	}
+	return result;
+}
+
+void conditional_statement_t::resolve(scope_t * scope)
+{
+	condition->resolve(scope);
+	true_way->resolve(scope);
+	if (false_way != NULL)
+	{
+		false_way->resolve(scope);
+	}
+}
+
+void conditional_statement_t::typecheck()
+{
+	if (condition->typecheck() != vtBool)
+	{
+		raise_error_at(line, "expected boolean expression in if");
+	}
+	true_way->typecheck();
+	if (false_way != NULL)
+	{
+		false_way->typecheck();
+	}
+}
+
+statement_t * conditional_statement_t::optimize()
+{
+	condition = condition->optimize();
+	true_way = true_way->optimize();
+	if (false_way != NULL)
+	{
+		false_way = false_way->optimize();
+	}
+
+	constant_t * constant = dynamic_cast<constant_t *>(condition);
+	if (constant == NULL || constant->get_value().type != vtBool)
+	{
+		return this;
+	}
+
+	if (constant->get_value().bool_value)
+	{
+		return true_way;
+	}
+	if (false_way != NULL)
+	{
+		return false_way;
+	}
+	return new statement_list_t();
+}
+
+// optimization helpers
+
+static bool is_constant(expression_t * expr, variable_type type)
+{
+	constant_t * constant = dynamic_cast<constant_t *>(expr);
+	return constant != NULL && constant->get_value().type == type;
+}
+
+static bool is_int_constant(expression_t * expr, int value)
+{
+	return is_constant(expr, vtInt) && ((constant_t *)expr)->get_value().int_value == value;
+}
+
+// an expression can replace an arithmetic node only if it yields an int too
+static bool is_int_expression(expression_t * expr)
+{
+	if (dynamic_cast<variable_expression_t *>(expr) != NULL || dynamic_cast<invocation_expression_t *>(expr) != NULL
+		|| dynamic_cast<element_expression_t *>(expr) != NULL || dynamic_cast<reduction_expression_t *>(expr) != NULL)
+	{
+		return true;
+	}
+
+	binary_expression_t * binary = dynamic_cast<binary_expression_t *>(expr);
+	if (binary != NULL)
+	{
+		operation type = binary->get_operation();
+		return type == opAdd || type == opSub || type == opMul || type == opDiv || type == opMod;
+	}
+	return is_constant(expr, vtInt);
+}
+
+// dropping an expression must not drop the error it would raise
+static bool cannot_fail(expression_t * expr)
+{
+	variable_expression_t * variable = dynamic_cast<variable_expression_t *>(expr);
+	if (variable != NULL)
+	{
+		return variable->get_array_size() == 0 && variable->is_defined();
+	}
+	return is_constant(expr, vtInt);
+}
+
+static bool is_bool_expression(expression_t * expr)
+{
+	if (dynamic_cast<short_circuit_expression_t *>(expr) != NULL)
+	{
+		return true;
+	}
+
+	binary_expression_t * binary = dynamic_cast<binary_expression_t *>(expr);
+	if (binary != NULL)
+	{
+		return !is_int_expression(binary);
+	}
+	return is_constant(expr, vtBool);
+}
+
+static constant_t * make_constant(int value)
+{
+	variant_t result;
+	result.type = vtInt;
+	result.int_value = value;
+	return new constant_t(result);
+}
+
+static constant_t * make_constant(bool value)
+{
+	variant_t result;
+	result.type = vtBool;
+	result.bool_value = value;
+	return new constant_t(result);
+}
+
+// binary_node_t
+
+// Operands of a specialized binary node: a scalar of the frame itself and
+// a constant are read in place, anything else is asked for its int
+struct frame_operand_t
+{
+	variable_expression_t * node;
+	size_t index;
+
+	frame_operand_t(expression_t * node)
+	{
+		this->node = (variable_expression_t *)node;
+		index = this->node->get_slot().index;
+	}
+
+	int get(code_block_t * block)
+	{
+		variable_t & var = block->get_local(index);
+		if (!var.is_assigned)
+		{
+			raise_error("'%s': using uninitialized variable", node->get_id().c_str());
+		}
+		return var.value.int_value;
+	}
+};
+
+struct literal_operand_t
+{
+	int value;
+
+	literal_operand_t(expression_t * node)
+	{
+		value = ((constant_t *)node)->get_value().int_value;
+	}
+
+	int get(code_block_t * block)
+	{
+		return value;
+	}
+};
+
+struct node_operand_t
+{
+	expression_t * node;
+
+	node_operand_t(expression_t * node)
+	{
+		this->node = node;
+	}
+
+	int get(code_block_t * block)
+	{
+		return node->eval_int(block);
+	}
+};
+
+// Operation of int operands made by the optimization pass for the operator
+// and the kinds of its operands, so it neither switches on the operation
+// nor goes through variants to evaluate. To the passes that walk the tree
+// it is still a binary_expression_t.
+template<class operator_t, variable_type result_type, class left_t, class right_t>
+class binary_node_t : public binary_expression_t
+{
+private:
+	left_t left;
+	right_t right;
+
+public:
+	binary_node_t(binary_expression_t * node)
+		: binary_expression_t(node->get_operation(), node->get_left(), node->get_right()), left(node->get_left()), right(node->get_right())
+	{
+		set_line(node->get_line());
+	}
+
+	variant_t eval(code_block_t * block)
+	{
+		variant_t result;
+		result.type = result_type;
+		if (result_type == vtInt)
+		{
+			result.int_value = eval_int(block);
+		}
+		else
+		{
+			result.bool_value = eval_bool(block);
+		}
+		return result;
+	}
+
+	int eval_int(code_block_t * block)
+	{
+		int value1 = left.get(block);
+		int value2 = right.get(block);
+		operator_t::check(value1, value2, line);
+		return operator_t::apply(value1, value2);
+	}
+
+	bool eval_bool(code_block_t * block)
+	{
+		return eval_int(block) != 0;
+	}
+
+	// the operands are read again, their slots may have moved
+	void resolve(scope_t * scope)
+	{
+		binary_expression_t::resolve(scope);
+		left = left_t(get_left());
+		right = right_t(get_right());
+	}
+
+	// optimized already
+	expression_t * optimize()
+	{
+		if (get_replacement() != NULL)
+		{
+			return get_replacement()->optimize();
+		}
+		return this;
+	}
+};
+
+static bool is_frame_scalar(expression_t * expr)
+{
+	variable_expression_t * variable = dynamic_cast<variable_expression_t *>(expr);
+	return variable != NULL && variable->get_slot().depth == 0 && variable->get_array_size() == 0 && variable->typecheck() == vtInt;
+}
+
+template<class operator_t, variable_type type, class left_t>
+static expression_t * specialize_binary(binary_expression_t * node)
+{
+	expression_t * right = node->get_right();
+	if (is_frame_scalar(right))
+	{
+		return new binary_node_t<operator_t, type, left_t, frame_operand_t>(node);
+	}
+	if (is_constant(right, vtInt))
+	{
+		return new binary_node_t<operator_t, type, left_t, literal_operand_t>(node);
+	}
+	return new binary_node_t<operator_t, type, left_t, node_operand_t>(node);
+}
+
+template<class operator_t, variable_type type>
+static expression_t * specialize_binary(binary_expression_t * node)
+{
+	expression_t * left = node->get_left();
+	if (is_frame_scalar(left))
+	{
+		return specialize_binary<operator_t, type, frame_operand_t>(node);
+	}
+	if (is_constant(left, vtInt))
+	{
+		return specialize_binary<operator_t, type, literal_operand_t>(node);
+	}
+	return specialize_binary<operator_t, type, node_operand_t>(node);
+}
+
+// the operands have to be scalar ints
+static expression_t * specialize_binary(binary_expression_t * node)
+{
+	switch (node->get_operation())
+	{
+	case opAdd:
+		return specialize_binary<add_operator_t, vtInt>(node);
+	case opSub:
+		return specialize_binary<sub_operator_t, vtInt>(node);
+	case opMul:
+		return specialize_binary<mul_operator_t, vtInt>(node);
+	case opDiv:
+		return specialize_binary<div_operator_t, vtInt>(node);
+	case opMod:
+		return specialize_binary<mod_operator_t, vtInt>(node);
+	case opEquals:
+		return specialize_binary<equals_operator_t, vtBool>(node);
+	case opNotEquals:
+		return specialize_binary<not_equals_operator_t, vtBool>(node);
+	case opLesser:
+		return specialize_binary<lesser_operator_t, vtBool>(node);
+	case opGreater:
+		return specialize_binary<greater_operator_t, vtBool>(node);
+	case opLesserEquals:
+		return specialize_binary<lesser_equals_operator_t, vtBool>(node);
+	case opGreaterEquals:
+		return specialize_binary<greater_equals_operator_t, vtBool>(node);
+	default:
+		return node;
+	}
+}
+
+// binary_expression_t
+
+expression_t * binary_expression_t::optimize()
+{
+	if (replacement != NULL)
+	{
+		return replacement->optimize();
+	}
+
+	arg1 = arg1->optimize();
+	arg2 = arg2->optimize();
+
+	if (type == opAnd || type == opOr)
+	{
+		return (new short_circuit_expression_t(type, arg1, arg2))->optimize();
+	}
+
+	bool left_constant = dynamic_cast<constant_t *>(arg1) != NULL;
+	bool right_constant = dynamic_cast<constant_t *>(arg2) != NULL;
+	if (left_constant && right_constant)
+	{
+		// x / 0 and INT_MIN / -1 are left to fail at run time
+		if ((type == opDiv || type == opMod) && (is_int_constant(arg2, 0) || is_int_constant(arg2, -1)))
+		{
+			return this;
+		}
+		return new constant_t(eval(NULL));
+	}
+
+	switch (type)
+	{
+	case opAdd:
+		if (is_int_constant(arg2, 0) && is_int_expression(arg1))
+		{
+			return arg1;
+		}
+		if (is_int_constant(arg1, 0) && is_int_expression(arg2))
+		{
+			return arg2;
+		}
+		break;
+	case opSub:
+		if (is_int_constant(arg2, 0) && is_int_expression(arg1))
+		{
+			return arg1;
+		}
+		break;
+	case opMul:
+		if (is_int_constant(arg2, 1) && is_int_expression(arg1))
+		{
+			return arg1;
+		}
+		if (is_int_constant(arg1, 1) && is_int_expression(arg2))
+		{
+			return arg2;
+		}
+		if ((is_int_constant(arg2, 0) && cannot_fail(arg1)) || (is_int_constant(arg1, 0) && cannot_fail(arg2)))
+		{
+			return make_constant(0);
+		}
+		break;
+	case opDiv:
+		if (is_int_constant(arg2, 1) && is_int_expression(arg1))
+		{
+			return arg1;
+		}
+		break;
+	default:
+		break;
+	}
+
+	// (x + c1) - c2 and the like become x + c
+	binary_expression_t * inner = dynamic_cast<binary_expression_t *>(arg1);
+	if ((type == opAdd || type == opSub) && is_constant(arg2, vtInt) && inner != NULL
+		&& (inner->type == opAdd || inner->type == opSub) && is_constant(inner->arg2, vtInt))
+	{
+		unsigned int inner_value = ((constant_t *)inner->arg2)->get_value().int_value;
+		unsigned int outer_value = ((constant_t *)arg2)->get_value().int_value;
+		unsigned int offset = (inner->type == opAdd ? inner_value : -inner_value) + (type == opAdd ? outer_value : -outer_value);
+		return (new binary_expression_t(opAdd, inner->arg1, make_constant((int)offset)))->optimize();
+	}
+
+	if (get_array_size() == 0 && is_int_expression(arg1) && is_int_expression(arg2))
+	{
+		return specialize_binary(this);
+	}
+	return this;
+}
+
+variant_t binary_expression_t::eval(code_block_t * block)
+{
+	variant_t value1 = arg1->eval(block);
+	variant_t value2 = arg2->eval(block);
+
+	variant_t result;
+	switch (type)
+	{
+	case opAdd:
+		result.type = vtInt;
+		result.int_value = value1.int_value + value2.int_value;
+		break;
+	case opSub:
+		result.type = vtInt;
+		result.int_value = value1.int_value - value2.int_value;
+		break;
+	case opMul:
+		result.type = vtInt;
+		result.int_value = value1.int_value * value2.int_value;
+		break;
+	case opDiv:
+		result.type = vtInt;
+		check_division(value1.int_value, value2.int_value, line);
+		result.int_value = value1.int_value / value2.int_value;
+		break;
+	case opMod:
+		result.type = vtInt;
+		check_division(value1.int_value, value2.int_value, line);
+		result.int_value = value1.int_value % value2.int_value;
+		break;
+	case opAnd:
+		result.type = vtBool;
+		result.bool_value = value1.bool_value && value2.bool_value;
+		break;
+	case opOr:
+		result.type = vtBool;
+		result.bool_value = value1.bool_value || value2.bool_value;
+		break;
+	case opEquals:
+		result.type = vtBool;
+		result.bool_value = variant_equals(value1, value2);
+		break;
+	case opNotEquals:
+		result.type = vtBool;
+		result.bool_value = !variant_equals(value1, value2);
+		break;
+	case opLesser:
+		result.type = vtBool;
+		result.bool_value = value1.int_value < value2.int_value;
+		break;
+	case opGreater:
+		result.type = vtBool;
+		result.bool_value = value1.int_value > value2.int_value;
+		break;
+	case opLesserEquals:
+		result.type = vtBool;
+		result.bool_value = value1.int_value <= value2.int_value;
+		break;
+	case opGreaterEquals:
+		result.type = vtBool;
+		result.bool_value = value1.int_value >= value2.int_value;
+		break;
+	default:
+		break;
+	}
+	return result;
+}
+
+variable_type binary_expression_t::typecheck()
+{
+	variable_type type1 = arg1->typecheck();
+	variable_type type2 = arg2->typecheck();
+
+	switch (type)
+	{
+	case opEquals:
+	case opNotEquals:
+		if (type1 != type2 || type1 == vtArray)
+		{
+			raise_error_at(line, "can't compare %s with %s", to_string(type1), to_string(type2));
+		}
+		return vtBool;
+	case opAnd:
+	case opOr:
+		if (type1 != vtBool || type2 != vtBool)
+		{
+			raise_error_at(line, "'%s' expects boolean operands", to_string(type));
+		}
+		return vtBool;
+	case opLesser:
+	case opGreater:
+	case opLesserEquals:
+	case opGreaterEquals:
+		if (type1 != vtInt || type2 != vtInt)
+		{
+			raise_error_at(line, "'%s' expects int operands", to_string(type));
+		}
+		return vtBool;
+	default:
+		if ((type1 != vtInt && type1 != vtArray) || (type2 != vtInt && type2 != vtArray))
+		{
+			raise_error_at(line, "'%s' expects int operands", to_string(type));
+		}
+		if (type1 == vtInt && type2 == vtInt)
+		{
+			return vtInt;
+		}
+
+		// an int operand is applied to every element
+		if (type1 == vtArray && type2 == vtArray && arg1->get_array_size() != arg2->get_array_size())
+		{
+			raise_error_at(line, "'%s': arrays of %d and %d elements", to_string(type), (int)arg1->get_array_size(), (int)arg2->get_array_size());
+		}
+		return vtArray;
+	}
+}
+
+// operands that are computed get storage of their own, except the first one
+// which is computed in place in dst
+void binary_expression_t::eval_array(code_block_t * block, int * dst, size_t size)
+{
+	if (arg1->get_array_size() == 0 && arg2->get_array_size() == 0)
+	{
+		expression_t::eval_array(block, dst, size);
+		return;
+	}
+
+	const int * a = NULL;
+	int value1 = 0;
+	if (arg1->get_array_size() != 0)
+	{
+		a = arg1->get_array_data(block);
+		if (a == NULL)
+		{
+			arg1->eval_array(block, dst, size);
+			a = dst;
+		}
+	}
+	else
+	{
+		value1 = arg1->eval_int(block);
+	}
+
+	const int * b = NULL;
+	int value2 = 0;
+	int * scratch = NULL;
+	size_t scratch_size = 0;
+	if (arg2->get_array_size() != 0)
+	{
+		b = arg2->get_array_data(block);
+		if (b == NULL)
+		{
+			scratch_size = array_storage_size(size);
+			scratch = block->stack->push_arrays(scratch_size);
+			arg2->eval_array(block, scratch, size);
+			b = scratch;
+		}
+	}
+	else
+	{
+		value2 = arg2->eval_int(block);
+	}
+
+	if (a != NULL && b != NULL)
+	{
+		array_binary(type, dst, a, b, size, line);
+	}
+	else if (a != NULL)
+	{
+		array_binary(type, dst, a, value2, size, line);
+	}
+	else
+	{
+		array_binary(type, dst, value1, b, size, line);
+	}
+
+	if (scratch != NULL)
+	{
+		block->stack->pop_arrays(scratch_size);
+	}
+}
+
+// short_circuit_expression_t
+
+expression_t * short_circuit_expression_t::optimize()
+{
+	arg1 = arg1->optimize();
+	arg2 = arg2->optimize();
+
+	// the value that decides the result on its own
+	bool decisive = type == opOr;
+
+	if (is_constant(arg1, vtBool))
+	{
+		if (((constant_t *)arg1)->get_value().bool_value == decisive)
+		{
+			return make_constant(decisive);
+		}
+		if (is_bool_expression(arg2))
+		{
+			return arg2;
+		}
+	}
+
+	if (is_constant(arg2, vtBool) && is_bool_expression(arg1))
+	{
+		if (((constant_t *)arg2)->get_value().bool_value != decisive)
+		{
+			return arg1;
+		}
+		if (!arg1->has_side_effects())
+		{
+			return make_constant(decisive);
+		}
+	}
+
+	return this;
+}
+
+// invokation_expression_t
+variant_t invocation_expression_t::eval(code_block_t * block)
+{
+	check_native_stack();
+
+	// the tables are not shared between threads, chunks of DO CONCURRENT
+	// call the method itself
+	memo_table_t * memo_table = method->get_memo_table();
+	if (memo_table != NULL && !thread_pool_t::is_inside_task())
+	{
+		return eval_memoized(block, method, memo_table);
+	}
+
+	// native code beats an inlined body run by the tree walker
+	native_function_t native_code = method->get_native_code();
+	if (native_code != NULL)
+	{
+		int args[JIT_MAX_ARGUMENTS];
+		for(size_t index = 0; index < params->size(); ++index)
+		{
+			args[index] = params->get_at(index)->eval_int(block);
+		}
+
+		variant_t result;
+		result.type = vtInt;
+		result.int_value = jit_call(native_code, args);
+		return result;
+	}
+
+	if (inline_body != NULL)
+	{
+		return eval_inline(block);
+	}
+
+	// the caller's frame is done once the arguments are in, run_tail_calls
+	// replaces it by the callee's; the value stored meanwhile is not read
+	if (tail_call)
+	{
+		// calls among the arguments may make tail calls of their own
+		variant_t args[TAIL_CALL_MAX_ARGUMENTS];
+		for(size_t index = 0; index < params->size(); ++index)
+		{
+			args[index] = params->get_at(index)->eval(block);
+		}
+		std::copy(args, args + params->size(), block->stack->tail_arguments);
+		block->tail_method = method;
+
+		variant_t result;
+		result.type = method->get_return_type();
+		result.int_value = 0;
+		return result;
+	}
+
+	// arguments are evaluated in the caller's frame, nested calls push and
+	// pop their frames above the one being filled
+	frame_stack_t * stack = block->stack;
+	code_block_t frame(block->get_root(), block->runtime, stack, stack->push(method->get_frame_size()), method->get_frame_size(), stack->push_arrays(method->get_array_area_size()));
+	for(size_t index = 0; index < params->size(); ++index)
+	{
+		frame.declare_set_variable(index, params->get_at(index)->eval(block));
+	}
+
+	variant_t result = method->run(&frame);
+	stack->pop_arrays(method->get_array_area_size());
+	stack->pop(method->get_frame_size());
+	if (frame.tail_method != NULL)
+	{
+		result = method_t::run_tail_calls(&frame);
+	}
+	return result;
+}
+
+size_t invocation_expression_t::get_inline_result_index()
+{
+	return inline_arguments_index + params->size();
+}
+
+// runs the copy of the body as method_t::run runs the body, the arguments
+// are evaluated in the caller's frame and stored as they come
+variant_t invocation_expression_t::eval_inline(code_block_t * block)
+{
+	for(size_t index = 0; index < params->size(); ++index)
+	{
+		block->declare_set_variable(inline_arguments_index + index, params->get_at(index)->eval(block));
+	}
+
+	// RETURN ends the copy only
+	size_t result_index = get_inline_result_index();
+	block->declare_variable(result_index, vtInt);
+	inline_body->execute(block);
+
+	if (method->get_return_type() == vtNoType)
+	{
+		return variant_t();
+	}
+	return block->get_variable(variable_slot_t{0, result_index}).value;
+}
+
+// the arguments are needed as the key before the frame is set up, a miss
+// runs the method with them and keeps the result
+variant_t invocation_expression_t::eval_memoized(code_block_t * block, method_t * method, memo_table_t * memo_table)
+{
+	int args[MEMO_MAX_ARGUMENTS];
+	for(size_t index = 0; index < params->size(); ++index)
+	{
+		args[index] = params->get_at(index)->eval_int(block);
+	}
+
+	variant_t result;
+	result.type = vtInt;
+	if (memo_table->find(args, result.int_value))
+	{
+		return result;
+	}
+
+	// a miss of a tail call is run in place of the caller as in eval, the
+	// result is kept for the call the chain started with
+	if (tail_call)
+	{
+		for(size_t index = 0; index < params->size(); ++index)
+		{
+			block->stack->tail_arguments[index].type = vtInt;
+			block->stack->tail_arguments[index].int_value = args[index];
+		}
+		block->tail_method = method;
+		result.int_value = 0;
+		return result;
+	}
+
+	frame_stack_t * stack = block->stack;
+	code_block_t frame(block->get_root(), block->runtime, stack, stack->push(method->get_frame_size()), method->get_frame_size(), stack->push_arrays(method->get_array_area_size()));
+	for(size_t index = 0; index < params->size(); ++index)
+	{
+		variant_t value;
+		value.type = vtInt;
+		value.int_value = args[index];
+		frame.declare_set_variable(index, value);
+	}
+
+	result = method->run(&frame);
+	stack->pop_arrays(method->get_array_area_size());
+	stack->pop(method->get_frame_size());
+	if (frame.tail_method != NULL)
+	{
+		result = method_t::run_tail_calls(&frame);
+	}
+	memo_table->store(args, result.int_value);
+	return result;
+}
+
+// An inlined body lives in the caller's frame, in slots of its own, and
+// sees the fields as the method does
+void invocation_expression_t::resolve(scope_t * scope)
+{
+	params->resolve(scope);
+	if (inline_body == NULL)
+	{
+		return;
+	}
+
+	// laid out as method_t::resolve does; a copy made by the inliner is not
+	// bound yet, the method is known to exist
+	method_t * callee = clazz->get_method(method_id);
+	scope_t body_scope(scope, false, true);
+	method_signature_t * arguments = callee->get_arguments();
+	for(size_t index = 0; index < arguments->size(); ++index)
+	{
+		body_scope.declare_variable(arguments->get_at(index)->get_id(), vtInt);
+	}
+	inline_arguments_index = body_scope.declare_variable(callee->ID, vtInt) - arguments->size();
+	inline_body->resolve(&body_scope);
+}
+
+// Binds the call to its method, so neither the run nor the engines look it
+// up by name. Every argument and every result is int, a subroutine yields 0.
+variable_type invocation_expression_t::typecheck()
+{
+	method = clazz->get_method(method_id);
+	if (method == NULL)
+	{
+		raise_error_at(line, "'%s': method not found", method_id.c_str());
+	}
+
+	if (params->size() < method->get_arguments_count())
+	{
+		raise_error_at(line, "'%s': too few arguments", method_id.c_str());
+	}
+	if (params->size() > method->get_arguments_count())
+	{
+		raise_error_at(line, "'%s': too many arguments", method_id.c_str());
+	}
+
+	for(size_t index = 0; index < params->size(); ++index)
+	{
+		variable_type type = params->get_at(index)->typecheck();
+		if (type != vtInt)
+		{
+			raise_error_at(line, "'%s': can't pass %s as argument %d", method_id.c_str(), to_string(type), (int)index + 1);
+		}
+	}
+
+	if (inline_body != NULL)
+	{
+		inline_body->typecheck();
+	}
+	return vtInt;
+}
+
+expression_t * invocation_expression_t::optimize()
+{
+	params->optimize();
+	if (inline_body != NULL)
+	{
+		inline_body->optimize();
+	}
+	return this;
+}
+
+// array_declaration_t
+
+void array_declaration_t::resolve(scope_t * scope)
+{
+	if (size == 0)
+	{
+		raise_error_at(line, "%s: array size must be positive", ID.c_str());
+	}
+	index = scope->declare_array(ID, size, line);
+}
+
+// element_expression_t
+
+variant_t element_expression_t::eval(code_block_t * block)
+{
+	variant_t result;
+	result.type = vtInt;
+	result.int_value = eval_int(block);
+	return result;
+}
+
+int element_expression_t::eval_int(code_block_t * block)
+{
+	int position = index->eval_int(block);
+	if (position < 1 || (size_t)position > size)
+	{
+		raise_error_at(line, "index %d is out of bounds of %s", position, ID.c_str());
+	}
+	return block->get_array(slot)[position - 1];
+}
+
+void element_expression_t::resolve(scope_t * scope)
+{
+	index->resolve(scope);
+	if (!scope->find_variable(ID, slot, &type, &size))
+	{
+		raise_error_at(line, "undeclared variable: %s", ID.c_str());
+	}
+}
+
+variable_type element_expression_t::typecheck()
+{
+	if (type != vtArray)
+	{
+		raise_error_at(line, "%s is not an array", ID.c_str());
+	}
+	if (index->typecheck() != vtInt)
+	{
+		raise_error_at(line, "index of %s must be int", ID.c_str());
+	}
+	return vtInt;
+}
+
+// element_assignment_t
+
+flow_interruption_type element_assignment_t::execute(code_block_t * block)
+{
+	int position = index->eval_int(block);
+	if (position < 1 || (size_t)position > size)
+	{
+		raise_error_at(line, "index %d is out of bounds of %s", position, ID.c_str());
+	}
+
+	int element = value->eval_int(block);
+	block->get_array(slot)[position - 1] = element;
+	return fitNoIterruption;
+}
+
+void element_assignment_t::resolve(scope_t * scope)
+{
+	index->resolve(scope);
+	value->resolve(scope);
+	if (!scope->find_variable(ID, slot, &type, &size))
+	{
+		raise_error_at(line, "assignment to undeclared variable: %s", ID.c_str());
+	}
+}
+
+void element_assignment_t::typecheck()
+{
+	if (type != vtArray)
+	{
+		raise_error_at(line, "%s is not an array", ID.c_str());
+	}
+	if (index->typecheck() != vtInt)
+	{
+		raise_error_at(line, "index of %s must be int", ID.c_str());
+	}
+
+	variable_type value_type = value->typecheck();
+	if (value_type != vtInt)
+	{
+		raise_error_at(line, "conversion error: can't convert %s to int", to_string(value_type));
+	}
+}
+
+// reduction_expression_t
+
+variant_t reduction_expression_t::eval(code_block_t * block)
+{
+	frame_stack_t * stack = block->stack;
+	size_t area_size = 0;
+	const int * data = arg->get_array_data(block);
+	if (data == NULL)
+	{
+		area_size = array_storage_size(size);
+		int * scratch = stack->push_arrays(area_size);
+		arg->eval_array(block, scratch, size);
+		data = scratch;
+	}
+
+	variant_t result;
+	result.type = vtInt;
+	result.int_value = type == rtSum ? array_sum(data, size) : array_maxval(data, size);
+	stack->pop_arrays(area_size);
+	return result;
+}
+
+variable_type reduction_expression_t::typecheck()
+{
+	if (arg->typecheck() != vtArray)
+	{
+		raise_error_at(line, "%s expects an array", type == rtSum ? "SUM" : "MAXVAL");
+	}
+	size = arg->get_array_size();
+	return vtInt;
+}
+
+// break_statement_t 
+
+flow_interruption_type break_statement_t::execute(code_block_t * block)
+{
+	return fitBreak;
+}
+
+// cycle_statement_t
+
+flow_interruption_type cycle_statement_t::execute(code_block_t * block)
+{
+	return fitCycle;
+}
+
+// invoke_statement_t
+
+invoke_statement_t::invoke_statement_t(expression_t * invokee)
+{
+	this->invokee = invokee;
+}
+
+flow_interruption_type invoke_statement_t::execute(code_block_t * block)
+{
+	invokee->eval(block);
+	return fitNoIterruption;
+}
+
+// read_statement_t
+
+flow_interruption_type read_statement_t::execute(code_block_t * block)
+{
+	// input can't be shared by the chunks of DO CONCURRENT, this catches a
+	// READ in a method called from one
+	if (thread_pool_t::is_inside_task())
+	{
+		raise_error_at(line, "READ is not allowed in DO CONCURRENT");
+	}
+
+	runtime_t * runtime = block->runtime;
+	runtime->output.flush_for_input();
+	for(size_t index = 0; index < args->size(); ++index)
+	{
+		variant_t value;
+		value.type = vtInt;
+		value.int_value = runtime->input.read_int();
+		block->store_variable(args->get_at(index), value);
+	}
+	return fitNoIterruption;
+}
+
+// read_arguments_t
+
+void read_arguments_t::resolve(scope_t * scope)
+{
+	slots.resize(params.size());
+	types.resize(params.size());
+	for(size_t index = 0; index < params.size(); ++index)
+	{
+		if (!scope->find_variable(params[index], slots[index], &types[index]))
+		{
+			raise_error("assignment to undeclared variable: %s", params[index].c_str());
+		}
+	}
+}
+
+void read_arguments_t::typecheck(int line)
+{
+	for(size_t index = 0; index < params.size(); ++index)
+	{
+		if (types[index] != vtInt)
+		{
+			raise_error_at(line, "can't read %s into %s", to_string(types[index]), params[index].c_str());
+		}
+	}
+}
+
+// write_arguments_t
+
+// values are formatted into the caller's buffer, messages are returned as is
+const char * write_arguments_t::get_at(size_t index, code_block_t * block, char * buffer)
+{
+	if (order[index] == 0)
+	{
+		variant_t result = get_expression(index)->eval(block);
+		return to_string(result, buffer);
+	}
+	else
+	{
+		return get_message(index).c_str();
+	}
+}
+
+void write_arguments_t::resolve(scope_t * scope)
+{
+	for(auto it = exprs.begin(); it != exprs.end(); ++it)
+	{
+		(*it)->resolve(scope);
+	}
+}
+
+void write_arguments_t::typecheck()
+{
+	sizes.resize(exprs.size());
+	for(size_t index = 0; index < exprs.size(); ++index)
+	{
+		exprs[index]->typecheck();
+		sizes[index] = exprs[index]->get_array_size();
+	}
+}
+
+void write_arguments_t::optimize()
+{
+	for(auto it = exprs.begin(); it != exprs.end(); ++it)
+	{
+		*it = (*it)->optimize();
+	}
+}
+
+// write_statement_t 
+
+// every element is written as an item of its own
+void write_statement_t::write_array(code_block_t * block, expression_t * expr, size_t size)
+{
+	frame_stack_t * stack = block->stack;
+	size_t area_size = 0;
+	const int * data = expr->get_array_data(block);
+	if (data == NULL)
+	{
+		area_size = array_storage_size(size);
+		int * scratch = stack->push_arrays(area_size);
+		expr->eval_array(block, scratch, size);
+		data = scratch;
+	}
+
+	output_buffer_t & output = block->runtime->output;
+	for(size_t index = 0; index < size; ++index)
+	{
+		output.write_int(data[index]);
+	}
+	stack->pop_arrays(area_size);
+}
+
+flow_interruption_type write_statement_t::execute(code_block_t * block)
+{
+	output_buffer_t & output = block->runtime->output;
+	char buffer[VALUE_BUFFER_SIZE];
+	for(size_t index = 0; index < args->size(); ++index)
+	{
+		if (!args->is_message(index) && args->get_array_size(index) != 0)
+		{
+			write_array(block, args->get_expression(index), args->get_array_size(index));
+			continue;
+		}
+		output.write(args->get_at(index, block, buffer));
+	}
+	output.end_line();
+	return fitNoIterruption;
+}
+
+// Utilities
+
+// the output written before the error comes first, a trapped error is
+// thrown as fortran_error_t
+static void fail(const std::string & message)
+{
+	runtime_t * runtime = runtime_t::get_current();
+	if (runtime != NULL)
+	{
+		runtime->output.flush();
+	}
+	if (error_trap_t::is_active())
+	{
+		throw fortran_error_t(message);
+	}
+	fprintf(stderr, "%s\n", message.c_str());
+	exit(-1);
+}
+
+static std::string format_message(const char * format, va_list args)
+{
+	char message[1024];
+	vsnprintf(message, sizeof(message), format, args);
+	return message;
+}
+
+static thread_local const char * native_stack_limit = NULL;
+
+const char * get_native_stack_limit()
+{
+	if (native_stack_limit == NULL)
+	{
+		void * low = NULL;
+		size_t size = 0;
+		pthread_attr_t attributes;
+		if (pthread_getattr_np(pthread_self(), &attributes) == 0)
+		{
+			pthread_attr_getstack(&attributes, &low, &size);
+			pthread_attr_destroy(&attributes);
+		}
+		native_stack_limit = (const char *)low + NATIVE_STACK_RESERVE;
+	}
+	return native_stack_limit;
+}
+
+void check_native_stack()
+{
+	char marker;
+	if (&marker < get_native_stack_limit())
+	{
+		raise_error("stack overflow");
+	}
+}
+
+void raise_error(const char * format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	std::string message = format_message(format, args);
+	va_end(args);
+	fail(message);
+}
+
+void raise_error_at(int line, const char * format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	std::string message = format_message(format, args);
+	va_end(args);
+	if (line > 0)
+	{
+		char prefix[32];
+		sprintf(prefix, "line number %d: ", line);
+		message = prefix + message;
+	}
+	fail(message);
+}
+
+variable_type parse_type(const char * string)
+{
+	if (!strcmp(string, "int"))
+	{
+		return vtInt;
+	}
+
+	if (!strcmp(string, "boolean"))
+	{
+		return vtBool;
+	}
+
+	return vtNoType;
+}
+
+
+const char * to_string(variable_type type)
+{
+	switch (type)
+	{
+	case vtInt:
+		return "int";
+	case vtBool:
+		return "boolean";
+	case vtArray:
+		return "int array";
+	case vtNoType:
+		return "undefined type";
+	default:
+		return NULL;
+	}
+}
+
+const char * to_string(operation type)
+{
+	switch (type)
+	{
+	case opAdd:
+		return "+";
+	case opSub:
+		return "-";
+	case opMul:
+		return "*";
+	case opDiv:
+		return "/";
+	case opMod:
+		return "%";
+	case opAnd:
+		return "AND";
+	case opOr:
+		return "OR";
+	case opNot:
+		return "NOT";
+	case opEquals:
+		return "==";
+	case opNotEquals:
+		return "!=";
+	case opLesser:
+		return "<";
+	case opGreater:
+		return ">";
+	case opLesserEquals:
+		return "<=";
+	case opGreaterEquals:
+		return ">=";
+	default:
+		return NULL;
+	}
+}
+
+const char * to_string(variant_t value, char * buffer)
+{
+	buffer[0] = '\0';
+	switch (value.type)
+	{
+	case vtInt:
+		format_int(value.int_value, buffer);
+		break;
+	case vtBool:
+		strcpy(buffer, value.bool_value ? "true" : "false");
+		break;
+	default:
+		break;
+	}
+	return buffer;
+}
+
+bool variant_equals(variant_t first, variant_t second)
+{
+	return memcmp(&first, &second, sizeof(variant_t)) == 0;
+}
+
+void check_division(int left, int right, int line)
+{
+	if (right == 0)
+	{
+		raise_error_at(line, "division by zero");
+	}
+	if (right == -1 && left == INT_MIN)
+	{
+		raise_error_at(line, "integer overflow in division");
+	}
+}
+
+bool do_loop_count(int first, int last, int step, unsigned int & remaining)
+{
+	if (step == 0)
+	{
+		raise_error("DO step must not be zero");
+	}
+
+	// the distance and the step are taken as unsigned, so neither overflows
+	if (step > 0)
+	{
+		if (first > last)
+		{
+			return false;
+		}
+		remaining = ((unsigned int)last - (unsigned int)first) / (unsigned int)step;
+	}
+	else
+	{
+		if (first < last)
+		{
+			return false;
+		}
+		remaining = ((unsigned int)first - (unsigned int)last) / (0u - (unsigned int)step);
+	}
+	return true;
+}
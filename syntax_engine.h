@@ -1,471 +1,1906 @@
-#pragma once
-
-#include <map>
-#include <vector>
-#include <string>
-
-#include "types.h"
-
-class method_t;
-class method_signature_t;
-class code_block_t;
-class expression_t;
-class statement_list_t;
-class parameter_list_t;
-
-class expression_t 
-{
-public:
-	virtual variant_t eval(code_block_t * block) = 0;
-};
-
-class statement_t
-{
-public:
-	virtual flow_interruption_type execute(code_block_t * block) = 0;
-};
-
-class code_block_t
-{
-private:
-	std::map<std::string, variable_t> scope_variables;
-	std::vector<code_block_t *> blocks;
-
-	bool check_declared(const std::string & name);
-
-public:
-	code_block_t * parent;
-
-	code_block_t(code_block_t * parent = NULL)
-	{
-		this->parent = parent;
-	}
-
-	void add_sub_block(code_block_t * sub_block)
-	{
-		blocks.push_back(sub_block);
-	}
-
-	void clear_scope()
-	{
-		scope_variables.clear();
-	}
-
-	variable_t get_variable(const std::string & name);
-	void declare_variable(const std::string & name, variable_type type);
-	void set_variable(const std::string & name, variant_t value);
-	void declare_set_variable(const std::string & name, variant_t value);
-	
-};
-
-class program_t
-{
-protected:
-	code_block_t * class_block;
-	statement_list_t * fields_declaration;
-	method_t * main;
-	std::map<std::string, method_t *> methods;
-	std::string ID;
-public:
-	program_t();
-
-	void set_name(const char * name);
-
-	code_block_t * get_code_block() 
-	{
-		return class_block;
-	}
-
-	void set_main(method_t * main)
-	{
-		this->main = main;
-	}
-
-	method_t * get_method(const std::string & ID)
-	{
-		auto it = methods.find(ID);
-		if (it == methods.end())
-		{
-			return NULL;
-		}
-		
-		return it->second;
-	}
-
-	void add_field_declaration(statement_t * stmt);
-
-	void run();
-	void add_method(method_t * method);
-};
-
-class method_t 
-{
-protected:
-	code_block_t * method_block;
-	variable_type return_type;
-	method_signature_t * arguments;
-	statement_list_t * body;
-	variant_t return_value;
-	size_t arguments_passed;
-
-public:
-	std::string ID;
-
-	method_t(const char * name, variable_type return_type, method_signature_t * args);
-	void set_body(statement_list_t * body);
-	void set_block(code_block_t * method_block);
-	void set_return_value(variant_t value);
-	variable_type get_return_type();
-	virtual void add_argument(variant_t value);
-	virtual variant_t run();
-	const char * get_id();
-};
-
-class argument_t 
-{
-private:
-	std::string ID;
-
-public:
-	argument_t(const std::string & name)
-	{
-		this->ID = name;
-	}
-
-	friend class method_t;
-};
-
-class method_signature_t
-{
-private:
-	std::vector<argument_t *> args;
-public:
-	size_t size()
-	{
-		return args.size();
-	}
-
-	argument_t * get_at(size_t index)
-	{
-		return args[index];
-	}
-
-	void add(const char * name)
-	{
-		args.push_back(new argument_t(name));
-	}
-};
-
-class statement_list_t : public statement_t
-{
-private:
-	std::vector<statement_t *> statements;
-public:
-	statement_list_t();
-
-	void add(statement_t * stmt)
-	{
-		statements.push_back(stmt);
-	}
-
-	flow_interruption_type execute(code_block_t * block)
-	{
-		flow_interruption_type result;
-		for(auto it = statements.begin(); it != statements.end(); ++it)
-		{
-			result = (*it)->execute(block);
-			if (result != fitNoIterruption)
-			{
-				return result;
-			}
-		}
-		return fitNoIterruption;
-	}
-};
-
-class code_block_statement_t : public statement_list_t
-{
-private:
-	statement_list_t * body;
-public:
-	code_block_statement_t(statement_list_t * body);
-	flow_interruption_type execute(code_block_t * block);
-};
-
-class declaration_t : public statement_t
-{
-private:
-	std::string ID;
-	variable_type type;
-public:
-	declaration_t(const char * name, variable_type type)
-	{
-		this->ID = name;
-		this->type = type;
-	}
-
-	flow_interruption_type execute(code_block_t * block)
-	{
-		block->declare_variable(ID, type); 
-		return fitNoIterruption;
-	}
-};
-
-class assignment_t : public statement_t
-{
-private:
-	std::string ID;
-	expression_t * value;
-public:
-	assignment_t(const char * name, expression_t * value)
-	{
-		this->ID = name;
-		this->value = value;
-	}
-
-	flow_interruption_type execute(code_block_t * block)
-	{
-		block->set_variable(ID, value->eval(block));
-		return fitNoIterruption;
-	}
-};
-
-class read_arguments_t 
-{
-private:
-	std::vector<std::string> params;
-public:
-	size_t size()
-	{
-		return params.size();
-	}
-
-	std::string get_at(size_t index)
-	{
-		return params[index];
-	}
-
-	void add(const char * name)
-	{
-		params.push_back(name);
-	}
-};
-
-class read_statement_t : public statement_t 
-{
-private:
-	read_arguments_t * args;
-public:
-	read_statement_t(read_arguments_t * args)
-	{
-		this->args = args;
-	}
-
-	flow_interruption_type execute(code_block_t * block);
-};
-
-class write_arguments_t 
-{
-private:
-	std::vector<expression_t *> exprs;
-	std::vector<std::string> messages;
-	std::vector<int> order;
-
-	size_t exprs_index;
-	size_t messages_index;
-
-public:
-	write_arguments_t()
-	{
-		exprs_index = 0;
-		messages_index = 0;
-	}
-
-	void add(expression_t * expr)
-	{
-		exprs.push_back(expr);
-		order.push_back(0);
-	}
-
-	void add(std::string message)
-	{
-		messages.push_back(message.substr(1, message.size()-2));
-		order.push_back(1);
-	}
-
-	size_t size()
-	{
-		return order.size();
-	}
-
-	std::string get_at(size_t index, code_block_t * block);
-};
-
-class write_statement_t : public statement_t
-{
-private:
-	write_arguments_t * args;
-public:
-	write_statement_t(write_arguments_t * args)
-	{
-		this->args = args;
-	}
-
-	flow_interruption_type execute(code_block_t * block);
-};
-
-class return_statement_t : public statement_t
-{
-private:
-	method_t * method;
-public:
-	return_statement_t(method_t * method)
-	{
-		this->method = method;
-	}
-
-	flow_interruption_type execute(code_block_t * block);
-};
-
-class constant_t : public expression_t
-{
-private:
-	variant_t value;
-public:
-	constant_t(variant_t value)
-	{
-		this->value = value;
-	}
-
-	virtual variant_t eval(code_block_t * block)
-	{
-		return value;
-	}
-};
-
-class variable_expression_t : public expression_t 
-{
-private:
-	std::string ID;
-public:
-	variable_expression_t(const char * name)
-	{
-		this->ID = name;
-	}
-
-	variant_t eval(code_block_t * block);
-};
-
-class binary_expression_t : public expression_t 
-{
-private:
-	expression_t * arg1;
-	expression_t * arg2;
-	operation type;
-
-	bool check_types(variant_t value1, variant_t value2);
-
-public:
-	binary_expression_t(operation type, expression_t * arg1, expression_t * arg2)
-	{
-		this->type = type;
-		this->arg1 = arg1;
-		this->arg2 = arg2;
-	}
-
-	variant_t eval(code_block_t * block);
-};
-
-class invocation_expression_t : public expression_t
-{
-private:
-	parameter_list_t * params;
-	std::string method_id;
-	program_t * clazz;
-public:
-	invocation_expression_t(parameter_list_t * params, const char * method_name, program_t * clazz)
-	{
-		this->params = params;
-		method_id = method_name;
-		this->clazz = clazz;
-	}
-
-	variant_t eval(code_block_t * block);
-};
-
-class parameter_list_t 
-{
-private:
-	std::vector<expression_t *> params;
-public:
-	parameter_list_t()
-	{
-	}
-
-	size_t size()
-	{
-		return params.size();
-	}
-
-	expression_t * get_at(size_t index)
-	{
-		if (index >= params.size())
-		{
-			return NULL;
-		}
-		return params[index];
-	}
-
-	void add(expression_t * expr)
-	{
-		params.push_back(expr);
-	}
-};
-
-class conditional_statement_t : public statement_t
-{
-private:
-	statement_t * true_way;
-	statement_t * false_way;
-	expression_t * condition;
-public:
-	conditional_statement_t(expression_t * condition, statement_t * true_way, statement_t * false_way = NULL);
-	flow_interruption_type execute(code_block_t * block);
-};
-
-class while_statement_t : public statement_t
-{
-private:
-	expression_t * condition;
-	statement_t * body;
-
-	bool condition_true(code_block_t * block);
-
-public:
-	while_statement_t(expression_t * condition, statement_t * body);
-	flow_interruption_type execute(code_block_t * block);
-};
-
-class break_statement_t : public statement_t
-{
-	flow_interruption_type execute(code_block_t * block);
-};
-
-class invoke_statement_t : public statement_t
-{
-private:
-	expression_t * invokee;
-public:
-	invoke_statement_t(expression_t * invokee);
-	flow_interruption_type execute(code_block_t * block);
-};
-
-// Utilities
-
-void raise_error(const char * format, ...);
-variable_type parse_type(const char * string);
-const char * to_string(variable_type type);
-const char * to_string(variant_t value);
-bool variant_equals(variant_t first, variant_t second);
-
+#pragma once
+
+#include <map>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "types.h"
+#include "array_kernels.h"
+
+class method_t;
+class method_signature_t;
+class scope_t;
+class code_block_t;
+class expression_t;
+class statement_list_t;
+class parameter_list_t;
+class code_block_statement_t;
+class declaration_t;
+class assignment_t;
+class read_statement_t;
+class write_statement_t;
+class return_statement_t;
+class conditional_statement_t;
+class while_statement_t;
+class do_statement_t;
+class break_statement_t;
+class cycle_statement_t;
+class invoke_statement_t;
+class constant_t;
+class variable_expression_t;
+class binary_expression_t;
+class short_circuit_expression_t;
+class invocation_expression_t;
+class array_declaration_t;
+class element_expression_t;
+class element_assignment_t;
+class reduction_expression_t;
+class memo_table_t;
+class thread_pool_t;
+class runtime_t;
+
+// Used by the passes that translate the tree into another representation
+class ast_visitor_t
+{
+public:
+	virtual void visit(statement_list_t * node) = 0;
+	virtual void visit(code_block_statement_t * node) = 0;
+	virtual void visit(declaration_t * node) = 0;
+	virtual void visit(assignment_t * node) = 0;
+	virtual void visit(read_statement_t * node) = 0;
+	virtual void visit(write_statement_t * node) = 0;
+	virtual void visit(return_statement_t * node) = 0;
+	virtual void visit(conditional_statement_t * node) = 0;
+	virtual void visit(while_statement_t * node) = 0;
+	virtual void visit(do_statement_t * node) = 0;
+	virtual void visit(break_statement_t * node) = 0;
+	virtual void visit(cycle_statement_t * node) = 0;
+	virtual void visit(invoke_statement_t * node) = 0;
+	virtual void visit(constant_t * node) = 0;
+	virtual void visit(variable_expression_t * node) = 0;
+	virtual void visit(binary_expression_t * node) = 0;
+	virtual void visit(short_circuit_expression_t * node) = 0;
+	virtual void visit(invocation_expression_t * node) = 0;
+	virtual void visit(array_declaration_t * node) = 0;
+	virtual void visit(element_expression_t * node) = 0;
+	virtual void visit(element_assignment_t * node) = 0;
+	virtual void visit(reduction_expression_t * node) = 0;
+};
+
+// Base of everything the tree of a program is made of. A node made while a
+// tree_arena_t is current on the thread belongs to the arena and is freed
+// with it, so the passes may share and drop nodes and no node owns another.
+class tree_node_t
+{
+public:
+	tree_node_t();
+	tree_node_t(const tree_node_t & node);
+
+	virtual ~tree_node_t()
+	{
+	}
+};
+
+// Nodes of one program, freed together with the arena
+class tree_arena_t
+{
+private:
+	std::vector<tree_node_t *> nodes;
+
+public:
+	~tree_arena_t();
+
+	void adopt(tree_node_t * node)
+	{
+		nodes.push_back(node);
+	}
+
+	// NULL when the nodes made on the calling thread are not kept
+	static tree_arena_t * get_current();
+};
+
+// Makes an arena the current one of the thread for the lifetime of the
+// object
+class current_tree_arena_t
+{
+private:
+	tree_arena_t * outer;
+
+public:
+	current_tree_arena_t(tree_arena_t * arena);
+	~current_tree_arena_t();
+};
+
+class expression_t : public tree_node_t
+{
+protected:
+	int line;
+
+public:
+	expression_t()
+	{
+		line = 0;
+	}
+
+	virtual variant_t eval(code_block_t * block) = 0;
+	virtual void resolve(scope_t * scope) = 0;
+	virtual variable_type typecheck() = 0;
+	virtual void accept(ast_visitor_t * visitor) = 0;
+
+	// value of an int or a boolean expression without the variant around
+	// it, overridden by the nodes that can do it cheaper
+	virtual int eval_int(code_block_t * block)
+	{
+		return eval(block).int_value;
+	}
+
+	virtual bool eval_bool(code_block_t * block)
+	{
+		return eval(block).bool_value;
+	}
+
+	void set_line(int line)
+	{
+		this->line = line;
+	}
+
+	int get_line()
+	{
+		return line;
+	}
+
+	// returns the node to use instead of this one
+	virtual expression_t * optimize()
+	{
+		return this;
+	}
+
+	virtual bool has_side_effects()
+	{
+		return false;
+	}
+
+	// number of elements of a whole-array expression, 0 for a scalar one
+	virtual size_t get_array_size()
+	{
+		return 0;
+	}
+
+	// storage of an array variable, NULL when the elements are computed
+	virtual const int * get_array_data(code_block_t * block)
+	{
+		return NULL;
+	}
+
+	// writes the elements of a whole-array expression to dst, the value of
+	// a scalar one is repeated
+	virtual void eval_array(code_block_t * block, int * dst, size_t size);
+};
+
+class statement_t : public tree_node_t
+{
+protected:
+	int line;
+
+public:
+	statement_t()
+	{
+		line = 0;
+	}
+
+	virtual flow_interruption_type execute(code_block_t * block) = 0;
+	virtual void resolve(scope_t * scope) = 0;
+	virtual void typecheck() = 0;
+	virtual void accept(ast_visitor_t * visitor) = 0;
+
+	void set_line(int line)
+	{
+		this->line = line;
+	}
+
+	int get_line()
+	{
+		return line;
+	}
+
+	// returns the node to use instead of this one
+	virtual statement_t * optimize()
+	{
+		return this;
+	}
+};
+
+// Compile-time scope used by the name resolution pass. Nested scopes share
+// the frame of the scope that owns it, so a variable is addressed by the
+// number of frames to skip (depth) and its index inside that frame.
+class scope_t
+{
+private:
+	// an array is placed in the array area of the frame, index is its
+	// offset there
+	struct entry_t
+	{
+		size_t index;
+		variable_type type;
+		size_t size;
+	};
+
+	std::map<std::string, entry_t> names;
+	scope_t * frame_owner;
+	size_t frame_size;
+	size_t array_area_size;
+	bool isolated;
+
+	bool check_declared(const std::string & name);
+
+public:
+	scope_t * parent;
+
+	// an isolated scope shares the frame of its parent but sees none of the
+	// names declared in that frame, only those of the frames outside it
+	scope_t(scope_t * parent = NULL, bool new_frame = true, bool isolated = false);
+
+	size_t declare_variable(const std::string & name, variable_type type, int line = 0);
+	size_t declare_array(const std::string & name, size_t size, int line = 0);
+	bool find_variable(const std::string & name, variable_slot_t & slot, variable_type * type = NULL, size_t * size = NULL);
+
+	size_t get_frame_size()
+	{
+		return frame_owner->frame_size;
+	}
+
+	size_t get_array_area_size()
+	{
+		return frame_owner->array_area_size;
+	}
+};
+
+// Enough to hold any formatted variant_t
+const size_t VALUE_BUFFER_SIZE = 32;
+
+// Number of variable slots available to the frames of a run
+const size_t STACK_SIZE = 1 << 20;
+
+// Number of array elements available to the frames of a run, temporaries
+// of whole-array expressions included
+const size_t ARRAY_STACK_SIZE = 1 << 24;
+
+// Native stack kept below the last call of the tree walker or the closure
+// engine, for the expressions around it and the error path
+const size_t NATIVE_STACK_RESERVE = 256 << 10;
+
+// Arguments a tail call may have to run in place of its caller
+const size_t TAIL_CALL_MAX_ARGUMENTS = 8;
+
+// Contiguous stack the frames of a run are allocated from: a call bumps
+// the top by the frame size of the method and the return pops it back
+class frame_stack_t
+{
+private:
+	// left to the pushes to initialize, so a run only touches the pages
+	// its frames use
+	variable_t * storage;
+	size_t size;
+	size_t top;
+
+	// arrays live apart from the variables, aligned for the kernels
+	int * arrays;
+	size_t arrays_size;
+	size_t arrays_top;
+
+public:
+	// arguments of the tail call made last, see code_block_t::tail_method
+	variant_t tail_arguments[TAIL_CALL_MAX_ARGUMENTS];
+
+	frame_stack_t(size_t size, size_t arrays_size);
+	~frame_stack_t();
+
+	variable_t * push(size_t size);
+
+	void pop(size_t size)
+	{
+		top -= size;
+	}
+
+	// size has to be a multiple of ARRAY_ALIGNMENT_INTS
+	int * push_arrays(size_t size);
+
+	void pop_arrays(size_t size)
+	{
+		arrays_top -= size;
+	}
+};
+
+// Runtime frame: a view of the flat array of variables laid out by scope_t
+class code_block_t
+{
+private:
+	variable_t * slots;
+	size_t size;
+	int * arrays;
+
+public:
+	code_block_t * parent;
+	runtime_t * runtime;
+	frame_stack_t * stack;
+	// set by a tail call made in the frame, method_t::run_tail_calls runs
+	// the method with the stack's tail arguments once the frame is done
+	method_t * tail_method;
+
+	code_block_t(code_block_t * parent, runtime_t * runtime, frame_stack_t * stack, variable_t * slots, size_t size, int * arrays = NULL)
+	{
+		this->parent = parent;
+		this->runtime = runtime;
+		this->stack = stack;
+		this->slots = slots;
+		this->size = size;
+		this->arrays = arrays;
+		tail_method = NULL;
+	}
+
+	// copy of the variables pushed on another stack, the arrays are shared;
+	// the caller pops get_size() slots when it is done
+	code_block_t fork(frame_stack_t * stack)
+	{
+		variable_t * copy = stack->push(size);
+		std::copy(slots, slots + size, copy);
+		return code_block_t(parent, runtime, stack, copy, size, arrays);
+	}
+
+	size_t get_size()
+	{
+		return size;
+	}
+
+	code_block_t * get_root()
+	{
+		code_block_t * block = this;
+		while (block->parent != NULL)
+		{
+			block = block->parent;
+		}
+		return block;
+	}
+
+	variable_t & get_variable(variable_slot_t slot)
+	{
+		code_block_t * block = this;
+		for (size_t depth = slot.depth; depth > 0; --depth)
+		{
+			block = block->parent;
+		}
+		return block->slots[slot.index];
+	}
+
+	// variable of this frame itself, a slot of depth 0
+	variable_t & get_local(size_t index)
+	{
+		return slots[index];
+	}
+
+	int * get_array(variable_slot_t slot)
+	{
+		code_block_t * block = this;
+		for (size_t depth = slot.depth; depth > 0; --depth)
+		{
+			block = block->parent;
+		}
+		return block->arrays + slot.index;
+	}
+
+	// types are checked before the run, so stores don't look at them
+	void store_variable(variable_slot_t slot, variant_t value)
+	{
+		variable_t & var = get_variable(slot);
+		var.is_assigned = true;
+		var.value = value;
+	}
+
+	void declare_variable(size_t index, variable_type type);
+	void declare_set_variable(size_t index, variant_t value);
+};
+
+class program_t : public tree_node_t
+{
+protected:
+	size_t class_frame_size;
+	statement_list_t * fields_declaration;
+	method_t * main;
+	std::map<std::string, method_t *> methods;
+	std::string ID;
+	thread_pool_t * thread_pool;
+public:
+	program_t();
+
+	void set_name(const char * name);
+
+	void set_main(method_t * main)
+	{
+		this->main = main;
+	}
+
+	method_t * get_main()
+	{
+		return main;
+	}
+
+	statement_list_t * get_fields_declaration()
+	{
+		return fields_declaration;
+	}
+
+	// runs DO CONCURRENT, NULL runs it on the calling thread
+	thread_pool_t * get_thread_pool()
+	{
+		return thread_pool;
+	}
+
+	void set_thread_pool(thread_pool_t * thread_pool)
+	{
+		this->thread_pool = thread_pool;
+	}
+
+	const std::map<std::string, method_t *> & get_methods()
+	{
+		return methods;
+	}
+
+	size_t get_class_frame_size()
+	{
+		return class_frame_size;
+	}
+
+	method_t * get_method(const std::string & ID)
+	{
+		auto it = methods.find(ID);
+		if (it == methods.end())
+		{
+			return NULL;
+		}
+		
+		return it->second;
+	}
+
+	void add_field_declaration(statement_t * stmt);
+
+	void resolve();
+	void typecheck();
+	void optimize();
+	// the program is not changed by a run, so several may go on at once
+	void run(runtime_t * runtime);
+	void add_method(method_t * method);
+};
+
+// Native code of a method compiled by the JIT, takes the arguments in order
+typedef int (*native_function_t)(const int * args);
+
+class method_t : public tree_node_t
+{
+protected:
+	variable_type return_type;
+	method_signature_t * arguments;
+	statement_list_t * body;
+	size_t frame_size;
+	size_t array_area_size;
+	size_t result_index;
+	native_function_t native_code;
+	memo_table_t * memo_table;
+
+public:
+	std::string ID;
+
+	method_t(const char * name, variable_type return_type, method_signature_t * args);
+	void set_body(statement_list_t * body);
+	// installs a body built from the current one, nothing is appended
+	void replace_body(statement_list_t * body)
+	{
+		this->body = body;
+	}
+	variable_type get_return_type();
+	size_t get_arguments_count();
+	void resolve(scope_t * class_scope);
+	void typecheck();
+	void optimize();
+
+	size_t get_frame_size()
+	{
+		return frame_size;
+	}
+
+	size_t get_array_area_size()
+	{
+		return array_area_size;
+	}
+
+	size_t get_result_index()
+	{
+		return result_index;
+	}
+
+	statement_list_t * get_body()
+	{
+		return body;
+	}
+
+	method_signature_t * get_arguments()
+	{
+		return arguments;
+	}
+
+	native_function_t get_native_code()
+	{
+		return native_code;
+	}
+
+	void set_native_code(native_function_t native_code)
+	{
+		this->native_code = native_code;
+	}
+
+	// results of earlier calls, NULL unless the method is cached
+	memo_table_t * get_memo_table()
+	{
+		return memo_table;
+	}
+
+	void set_memo_table(memo_table_t * memo_table)
+	{
+		this->memo_table = memo_table;
+	}
+
+	virtual variant_t run(code_block_t * frame);
+	// runs the calls made from the tail of a method run in the frame, which
+	// has been popped, each in a frame that replaces the one before
+	static variant_t run_tail_calls(code_block_t * frame);
+	const char * get_id();
+};
+
+class argument_t : public tree_node_t
+{
+private:
+	std::string ID;
+
+public:
+	argument_t(const std::string & name)
+	{
+		this->ID = name;
+	}
+
+	const std::string & get_id()
+	{
+		return ID;
+	}
+
+	friend class method_t;
+};
+
+class method_signature_t : public tree_node_t
+{
+private:
+	std::vector<argument_t *> args;
+public:
+	size_t size()
+	{
+		return args.size();
+	}
+
+	argument_t * get_at(size_t index)
+	{
+		return args[index];
+	}
+
+	void add(const char * name)
+	{
+		args.push_back(new argument_t(name));
+	}
+};
+
+class statement_list_t : public statement_t
+{
+private:
+	std::vector<statement_t *> statements;
+public:
+	statement_list_t();
+
+	void add(statement_t * stmt)
+	{
+		statements.push_back(stmt);
+	}
+
+	flow_interruption_type execute(code_block_t * block)
+	{
+		flow_interruption_type result;
+		for(auto it = statements.begin(); it != statements.end(); ++it)
+		{
+			result = (*it)->execute(block);
+			if (result != fitNoIterruption)
+			{
+				return result;
+			}
+		}
+		return fitNoIterruption;
+	}
+
+	void resolve(scope_t * scope)
+	{
+		for(auto it = statements.begin(); it != statements.end(); ++it)
+		{
+			(*it)->resolve(scope);
+		}
+	}
+
+	void typecheck()
+	{
+		for(auto it = statements.begin(); it != statements.end(); ++it)
+		{
+			(*it)->typecheck();
+		}
+	}
+
+	statement_t * optimize()
+	{
+		for(auto it = statements.begin(); it != statements.end(); ++it)
+		{
+			*it = (*it)->optimize();
+		}
+		return this;
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	size_t size()
+	{
+		return statements.size();
+	}
+
+	statement_t * get_at(size_t index)
+	{
+		return statements[index];
+	}
+
+	void set_at(size_t index, statement_t * stmt)
+	{
+		statements[index] = stmt;
+	}
+
+	void insert_at(size_t index, statement_t * stmt)
+	{
+		statements.insert(statements.begin() + index, stmt);
+	}
+
+	void remove_at(size_t index)
+	{
+		statements.erase(statements.begin() + index);
+	}
+};
+
+class code_block_statement_t : public statement_list_t
+{
+private:
+	statement_list_t * body;
+public:
+	code_block_statement_t(statement_list_t * body);
+	flow_interruption_type execute(code_block_t * block);
+	void resolve(scope_t * scope);
+
+	void typecheck()
+	{
+		body->typecheck();
+	}
+
+	statement_t * optimize()
+	{
+		body->optimize();
+		return this;
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	statement_list_t * get_body()
+	{
+		return body;
+	}
+};
+
+class declaration_t : public statement_t
+{
+private:
+	std::string ID;
+	variable_type type;
+	size_t index;
+public:
+	declaration_t(const char * name, variable_type type)
+	{
+		this->ID = name;
+		this->type = type;
+	}
+
+	flow_interruption_type execute(code_block_t * block)
+	{
+		block->declare_variable(index, type); 
+		return fitNoIterruption;
+	}
+
+	void resolve(scope_t * scope)
+	{
+		index = scope->declare_variable(ID, type, line);
+	}
+
+	void typecheck()
+	{
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	const std::string & get_id()
+	{
+		return ID;
+	}
+
+	size_t get_index()
+	{
+		return index;
+	}
+
+	variable_type get_type()
+	{
+		return type;
+	}
+};
+
+class assignment_t : public statement_t
+{
+private:
+	std::string ID;
+	variable_slot_t slot;
+	variable_type type;
+	size_t size;
+	expression_t * value;
+
+	void assign_array(code_block_t * block);
+
+public:
+	assignment_t(const char * name, expression_t * value)
+	{
+		this->ID = name;
+		this->value = value;
+		size = 0;
+	}
+
+	flow_interruption_type execute(code_block_t * block)
+	{
+		if (size != 0)
+		{
+			assign_array(block);
+			return fitNoIterruption;
+		}
+		block->store_variable(slot, value->eval(block));
+		return fitNoIterruption;
+	}
+
+	void resolve(scope_t * scope);
+	void typecheck();
+
+	statement_t * optimize()
+	{
+		value = value->optimize();
+		return this;
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	variable_slot_t get_slot()
+	{
+		return slot;
+	}
+
+	const std::string & get_id()
+	{
+		return ID;
+	}
+
+	expression_t * get_value()
+	{
+		return value;
+	}
+
+	// number of elements assigned, 0 for a scalar
+	size_t get_array_size()
+	{
+		return size;
+	}
+};
+
+class read_arguments_t : public tree_node_t
+{
+private:
+	std::vector<std::string> params;
+	std::vector<variable_slot_t> slots;
+	std::vector<variable_type> types;
+public:
+	size_t size()
+	{
+		return params.size();
+	}
+
+	variable_slot_t get_at(size_t index)
+	{
+		return slots[index];
+	}
+
+	const std::string & get_name(size_t index)
+	{
+		return params[index];
+	}
+
+	void add(const char * name)
+	{
+		params.push_back(name);
+	}
+
+	void resolve(scope_t * scope);
+	void typecheck(int line);
+};
+
+class read_statement_t : public statement_t 
+{
+private:
+	read_arguments_t * args;
+public:
+	read_statement_t(read_arguments_t * args)
+	{
+		this->args = args;
+	}
+
+	flow_interruption_type execute(code_block_t * block);
+
+	void resolve(scope_t * scope)
+	{
+		args->resolve(scope);
+	}
+
+	void typecheck()
+	{
+		args->typecheck(line);
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	read_arguments_t * get_args()
+	{
+		return args;
+	}
+};
+
+class write_arguments_t : public tree_node_t
+{
+private:
+	std::vector<expression_t *> exprs;
+	std::vector<std::string> messages;
+	std::vector<int> order;
+	std::vector<size_t> positions;
+	// number of elements of every expression, 0 for a scalar one
+	std::vector<size_t> sizes;
+
+public:
+	write_arguments_t()
+	{
+	}
+
+	void add(expression_t * expr)
+	{
+		positions.push_back(exprs.size());
+		exprs.push_back(expr);
+		order.push_back(0);
+	}
+
+	void add(std::string message)
+	{
+		positions.push_back(messages.size());
+		messages.push_back(message.substr(1, message.size()-2));
+		order.push_back(1);
+	}
+
+	size_t size()
+	{
+		return order.size();
+	}
+
+	bool is_message(size_t index)
+	{
+		return order[index] == 1;
+	}
+
+	expression_t * get_expression(size_t index)
+	{
+		return exprs[positions[index]];
+	}
+
+	const std::string & get_message(size_t index)
+	{
+		return messages[positions[index]];
+	}
+
+	size_t get_array_size(size_t index)
+	{
+		return sizes[positions[index]];
+	}
+
+	const char * get_at(size_t index, code_block_t * block, char * buffer);
+	void resolve(scope_t * scope);
+	void typecheck();
+	void optimize();
+};
+
+class write_statement_t : public statement_t
+{
+private:
+	write_arguments_t * args;
+
+	void write_array(code_block_t * block, expression_t * expr, size_t size);
+
+public:
+	write_statement_t(write_arguments_t * args)
+	{
+		this->args = args;
+	}
+
+	flow_interruption_type execute(code_block_t * block);
+
+	void resolve(scope_t * scope)
+	{
+		args->resolve(scope);
+	}
+
+	void typecheck()
+	{
+		args->typecheck();
+	}
+
+	statement_t * optimize()
+	{
+		args->optimize();
+		return this;
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	write_arguments_t * get_args()
+	{
+		return args;
+	}
+};
+
+class return_statement_t : public statement_t
+{
+private:
+	method_t * method;
+public:
+	return_statement_t(method_t * method)
+	{
+		this->method = method;
+	}
+
+	flow_interruption_type execute(code_block_t * block);
+
+	void resolve(scope_t * scope)
+	{
+	}
+
+	void typecheck()
+	{
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	method_t * get_method()
+	{
+		return method;
+	}
+};
+
+class constant_t : public expression_t
+{
+private:
+	variant_t value;
+public:
+	constant_t(variant_t value)
+	{
+		this->value = value;
+	}
+
+	virtual variant_t eval(code_block_t * block)
+	{
+		return value;
+	}
+
+	int eval_int(code_block_t * block)
+	{
+		return value.int_value;
+	}
+
+	bool eval_bool(code_block_t * block)
+	{
+		return value.bool_value;
+	}
+
+	void resolve(scope_t * scope)
+	{
+	}
+
+	variable_type typecheck()
+	{
+		return value.type;
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	variant_t get_value()
+	{
+		return value;
+	}
+};
+
+class variable_expression_t : public expression_t 
+{
+private:
+	std::string ID;
+	variable_slot_t slot;
+	variable_type type;
+	size_t size;
+	bool defined;
+public:
+	variable_expression_t(const char * name)
+	{
+		this->ID = name;
+		size = 0;
+		defined = false;
+	}
+
+	variant_t eval(code_block_t * block);
+	int eval_int(code_block_t * block);
+	void resolve(scope_t * scope);
+
+	variable_type typecheck()
+	{
+		return type;
+	}
+
+	size_t get_array_size()
+	{
+		return size;
+	}
+
+	const int * get_array_data(code_block_t * block)
+	{
+		return size != 0 ? block->get_array(slot) : NULL;
+	}
+
+	void eval_array(code_block_t * block, int * dst, size_t size);
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	variable_slot_t get_slot()
+	{
+		return slot;
+	}
+
+	const std::string & get_id()
+	{
+		return ID;
+	}
+
+	// the program has to be resolved again afterwards
+	void rename(const std::string & ID)
+	{
+		this->ID = ID;
+	}
+
+	// set by the IR when every way to the read assigns the local, so the
+	// read can't fail
+	void set_defined()
+	{
+		defined = true;
+	}
+
+	bool is_defined()
+	{
+		return defined;
+	}
+};
+
+class binary_expression_t : public expression_t 
+{
+private:
+	expression_t * arg1;
+	expression_t * arg2;
+	operation type;
+	expression_t * replacement;
+
+public:
+	binary_expression_t(operation type, expression_t * arg1, expression_t * arg2)
+	{
+		this->type = type;
+		this->arg1 = arg1;
+		this->arg2 = arg2;
+		replacement = NULL;
+	}
+
+	variant_t eval(code_block_t * block);
+
+	void resolve(scope_t * scope)
+	{
+		arg1->resolve(scope);
+		arg2->resolve(scope);
+		if (replacement != NULL)
+		{
+			replacement->resolve(scope);
+		}
+	}
+
+	variable_type typecheck();
+	expression_t * optimize();
+
+	bool has_side_effects()
+	{
+		return arg1->has_side_effects() || arg2->has_side_effects();
+	}
+
+	size_t get_array_size()
+	{
+		return std::max(arg1->get_array_size(), arg2->get_array_size());
+	}
+
+	void eval_array(code_block_t * block, int * dst, size_t size);
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	operation get_operation()
+	{
+		return type;
+	}
+
+	expression_t * get_left()
+	{
+		return arg1;
+	}
+
+	expression_t * get_right()
+	{
+		return arg2;
+	}
+
+	// optimize() returns the node instead of this one, so the parent takes
+	// it; the program has to be resolved again before
+	void replace_with(expression_t * node)
+	{
+		replacement = node;
+	}
+
+	// NULL unless replaced
+	expression_t * get_replacement()
+	{
+		return replacement;
+	}
+};
+
+// AND/OR that does not evaluate its second operand when the first one
+// already decides the result, created by the optimization pass
+class short_circuit_expression_t : public expression_t
+{
+private:
+	expression_t * arg1;
+	expression_t * arg2;
+	operation type;
+
+public:
+	short_circuit_expression_t(operation type, expression_t * arg1, expression_t * arg2)
+	{
+		this->type = type;
+		this->arg1 = arg1;
+		this->arg2 = arg2;
+	}
+
+	variant_t eval(code_block_t * block)
+	{
+		variant_t result;
+		result.type = vtBool;
+		result.bool_value = eval_bool(block);
+		return result;
+	}
+
+	bool eval_bool(code_block_t * block)
+	{
+		bool value = arg1->eval_bool(block);
+		if (value == (type == opAnd))
+		{
+			value = arg2->eval_bool(block);
+		}
+		return value;
+	}
+
+	void resolve(scope_t * scope)
+	{
+		arg1->resolve(scope);
+		arg2->resolve(scope);
+	}
+
+	// created after type checking, the operands are known to be boolean
+	variable_type typecheck()
+	{
+		return vtBool;
+	}
+
+	expression_t * optimize();
+
+	bool has_side_effects()
+	{
+		return arg1->has_side_effects() || arg2->has_side_effects();
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	operation get_operation()
+	{
+		return type;
+	}
+
+	expression_t * get_left()
+	{
+		return arg1;
+	}
+
+	expression_t * get_right()
+	{
+		return arg2;
+	}
+};
+
+class invocation_expression_t : public expression_t
+{
+private:
+	parameter_list_t * params;
+	std::string method_id;
+	program_t * clazz;
+	// bound by typecheck, which checks the arguments against it
+	method_t * method;
+	// copy of the body of the method put here by the inliner, it runs in
+	// slots of the caller's frame: the arguments, then the result, then the
+	// variables of the body
+	statement_list_t * inline_body;
+	size_t inline_arguments_index;
+	// the result of the call becomes the result of the caller, which has
+	// nothing left to do
+	bool tail_call;
+
+	variant_t eval_memoized(code_block_t * block, method_t * method, memo_table_t * memo_table);
+	variant_t eval_inline(code_block_t * block);
+
+public:
+	invocation_expression_t(parameter_list_t * params, const char * method_name, program_t * clazz)
+	{
+		this->params = params;
+		method_id = method_name;
+		this->clazz = clazz;
+		method = NULL;
+		inline_body = NULL;
+		inline_arguments_index = 0;
+		tail_call = false;
+	}
+
+	variant_t eval(code_block_t * block);
+	void resolve(scope_t * scope);
+	variable_type typecheck();
+	expression_t * optimize();
+
+	bool has_side_effects()
+	{
+		return true;
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	const std::string & get_method_id()
+	{
+		return method_id;
+	}
+
+	// NULL before typecheck
+	method_t * get_method()
+	{
+		return method;
+	}
+
+	// the program has to be resolved again afterwards, the body is given
+	// slots then
+	void set_inline_body(statement_list_t * body)
+	{
+		inline_body = body;
+	}
+
+	// NULL unless the call was inlined; the engines that ignore it call the
+	// method as usual
+	statement_list_t * get_inline_body()
+	{
+		return inline_body;
+	}
+
+	size_t get_inline_arguments_index()
+	{
+		return inline_arguments_index;
+	}
+
+	size_t get_inline_result_index();
+
+	// set by the optimizer; the engines that ignore it make the call as
+	// usual
+	void set_tail_call()
+	{
+		tail_call = true;
+	}
+
+	bool is_tail_call()
+	{
+		return tail_call;
+	}
+
+	parameter_list_t * get_params()
+	{
+		return params;
+	}
+};
+
+class parameter_list_t : public tree_node_t
+{
+private:
+	std::vector<expression_t *> params;
+public:
+	parameter_list_t()
+	{
+	}
+
+	size_t size()
+	{
+		return params.size();
+	}
+
+	expression_t * get_at(size_t index)
+	{
+		if (index >= params.size())
+		{
+			return NULL;
+		}
+		return params[index];
+	}
+
+	void add(expression_t * expr)
+	{
+		params.push_back(expr);
+	}
+
+	void resolve(scope_t * scope)
+	{
+		for(auto it = params.begin(); it != params.end(); ++it)
+		{
+			(*it)->resolve(scope);
+		}
+	}
+
+	void optimize()
+	{
+		for(auto it = params.begin(); it != params.end(); ++it)
+		{
+			*it = (*it)->optimize();
+		}
+	}
+};
+
+class conditional_statement_t : public statement_t
+{
+private:
+	statement_t * true_way;
+	statement_t * false_way;
+	expression_t * condition;
+public:
+	conditional_statement_t(expression_t * condition, statement_t * true_way, statement_t * false_way = NULL);
+	flow_interruption_type execute(code_block_t * block);
+	void resolve(scope_t * scope);
+	void typecheck();
+	statement_t * optimize();
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	expression_t * get_condition()
+	{
+		return condition;
+	}
+
+	statement_t * get_true_way()
+	{
+		return true_way;
+	}
+
+	statement_t * get_false_way()
+	{
+		return false_way;
+	}
+};
+
+class while_statement_t : public statement_t
+{
+private:
+	expression_t * condition;
+	statement_t * body;
+
+	bool condition_true(code_block_t * block)
+	{
+		return condition->eval_bool(block);
+	}
+
+public:
+	while_statement_t(expression_t * condition, statement_t * body);
+	flow_interruption_type execute(code_block_t * block);
+	void resolve(scope_t * scope);
+	void typecheck();
+
+	statement_t * optimize()
+	{
+		body = body->optimize();
+		condition = condition->optimize();
+		return this;
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	expression_t * get_condition()
+	{
+		return condition;
+	}
+
+	statement_t * get_body()
+	{
+		return body;
+	}
+};
+
+// DO ID = first, last [, step]: the number of iterations is computed once on
+// entry and the variable is advanced by the loop itself
+class do_statement_t : public statement_t
+{
+protected:
+	std::string ID;
+	variable_slot_t slot;
+	variable_type type;
+	expression_t * first;
+	expression_t * last;
+	expression_t * step;
+	statement_t * body;
+
+public:
+	do_statement_t(const char * name, expression_t * first, expression_t * last, expression_t * step, statement_t * body);
+	flow_interruption_type execute(code_block_t * block);
+	void resolve(scope_t * scope);
+	void typecheck();
+	statement_t * optimize();
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	const std::string & get_id()
+	{
+		return ID;
+	}
+
+	variable_slot_t get_slot()
+	{
+		return slot;
+	}
+
+	expression_t * get_first()
+	{
+		return first;
+	}
+
+	expression_t * get_last()
+	{
+		return last;
+	}
+
+	// NULL when the step is 1
+	expression_t * get_step()
+	{
+		return step;
+	}
+
+	statement_t * get_body()
+	{
+		return body;
+	}
+};
+
+// DO CONCURRENT (ID = first:last[:step]), the iterations may run in any
+// order and in parallel. Scalars assigned by the body are private to a
+// chunk of iterations, arrays are shared. The other engines run it as a
+// counted DO.
+class do_concurrent_statement_t : public do_statement_t
+{
+private:
+	program_t * clazz;
+
+public:
+	do_concurrent_statement_t(const char * name, expression_t * first, expression_t * last, expression_t * step, statement_t * body, program_t * clazz)
+		: do_statement_t(name, first, last, step, body)
+	{
+		this->clazz = clazz;
+	}
+
+	flow_interruption_type execute(code_block_t * block);
+	void typecheck();
+};
+
+class break_statement_t : public statement_t
+{
+	flow_interruption_type execute(code_block_t * block);
+
+	void resolve(scope_t * scope)
+	{
+	}
+
+	void typecheck()
+	{
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+};
+
+class cycle_statement_t : public statement_t
+{
+	flow_interruption_type execute(code_block_t * block);
+
+	void resolve(scope_t * scope)
+	{
+	}
+
+	void typecheck()
+	{
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+};
+
+class invoke_statement_t : public statement_t
+{
+private:
+	expression_t * invokee;
+public:
+	invoke_statement_t(expression_t * invokee);
+	flow_interruption_type execute(code_block_t * block);
+
+	void resolve(scope_t * scope)
+	{
+		invokee->resolve(scope);
+	}
+
+	void typecheck()
+	{
+		invokee->typecheck();
+	}
+
+	statement_t * optimize()
+	{
+		invokee = invokee->optimize();
+		return this;
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	expression_t * get_invokee()
+	{
+		return invokee;
+	}
+};
+
+// INTEGER, DIMENSION(size) :: ID
+class array_declaration_t : public statement_t
+{
+private:
+	std::string ID;
+	size_t size;
+	size_t index;
+public:
+	array_declaration_t(const char * name, int size)
+	{
+		this->ID = name;
+		this->size = size < 0 ? 0 : size;
+	}
+
+	// elements start at 0
+	flow_interruption_type execute(code_block_t * block)
+	{
+		array_fill(block->get_array(variable_slot_t{0, index}), 0, size);
+		return fitNoIterruption;
+	}
+
+	void resolve(scope_t * scope);
+
+	void typecheck()
+	{
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	const std::string & get_id()
+	{
+		return ID;
+	}
+
+	size_t get_index()
+	{
+		return index;
+	}
+
+	size_t get_size()
+	{
+		return size;
+	}
+};
+
+// ID(index), indices start at 1
+class element_expression_t : public expression_t
+{
+private:
+	std::string ID;
+	variable_slot_t slot;
+	variable_type type;
+	size_t size;
+	expression_t * index;
+public:
+	element_expression_t(const char * name, expression_t * index)
+	{
+		this->ID = name;
+		this->index = index;
+		size = 0;
+	}
+
+	variant_t eval(code_block_t * block);
+	int eval_int(code_block_t * block);
+	void resolve(scope_t * scope);
+	variable_type typecheck();
+
+	expression_t * optimize()
+	{
+		index = index->optimize();
+		return this;
+	}
+
+	bool has_side_effects()
+	{
+		return index->has_side_effects();
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	const std::string & get_id()
+	{
+		return ID;
+	}
+
+	variable_slot_t get_slot()
+	{
+		return slot;
+	}
+
+	// number of elements of the array
+	size_t get_length()
+	{
+		return size;
+	}
+
+	expression_t * get_index()
+	{
+		return index;
+	}
+};
+
+// ID(index) = value
+class element_assignment_t : public statement_t
+{
+private:
+	std::string ID;
+	variable_slot_t slot;
+	variable_type type;
+	size_t size;
+	expression_t * index;
+	expression_t * value;
+public:
+	element_assignment_t(const char * name, expression_t * index, expression_t * value)
+	{
+		this->ID = name;
+		this->index = index;
+		this->value = value;
+		size = 0;
+	}
+
+	flow_interruption_type execute(code_block_t * block);
+	void resolve(scope_t * scope);
+	void typecheck();
+
+	statement_t * optimize()
+	{
+		index = index->optimize();
+		value = value->optimize();
+		return this;
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	const std::string & get_id()
+	{
+		return ID;
+	}
+
+	variable_slot_t get_slot()
+	{
+		return slot;
+	}
+
+	// number of elements of the array
+	size_t get_length()
+	{
+		return size;
+	}
+
+	expression_t * get_index()
+	{
+		return index;
+	}
+
+	expression_t * get_value()
+	{
+		return value;
+	}
+};
+
+// SUM(array) and MAXVAL(array)
+class reduction_expression_t : public expression_t
+{
+public:
+	enum reduction_type
+	{
+		rtSum,
+		rtMaxval
+	};
+
+private:
+	reduction_type type;
+	size_t size;
+	expression_t * arg;
+public:
+	reduction_expression_t(reduction_type type, expression_t * arg)
+	{
+		this->type = type;
+		this->arg = arg;
+		size = 0;
+	}
+
+	variant_t eval(code_block_t * block);
+
+	void resolve(scope_t * scope)
+	{
+		arg->resolve(scope);
+	}
+
+	variable_type typecheck();
+
+	expression_t * optimize()
+	{
+		arg = arg->optimize();
+		return this;
+	}
+
+	bool has_side_effects()
+	{
+		return arg->has_side_effects();
+	}
+
+	void accept(ast_visitor_t * visitor)
+	{
+		visitor->visit(this);
+	}
+
+	reduction_type get_reduction()
+	{
+		return type;
+	}
+
+	expression_t * get_arg()
+	{
+		return arg;
+	}
+};
+
+// Utilities
+
+void raise_error(const char * format, ...);
+void raise_error_at(int line, const char * format, ...);
+// lowest address the calls made on the calling thread may use
+const char * get_native_stack_limit();
+// calls recurse on the native stack, "stack overflow" is raised before it
+// runs out
+void check_native_stack();
+variable_type parse_type(const char * string);
+const char * to_string(variable_type type);
+const char * to_string(operation type);
+const char * to_string(variant_t value, char * buffer);
+bool variant_equals(variant_t first, variant_t second);
+// x / 0 and INT_MIN / -1 have no int result, they are raised as errors of
+// the line of the division; MOD is checked the same way
+void check_division(int left, int right, int line);
+// false when a counted DO loop runs no iterations, otherwise remaining is
+// the number of iterations after the first one
+bool do_loop_count(int first, int last, int step, unsigned int & remaining);
+
 #include "fortran.tab.hpp"
\ No newline at end of file
@@ -0,0 +1,18 @@
+PROGRAM ALLOC_LOOP
+	INTEGER :: I, N, S
+	INTEGER, DIMENSION(4) :: A
+	READ N
+	S = 0
+	DO I = 1, N
+		A(I - I / 4 * 4 + 1) = I
+		IF (I > S) THEN
+			S = S + CALL TWICE(I) - I
+		END IF
+		WRITE "step", I, S
+	END DO
+	WRITE S, A
+END PROGRAM ALLOC_LOOP
+
+FUNCTION TWICE(X)
+	TWICE = X + X
+END FUNCTION TWICE
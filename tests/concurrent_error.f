@@ -0,0 +1,12 @@
+PROGRAM CONCURRENT_ERROR
+	INTEGER :: I, Z
+	Z = 0
+	WRITE "before"
+	DO CONCURRENT (I = 1:100)
+		WRITE "it", I
+		IF (I == 60) THEN
+			WRITE "fail", I / Z
+		END IF
+	END DO
+	WRITE "after"
+END PROGRAM CONCURRENT_ERROR
@@ -0,0 +1,33 @@
+PROGRAM CONCURRENT_LOCALS
+	INTEGER :: I
+	I = 7
+	DO CONCURRENT (I = 1:4)
+		INTEGER :: S, J
+		S = 0
+		DO J = 1, I
+			S = S + J
+		END DO
+		WRITE "sum", I, S
+	END DO
+	WRITE "index", I, CALL INDEX(5), CALL INDEX(0)
+	WRITE "unset", CALL UNSET(3)
+END PROGRAM CONCURRENT_LOCALS
+
+FUNCTION INDEX(N)
+	INTEGER :: I
+	I = 100
+	DO CONCURRENT (I = 1:N)
+		INTEGER :: S
+		S = I * I
+	END DO
+	INDEX = I
+END FUNCTION INDEX
+
+FUNCTION UNSET(N)
+	INTEGER :: I
+	DO CONCURRENT (I = 1:N)
+		INTEGER :: S
+		S = I
+	END DO
+	UNSET = I
+END FUNCTION UNSET
@@ -0,0 +1,15 @@
+PROGRAM DIV_ERRORS
+	INTEGER :: A, B, IN_FUNCTION
+	READ A, B, IN_FUNCTION
+	WRITE "before", A, B, 100 / 7
+	IF (IN_FUNCTION == 0) THEN
+		WRITE "main", A / B
+	ELSE
+		WRITE "function", CALL DIVIDE(A, B)
+	END IF
+	WRITE "after"
+END PROGRAM DIV_ERRORS
+
+FUNCTION DIVIDE(A, B)
+	DIVIDE = A / B
+END FUNCTION DIVIDE
@@ -0,0 +1,44 @@
+PROGRAM DO_LOOPS
+	INTEGER :: I, J, N, S
+	N = 10
+	S = 0
+	DO I = 1, N
+		S = S + I
+		I = I * 2
+	END DO
+	WRITE "modified", I, S
+	S = 0
+	DO I = N, 1, -3
+		IF (I == 7) THEN
+			CYCLE
+		END IF
+		S = S * 10 + I
+	END DO
+	WRITE "down", I, S
+	DO I = 5, 1
+		S = 0
+	END DO
+	WRITE "none", I, S
+	S = 0
+	DO I = 1, N
+		DO J = I, N, 2
+			S = S + J
+			J = 0
+		END DO
+		IF (S > 100) THEN
+			EXIT
+		END IF
+	END DO
+	WRITE "nested", I, J, S
+	WRITE "calls", CALL COUNT(N)
+END PROGRAM DO_LOOPS
+
+FUNCTION COUNT(N)
+	INTEGER :: I
+	COUNT = 0
+	DO I = 1, N, 2
+		COUNT = COUNT + I
+		I = I + 100
+	END DO
+	COUNT = COUNT * 1000 + I
+END FUNCTION COUNT
@@ -0,0 +1,27 @@
+// Counts the calls of malloc made by the process it is preloaded into and
+// writes the count to stderr at exit (make test-alloc)
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+extern "C" void * __libc_malloc(size_t size);
+
+static std::atomic<size_t> malloc_count(0);
+
+extern "C" void * malloc(size_t size)
+{
+	++malloc_count;
+	return __libc_malloc(size);
+}
+
+__attribute__((destructor)) static void report()
+{
+	// snprintf and write don't allocate
+	char line[64];
+	int length = snprintf(line, sizeof(line), "%zu\n", malloc_count.load());
+	if (write(2, line, length) < 0)
+	{
+		abort();
+	}
+}
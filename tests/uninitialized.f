@@ -0,0 +1,15 @@
+PROGRAM UNINITIALIZED
+	INTEGER :: X, Y, Z
+	Z = 3
+	WRITE "defined", Z * 0, 0 * Z, CALL TIMES_ZERO(6)
+	Y = X * 0
+	WRITE "after", Y
+END PROGRAM UNINITIALIZED
+
+FUNCTION TIMES_ZERO(N)
+	INTEGER :: M
+	IF (N > 5) THEN
+		M = N
+	END IF
+	TIMES_ZERO = 0 * M
+END FUNCTION TIMES_ZERO
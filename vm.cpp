@@ -0,0 +1,961 @@
+#include "vm.h"
+#include "runtime.h"
+
+// operation helpers
+
+static bool is_comparison(operation type)
+{
+	switch (type)
+	{
+	case opEquals:
+	case opNotEquals:
+	case opLesser:
+	case opGreater:
+	case opLesserEquals:
+	case opGreaterEquals:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool has_constant_form(operation type)
+{
+	return type != opAnd && type != opOr && type != opNot;
+}
+
+// operation to use when the operands are swapped, opNot if there is none
+static operation swapped(operation type)
+{
+	switch (type)
+	{
+	case opAdd:
+	case opMul:
+	case opEquals:
+	case opNotEquals:
+		return type;
+	case opLesser:
+		return opGreater;
+	case opGreater:
+		return opLesser;
+	case opLesserEquals:
+		return opGreaterEquals;
+	case opGreaterEquals:
+		return opLesserEquals;
+	default:
+		return opNot;
+	}
+}
+
+static operation negated(operation type)
+{
+	switch (type)
+	{
+	case opEquals:
+		return opNotEquals;
+	case opNotEquals:
+		return opEquals;
+	case opLesser:
+		return opGreaterEquals;
+	case opGreater:
+		return opLesserEquals;
+	case opLesserEquals:
+		return opGreater;
+	default:
+		return opLesser;
+	}
+}
+
+static vm_opcode binary_opcode(operation type, bool constant)
+{
+	switch (type)
+	{
+	case opAdd:
+		return constant ? vmAddConst : vmAdd;
+	case opSub:
+		return constant ? vmSubConst : vmSub;
+	case opMul:
+		return constant ? vmMulConst : vmMul;
+	case opDiv:
+		return constant ? vmDivConst : vmDiv;
+	case opMod:
+		return constant ? vmModConst : vmMod;
+	case opAnd:
+		return vmAnd;
+	case opOr:
+		return vmOr;
+	case opEquals:
+		return constant ? vmEqualsConst : vmEquals;
+	case opNotEquals:
+		return constant ? vmNotEqualsConst : vmNotEquals;
+	case opLesser:
+		return constant ? vmLesserConst : vmLesser;
+	case opGreater:
+		return constant ? vmGreaterConst : vmGreater;
+	case opLesserEquals:
+		return constant ? vmLesserEqualsConst : vmLesserEquals;
+	default:
+		return constant ? vmGreaterEqualsConst : vmGreaterEquals;
+	}
+}
+
+static vm_opcode jump_opcode(operation type, bool constant)
+{
+	switch (type)
+	{
+	case opEquals:
+		return constant ? vmJumpEqualsConst : vmJumpEquals;
+	case opNotEquals:
+		return constant ? vmJumpNotEqualsConst : vmJumpNotEquals;
+	case opLesser:
+		return constant ? vmJumpLesserConst : vmJumpLesser;
+	case opGreater:
+		return constant ? vmJumpGreaterConst : vmJumpGreater;
+	case opLesserEquals:
+		return constant ? vmJumpLesserEqualsConst : vmJumpLesserEquals;
+	default:
+		return constant ? vmJumpGreaterEqualsConst : vmJumpGreaterEquals;
+	}
+}
+
+static int constant_int(variant_t value)
+{
+	return value.type == vtBool ? value.bool_value : value.int_value;
+}
+
+// vm_t
+
+vm_t::vm_t()
+{
+	main_index = 0;
+}
+
+void vm_t::load(program_t * program)
+{
+	std::vector<method_t *> methods;
+	methods.push_back(program->get_main());
+	auto & program_methods = program->get_methods();
+	for(auto it = program_methods.begin(); it != program_methods.end(); ++it)
+	{
+		methods.push_back(it->second);
+	}
+
+	// signatures first, so that calls can refer to functions compiled later
+	for(size_t index = 0; index < methods.size(); ++index)
+	{
+		vm_function_t * function = new vm_function_t();
+		function->ID = methods[index]->ID;
+		function->arguments_count = methods[index]->get_arguments_count();
+		if (index != main_index)
+		{
+			function_indices.insert(std::make_pair(function->ID, index));
+		}
+		functions.push_back(function);
+	}
+
+	vm_compiler_t compiler(this);
+	for(size_t index = 0; index < methods.size(); ++index)
+	{
+		compiler.compile(methods[index], functions[index]);
+	}
+}
+
+size_t vm_t::get_function_index(const std::string & ID)
+{
+	auto it = function_indices.find(ID);
+	if (it == function_indices.end())
+	{
+		raise_error("'%s': method not found", ID.c_str());
+	}
+	return it->second;
+}
+
+vm_function_t * vm_t::get_function(size_t index)
+{
+	return functions[index];
+}
+
+int vm_t::add_string(const std::string & value)
+{
+	strings.push_back(value);
+	return strings.size() - 1;
+}
+
+struct vm_frame_t
+{
+	vm_function_t * function;
+	const vm_instruction_t * ip;
+	size_t base;
+	int result_register;
+};
+
+#define VM_INT_OPERATION(opcode, op) \
+	case opcode: \
+		regs[ins.a].type = vtInt; \
+		regs[ins.a].int_value = regs[ins.b].int_value op regs[ins.c].int_value; \
+		break; \
+	case opcode##Const: \
+		regs[ins.a].type = vtInt; \
+		regs[ins.a].int_value = regs[ins.b].int_value op ins.c; \
+		break;
+
+#define VM_BOOL_OPERATION(opcode, op) \
+	case opcode: \
+		regs[ins.a].type = vtBool; \
+		regs[ins.a].int_value = regs[ins.b].int_value op regs[ins.c].int_value; \
+		break;
+
+#define VM_COMPARISON(opcode, op) \
+	VM_BOOL_OPERATION(opcode, op) \
+	case opcode##Const: \
+		regs[ins.a].type = vtBool; \
+		regs[ins.a].int_value = regs[ins.b].int_value op ins.c; \
+		break;
+
+#define VM_JUMP(opcode, op) \
+	case opcode: \
+		if (regs[ins.a].int_value op regs[ins.b].int_value) \
+		{ \
+			ip = code + ins.c; \
+		} \
+		break; \
+	case opcode##Const: \
+		if (regs[ins.a].int_value op ins.b) \
+		{ \
+			ip = code + ins.c; \
+		} \
+		break;
+
+void vm_t::run(runtime_t * runtime)
+{
+	current_runtime_t current(runtime);
+	output_buffer_t & output = runtime->output;
+	input_reader_t & input = runtime->input;
+
+	std::vector<vm_frame_t> frames;
+	vm_function_t * function = functions[main_index];
+	size_t base = 0;
+
+	std::vector<variant_t> registers(1 << 16);
+	variant_t * regs = &registers[0];
+	for(size_t index = 0; index < function->variables_count; ++index)
+	{
+		regs[index].type = vtNoType;
+	}
+
+	const vm_instruction_t * code = &function->code[0];
+	const vm_instruction_t * ip = code;
+
+	for(;;)
+	{
+		const vm_instruction_t & ins = *ip++;
+		switch (ins.opcode)
+		{
+		case vmLoad:
+			regs[ins.a].type = (variable_type)ins.c;
+			regs[ins.a].int_value = ins.b;
+			break;
+		case vmMove:
+			regs[ins.a] = regs[ins.b];
+			break;
+		case vmCheck:
+			if (regs[ins.a].type == vtNoType)
+			{
+				raise_error("'%s': using uninitialized variable", strings[ins.b].c_str());
+			}
+			break;
+		case vmClear:
+			regs[ins.a].type = vtNoType;
+			break;
+		case vmCheckDivision:
+			check_division(regs[ins.a].int_value, regs[ins.b].int_value, ins.c);
+			break;
+
+		VM_INT_OPERATION(vmAdd, +)
+		VM_INT_OPERATION(vmSub, -)
+		VM_INT_OPERATION(vmMul, *)
+		VM_INT_OPERATION(vmDiv, /)
+		VM_INT_OPERATION(vmMod, %)
+		VM_BOOL_OPERATION(vmAnd, &&)
+		VM_BOOL_OPERATION(vmOr, ||)
+
+		VM_COMPARISON(vmEquals, ==)
+		VM_COMPARISON(vmNotEquals, !=)
+		VM_COMPARISON(vmLesser, <)
+		VM_COMPARISON(vmGreater, >)
+		VM_COMPARISON(vmLesserEquals, <=)
+		VM_COMPARISON(vmGreaterEquals, >=)
+
+		case vmJump:
+			ip = code + ins.c;
+			break;
+		case vmJumpIf:
+			if (regs[ins.a].int_value)
+			{
+				ip = code + ins.c;
+			}
+			break;
+		case vmJumpIfNot:
+			if (!regs[ins.a].int_value)
+			{
+				ip = code + ins.c;
+			}
+			break;
+
+		VM_JUMP(vmJumpEquals, ==)
+		VM_JUMP(vmJumpNotEquals, !=)
+		VM_JUMP(vmJumpLesser, <)
+		VM_JUMP(vmJumpGreater, >)
+		VM_JUMP(vmJumpLesserEquals, <=)
+		VM_JUMP(vmJumpGreaterEquals, >=)
+
+		case vmLoopEnter:
+		{
+			unsigned int remaining;
+			if (!do_loop_count(regs[ins.b].int_value, regs[ins.b + 1].int_value, regs[ins.b + 2].int_value, remaining))
+			{
+				ip = code + ins.c;
+				break;
+			}
+			regs[ins.a].type = vtInt;
+			regs[ins.a].int_value = (int)remaining;
+			break;
+		}
+		case vmLoopNext:
+			if (regs[ins.a].int_value != 0)
+			{
+				regs[ins.a].int_value = (int)((unsigned int)regs[ins.a].int_value - 1);
+				ip = code + ins.c;
+			}
+			break;
+
+		case vmCall:
+		{
+			vm_function_t * callee = functions[ins.b];
+			size_t callee_base = base + function->registers_count;
+			// the registers get as many slots as the frames of the tree walker
+			if (callee_base + callee->registers_count > STACK_SIZE)
+			{
+				raise_error("stack overflow");
+			}
+			if (callee_base + callee->registers_count > registers.size())
+			{
+				registers.resize(2 * (callee_base + callee->registers_count));
+				regs = &registers[base];
+			}
+
+			variant_t * callee_regs = &registers[callee_base];
+			for(size_t index = 0; index < callee->arguments_count; ++index)
+			{
+				callee_regs[index] = regs[ins.c + index];
+			}
+			for(size_t index = callee->arguments_count; index < callee->variables_count; ++index)
+			{
+				callee_regs[index].type = vtNoType;
+			}
+
+			vm_frame_t frame;
+			frame.function = function;
+			frame.ip = ip;
+			frame.base = base;
+			frame.result_register = ins.a;
+			frames.push_back(frame);
+
+			function = callee;
+			base = callee_base;
+			regs = callee_regs;
+			code = &callee->code[0];
+			ip = code;
+			break;
+		}
+		case vmReturn:
+		{
+			variant_t result;
+			result.type = vtInt;
+			result.int_value = ins.a >= 0 ? regs[ins.a].int_value : 0;
+
+			if (frames.empty())
+			{
+				return;
+			}
+
+			vm_frame_t & frame = frames.back();
+			function = frame.function;
+			base = frame.base;
+			regs = &registers[base];
+			code = &function->code[0];
+			ip = frame.ip;
+			regs[frame.result_register] = result;
+			frames.pop_back();
+			break;
+		}
+
+		case vmRead:
+		{
+			output.flush_for_input();
+			regs[ins.a].type = vtInt;
+			regs[ins.a].int_value = input.read_int();
+			break;
+		}
+		case vmWriteString:
+			output.write(strings[ins.a].c_str());
+			break;
+		case vmWriteInt:
+			output.write_int(regs[ins.a].int_value);
+			break;
+		case vmWriteBool:
+			output.write_bool(regs[ins.a].int_value != 0);
+			break;
+		case vmWriteLine:
+			output.end_line();
+			break;
+		}
+	}
+}
+
+// vm_compiler_t
+
+vm_compiler_t::vm_compiler_t(vm_t * vm)
+{
+	this->vm = vm;
+	method = NULL;
+	function = NULL;
+	next_register = 0;
+	target = -1;
+}
+
+void vm_compiler_t::compile(method_t * method, vm_function_t * function)
+{
+	this->method = method;
+	this->function = function;
+
+	function->code.clear();
+	function->variables_count = method->get_frame_size();
+	function->registers_count = function->variables_count;
+	next_register = function->variables_count;
+
+	assigned.assign(function->variables_count, false);
+	for(size_t index = 0; index < function->arguments_count; ++index)
+	{
+		assigned[index] = true;
+	}
+
+	method->get_body()->accept(this);
+}
+
+size_t vm_compiler_t::emit(vm_opcode opcode, int a, int b, int c)
+{
+	vm_instruction_t ins;
+	ins.opcode = opcode;
+	ins.a = a;
+	ins.b = b;
+	ins.c = c;
+	function->code.push_back(ins);
+	return function->code.size() - 1;
+}
+
+void vm_compiler_t::patch(size_t jump)
+{
+	function->code[jump].c = function->code.size();
+}
+
+void vm_compiler_t::patch(const std::vector<size_t> & jumps, size_t target)
+{
+	for(size_t index = 0; index < jumps.size(); ++index)
+	{
+		function->code[jumps[index]].c = target;
+	}
+}
+
+void vm_compiler_t::set_unreachable()
+{
+	assigned.assign(assigned.size(), true);
+}
+
+void vm_compiler_t::merge_state(const std::vector<bool> & other)
+{
+	for(size_t index = 0; index < assigned.size(); ++index)
+	{
+		assigned[index] = assigned[index] && other[index];
+	}
+}
+
+int vm_compiler_t::alloc_register()
+{
+	int reg = next_register++;
+	if ((size_t)next_register > function->registers_count)
+	{
+		function->registers_count = next_register;
+	}
+	return reg;
+}
+
+int vm_compiler_t::to_register(vm_operand_t operand, int target)
+{
+	if (operand.is_constant)
+	{
+		int reg = target >= 0 ? target : alloc_register();
+		emit(vmLoad, reg, constant_int(operand.value), operand.value.type);
+		return reg;
+	}
+
+	if (target >= 0 && target != operand.reg)
+	{
+		emit(vmMove, target, operand.reg);
+		return target;
+	}
+	return operand.reg;
+}
+
+vm_operand_t vm_compiler_t::compile_expression(expression_t * expr, int target)
+{
+	int saved_target = this->target;
+	this->target = target;
+	expr->accept(this);
+	this->target = saved_target;
+	return result;
+}
+
+// emits the jumps taken when expr is jump_if and adds them to jumps
+void vm_compiler_t::compile_condition(expression_t * expr, bool jump_if, std::vector<size_t> & jumps)
+{
+	short_circuit_expression_t * logical = dynamic_cast<short_circuit_expression_t *>(expr);
+	if (logical != NULL)
+	{
+		// the second operand may be skipped, so its checks do not count
+		bool is_and = logical->get_operation() == opAnd;
+		if (jump_if != is_and)
+		{
+			compile_condition(logical->get_left(), jump_if, jumps);
+			std::vector<bool> state = assigned;
+			compile_condition(logical->get_right(), jump_if, jumps);
+			assigned = state;
+		}
+		else
+		{
+			std::vector<size_t> skip;
+			compile_condition(logical->get_left(), !jump_if, skip);
+			std::vector<bool> state = assigned;
+			compile_condition(logical->get_right(), jump_if, jumps);
+			assigned = state;
+			patch(skip, function->code.size());
+		}
+		return;
+	}
+
+	binary_expression_t * comparison = dynamic_cast<binary_expression_t *>(expr);
+	if (comparison != NULL && is_comparison(comparison->get_operation()))
+	{
+		operation type = comparison->get_operation();
+		vm_operand_t left = compile_expression(comparison->get_left());
+		vm_operand_t right = compile_expression(comparison->get_right());
+
+		if (left.is_constant && !right.is_constant)
+		{
+			std::swap(left, right);
+			type = swapped(type);
+		}
+		if (!jump_if)
+		{
+			type = negated(type);
+		}
+
+		if (right.is_constant)
+		{
+			jumps.push_back(emit(jump_opcode(type, true), to_register(left), constant_int(right.value)));
+		}
+		else
+		{
+			jumps.push_back(emit(jump_opcode(type, false), to_register(left), right.reg));
+		}
+		return;
+	}
+
+	vm_operand_t value = compile_expression(expr);
+	jumps.push_back(emit(jump_if ? vmJumpIf : vmJumpIfNot, to_register(value)));
+}
+
+// statements
+
+void vm_compiler_t::visit(statement_list_t * node)
+{
+	for(size_t index = 0; index < node->size(); ++index)
+	{
+		int mark = next_register;
+		node->get_at(index)->accept(this);
+		next_register = mark;
+	}
+}
+
+void vm_compiler_t::visit(code_block_statement_t * node)
+{
+	node->get_body()->accept(this);
+}
+
+void vm_compiler_t::visit(declaration_t * node)
+{
+	emit(vmClear, node->get_index());
+	assigned[node->get_index()] = false;
+}
+
+void vm_compiler_t::visit(assignment_t * node)
+{
+	variable_slot_t slot = node->get_slot();
+	if (slot.depth != 0)
+	{
+		raise_error("vm: global variables are not supported");
+	}
+
+	vm_operand_t value = compile_expression(node->get_value(), slot.index);
+	to_register(value, slot.index);
+	assigned[slot.index] = true;
+}
+
+void vm_compiler_t::visit(read_statement_t * node)
+{
+	read_arguments_t * args = node->get_args();
+	for(size_t index = 0; index < args->size(); ++index)
+	{
+		variable_slot_t slot = args->get_at(index);
+		if (slot.depth != 0)
+		{
+			raise_error("vm: global variables are not supported");
+		}
+		emit(vmRead, slot.index);
+		assigned[slot.index] = true;
+	}
+}
+
+void vm_compiler_t::visit(write_statement_t * node)
+{
+	write_arguments_t * args = node->get_args();
+	for(size_t index = 0; index < args->size(); ++index)
+	{
+		int mark = next_register;
+		if (args->is_message(index))
+		{
+			emit(vmWriteString, vm->add_string(args->get_message(index)));
+		}
+		else
+		{
+			vm_operand_t value = compile_expression(args->get_expression(index));
+			emit(value.type == vtBool ? vmWriteBool : vmWriteInt, to_register(value));
+		}
+		next_register = mark;
+	}
+	emit(vmWriteLine);
+}
+
+void vm_compiler_t::visit(return_statement_t * node)
+{
+	if (method->get_return_type() == vtNoType)
+	{
+		emit(vmReturn, -1);
+	}
+	else
+	{
+		emit(vmReturn, method->get_result_index());
+	}
+	set_unreachable();
+}
+
+void vm_compiler_t::visit(conditional_statement_t * node)
+{
+	std::vector<size_t> skip_true;
+	compile_condition(node->get_condition(), false, skip_true);
+	std::vector<bool> state = assigned;
+
+	node->get_true_way()->accept(this);
+
+	if (node->get_false_way() != NULL)
+	{
+		size_t skip_false = emit(vmJump);
+		patch(skip_true, function->code.size());
+
+		std::vector<bool> true_state = assigned;
+		assigned = state;
+		node->get_false_way()->accept(this);
+		merge_state(true_state);
+		patch(skip_false);
+	}
+	else
+	{
+		patch(skip_true, function->code.size());
+		merge_state(state);
+	}
+}
+
+void vm_compiler_t::visit(while_statement_t * node)
+{
+	size_t start = function->code.size();
+
+	loops.push_back(loop_t());
+	node->get_body()->accept(this);
+
+	loop_t & loop = loops.back();
+	patch(loop.cycles, function->code.size());
+	for(size_t index = 0; index < loop.cycle_states.size(); ++index)
+	{
+		merge_state(loop.cycle_states[index]);
+	}
+
+	std::vector<size_t> repeat;
+	compile_condition(node->get_condition(), true, repeat);
+	patch(repeat, start);
+
+	for(size_t index = 0; index < loop.breaks.size(); ++index)
+	{
+		patch(loop.breaks[index]);
+		merge_state(loop.break_states[index]);
+	}
+	loops.pop_back();
+}
+
+// first, last, step and the remaining iterations live in four registers
+// reserved for the whole loop
+void vm_compiler_t::visit(do_statement_t * node)
+{
+	variable_slot_t slot = node->get_slot();
+	if (slot.depth != 0)
+	{
+		raise_error("vm: global variables are not supported");
+	}
+
+	int base = alloc_register();
+	alloc_register();
+	alloc_register();
+	int remaining = alloc_register();
+
+	to_register(compile_expression(node->get_first(), base), base);
+	to_register(compile_expression(node->get_last(), base + 1), base + 1);
+	if (node->get_step() != NULL)
+	{
+		to_register(compile_expression(node->get_step(), base + 2), base + 2);
+	}
+	else
+	{
+		emit(vmLoad, base + 2, 1, vtInt);
+	}
+
+	// the index of DO CONCURRENT is the loop's own, the variable is put back
+	// after it
+	bool concurrent = dynamic_cast<do_concurrent_statement_t *>(node) != NULL;
+	int saved = -1;
+	bool was_assigned = assigned[slot.index];
+	if (concurrent)
+	{
+		saved = alloc_register();
+		emit(vmMove, saved, slot.index);
+	}
+
+	emit(vmMove, slot.index, base);
+	assigned[slot.index] = true;
+	size_t enter = emit(vmLoopEnter, remaining, base);
+	std::vector<bool> state = assigned;
+	size_t start = function->code.size();
+
+	loops.push_back(loop_t());
+	node->get_body()->accept(this);
+
+	loop_t & loop = loops.back();
+	patch(loop.cycles, function->code.size());
+	for(size_t index = 0; index < loop.cycle_states.size(); ++index)
+	{
+		merge_state(loop.cycle_states[index]);
+	}
+	// the variable is set from the counter in base, like the tree walker
+	// does, so assigning it in the body changes neither
+	emit(vmAdd, base, base, base + 2);
+	emit(vmMove, slot.index, base);
+	emit(vmLoopNext, remaining, 0, start);
+
+	patch(enter);
+	merge_state(state);
+	for(size_t index = 0; index < loop.breaks.size(); ++index)
+	{
+		patch(loop.breaks[index]);
+		merge_state(loop.break_states[index]);
+	}
+	loops.pop_back();
+
+	if (concurrent)
+	{
+		emit(vmMove, slot.index, saved);
+		assigned[slot.index] = was_assigned;
+	}
+}
+
+void vm_compiler_t::visit(break_statement_t * node)
+{
+	if (loops.empty())
+	{
+		// a break outside of a loop leaves the method, like the tree walker does
+		emit(vmReturn, method->get_return_type() == vtNoType ? -1 : (int)method->get_result_index());
+	}
+	else
+	{
+		loops.back().breaks.push_back(emit(vmJump));
+		loops.back().break_states.push_back(assigned);
+	}
+	set_unreachable();
+}
+
+void vm_compiler_t::visit(cycle_statement_t * node)
+{
+	if (loops.empty())
+	{
+		emit(vmReturn, method->get_return_type() == vtNoType ? -1 : (int)method->get_result_index());
+	}
+	else
+	{
+		loops.back().cycles.push_back(emit(vmJump));
+		loops.back().cycle_states.push_back(assigned);
+	}
+	set_unreachable();
+}
+
+void vm_compiler_t::visit(invoke_statement_t * node)
+{
+	compile_expression(node->get_invokee());
+}
+
+// expressions
+
+void vm_compiler_t::visit(constant_t * node)
+{
+	result.is_constant = true;
+	result.value = node->get_value();
+	result.type = result.value.type;
+	result.reg = -1;
+}
+
+void vm_compiler_t::visit(variable_expression_t * node)
+{
+	variable_slot_t slot = node->get_slot();
+	if (slot.depth != 0)
+	{
+		raise_error("vm: global variables are not supported");
+	}
+
+	if (!assigned[slot.index])
+	{
+		emit(vmCheck, slot.index, vm->add_string(node->get_id()));
+		assigned[slot.index] = true;
+	}
+
+	result.is_constant = false;
+	result.reg = slot.index;
+	result.type = vtInt;
+}
+
+void vm_compiler_t::visit(binary_expression_t * node)
+{
+	int target = this->target;
+	operation type = node->get_operation();
+	vm_operand_t left = compile_expression(node->get_left());
+	vm_operand_t right = compile_expression(node->get_right());
+
+	if (left.is_constant && !right.is_constant && swapped(type) != opNot)
+	{
+		std::swap(left, right);
+		type = swapped(type);
+	}
+
+	// a constant divisor other than 0 and -1 needs no check
+	bool is_division = type == opDiv || type == opMod;
+	bool checked = is_division && !(right.is_constant && constant_int(right.value) != 0 && constant_int(right.value) != -1);
+
+	int reg = target >= 0 ? target : alloc_register();
+	if (right.is_constant && has_constant_form(type) && !checked)
+	{
+		emit(binary_opcode(type, true), reg, to_register(left), constant_int(right.value));
+	}
+	else
+	{
+		int left_reg = to_register(left);
+		int right_reg = to_register(right);
+		if (checked)
+		{
+			emit(vmCheckDivision, left_reg, right_reg, node->get_line());
+		}
+		emit(binary_opcode(type, false), reg, left_reg, right_reg);
+	}
+
+	result.is_constant = false;
+	result.reg = reg;
+	switch (type)
+	{
+	case opAdd:
+	case opSub:
+	case opMul:
+	case opDiv:
+	case opMod:
+		result.type = vtInt;
+		break;
+	default:
+		result.type = vtBool;
+		break;
+	}
+}
+
+void vm_compiler_t::visit(short_circuit_expression_t * node)
+{
+	int reg = alloc_register();
+	to_register(compile_expression(node->get_left(), reg), reg);
+	size_t skip = emit(node->get_operation() == opAnd ? vmJumpIfNot : vmJumpIf, reg);
+
+	std::vector<bool> state = assigned;
+	to_register(compile_expression(node->get_right(), reg), reg);
+	assigned = state;
+	patch(skip);
+
+	result.is_constant = false;
+	result.reg = reg;
+	result.type = vtBool;
+}
+
+void vm_compiler_t::visit(invocation_expression_t * node)
+{
+	int target = this->target;
+	size_t index = vm->get_function_index(node->get_method_id());
+	parameter_list_t * params = node->get_params();
+
+	int base = next_register;
+	for(size_t param = 0; param < params->size(); ++param)
+	{
+		alloc_register();
+	}
+
+	for(size_t param = 0; param < params->size(); ++param)
+	{
+		vm_operand_t value = compile_expression(params->get_at(param), base + param);
+		to_register(value, base + param);
+	}
+
+	int reg = target >= 0 ? target : alloc_register();
+	emit(vmCall, reg, index, base);
+
+	result.is_constant = false;
+	result.reg = reg;
+	result.type = vtInt;
+}
+
+void vm_compiler_t::visit(array_declaration_t * node)
+{
+	raise_error_at(node->get_line(), "vm: arrays are not supported");
+}
+
+void vm_compiler_t::visit(element_expression_t * node)
+{
+	raise_error_at(node->get_line(), "vm: arrays are not supported");
+}
+
+void vm_compiler_t::visit(element_assignment_t * node)
+{
+	raise_error_at(node->get_line(), "vm: arrays are not supported");
+}
+
+void vm_compiler_t::visit(reduction_expression_t * node)
+{
+	raise_error_at(node->get_line(), "vm: arrays are not supported");
+}
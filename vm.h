@@ -0,0 +1,184 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <string>
+
+#include "syntax_engine.h"
+
+// Register bytecode used by the alternative execution engine (--engine=vm).
+// Registers of a function are the variable slots laid out by the resolver
+// followed by temporaries. Jumps keep their target in c.
+
+enum vm_opcode
+{
+	vmLoad,				// a = constant b of type c
+	vmMove,				// a = b
+	vmCheck,			// error if a is not assigned, b is the name string
+	vmClear,			// a is not assigned
+	vmCheckDivision,	// error if a / b has no int result, c is the line
+
+	vmAdd,				// a = b op c
+	vmSub,
+	vmMul,
+	vmDiv,
+	vmMod,
+	vmAnd,
+	vmOr,
+	vmEquals,
+	vmNotEquals,
+	vmLesser,
+	vmGreater,
+	vmLesserEquals,
+	vmGreaterEquals,
+
+	vmAddConst,			// a = b op constant c
+	vmSubConst,
+	vmMulConst,
+	vmDivConst,
+	vmModConst,
+	vmEqualsConst,
+	vmNotEqualsConst,
+	vmLesserConst,
+	vmGreaterConst,
+	vmLesserEqualsConst,
+	vmGreaterEqualsConst,
+
+	vmJump,
+	vmJumpIf,			// if a
+	vmJumpIfNot,		// if not a
+	vmJumpEquals,		// if a op b
+	vmJumpNotEquals,
+	vmJumpLesser,
+	vmJumpGreater,
+	vmJumpLesserEquals,
+	vmJumpGreaterEquals,
+	vmJumpEqualsConst,	// if a op constant b
+	vmJumpNotEqualsConst,
+	vmJumpLesserConst,
+	vmJumpGreaterConst,
+	vmJumpLesserEqualsConst,
+	vmJumpGreaterEqualsConst,
+
+	vmLoopEnter,		// a = remaining iterations of DO b..b+2 (first, last,
+						// step), jump to c if there are none
+	vmLoopNext,			// jump to c unless a is 0, decrement a
+
+	vmCall,				// a = function b, arguments start at register c
+	vmReturn,			// return a, no value if a < 0
+
+	vmRead,				// a = integer from input
+	vmWriteString,		// string a
+	vmWriteInt,			// register a
+	vmWriteBool,
+	vmWriteLine
+};
+
+struct vm_instruction_t
+{
+	vm_opcode opcode;
+	int a;
+	int b;
+	int c;
+};
+
+struct vm_function_t
+{
+	std::string ID;
+	std::vector<vm_instruction_t> code;
+	size_t arguments_count;
+	size_t variables_count;
+	size_t registers_count;
+};
+
+class vm_t
+{
+private:
+	std::vector<vm_function_t *> functions;
+	std::map<std::string, size_t> function_indices;
+	std::vector<std::string> strings;
+	size_t main_index;
+
+public:
+	vm_t();
+
+	void load(program_t * program);
+	// the loaded code is not changed by a run, so several may go on at once
+	void run(runtime_t * runtime);
+
+	size_t get_function_index(const std::string & ID);
+	vm_function_t * get_function(size_t index);
+	int add_string(const std::string & value);
+};
+
+// Result of compiling an expression: either a constant that may be folded
+// into the instruction using it, or the register holding the value
+struct vm_operand_t
+{
+	bool is_constant;
+	variant_t value;
+	int reg;
+	variable_type type;
+};
+
+class vm_compiler_t : public ast_visitor_t
+{
+private:
+	struct loop_t
+	{
+		std::vector<size_t> breaks;
+		std::vector<std::vector<bool> > break_states;
+		std::vector<size_t> cycles;
+		std::vector<std::vector<bool> > cycle_states;
+	};
+
+	vm_t * vm;
+	method_t * method;
+	vm_function_t * function;
+	int next_register;
+	int target;
+	vm_operand_t result;
+	std::vector<loop_t> loops;
+
+	// definite assignment of the variable slots, used to omit vmCheck
+	std::vector<bool> assigned;
+
+	size_t emit(vm_opcode opcode, int a = 0, int b = 0, int c = 0);
+	void patch(size_t jump);
+	void patch(const std::vector<size_t> & jumps, size_t target);
+	void set_unreachable();
+	void merge_state(const std::vector<bool> & other);
+
+	int alloc_register();
+	int to_register(vm_operand_t operand, int target = -1);
+	vm_operand_t compile_expression(expression_t * expr, int target = -1);
+	void compile_condition(expression_t * expr, bool jump_if, std::vector<size_t> & jumps);
+
+public:
+	vm_compiler_t(vm_t * vm);
+
+	void compile(method_t * method, vm_function_t * function);
+
+	void visit(statement_list_t * node);
+	void visit(code_block_statement_t * node);
+	void visit(declaration_t * node);
+	void visit(assignment_t * node);
+	void visit(read_statement_t * node);
+	void visit(write_statement_t * node);
+	void visit(return_statement_t * node);
+	void visit(conditional_statement_t * node);
+	void visit(while_statement_t * node);
+	void visit(do_statement_t * node);
+	void visit(break_statement_t * node);
+	void visit(cycle_statement_t * node);
+	void visit(invoke_statement_t * node);
+	void visit(constant_t * node);
+	void visit(variable_expression_t * node);
+	void visit(binary_expression_t * node);
+	void visit(short_circuit_expression_t * node);
+	void visit(invocation_expression_t * node);
+	void visit(array_declaration_t * node);
+	void visit(element_expression_t * node);
+	void visit(element_assignment_t * node);
+	void visit(reduction_expression_t * node);
+};